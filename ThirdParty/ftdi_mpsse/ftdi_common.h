@@ -33,7 +33,9 @@
 /*								Macro defines								  */
 /******************************************************************************/
 /* Macros to be called before starting and after ending communication over a MPSSE channel.
-Implement the lock/unlock only if really required, otherwise keep as placeholders */
+Implement the lock/unlock only if really required, otherwise keep as placeholders.
+They are placeholders here: the EVE HAL drives its one channel from a single thread, so a transfer
+costs no mutex at all. Callers that share a channel between threads must serialise it themselves */
 #define LOCK_CHANNEL(arg)	{;}
 #define UNLOCK_CHANNEL(arg)	{;}
 
@@ -84,6 +84,9 @@ FT_STATUS SPI_Read8bits(FT_HANDLE handle,uint8 *byte, uint8 len);
 #else
 /*Root of the linked list that holds channel configurations*/
 	ChannelContext *ListHead=NULL;
+/*The node found by the last lookup. Every transfer and every CS toggle looks the channel up and
+an application nearly always drives a single channel, so this turns the walk into one compare*/
+	static ChannelContext *LastContext=NULL;
 #endif
 
 
@@ -513,11 +516,9 @@ FTDI_API FT_STATUS SPI_Write(FT_HANDLE handle, uint8 *buffer,
 	{/* sizeToTransfer is in bytes */
 		uint32 noOfBytes=0,noOfBytesTransferred=0;
 		uint8 cmdBuffer[3];
-		ChannelConfig *config=NULL;
 		uint8 mode;
 
-		status = SPI_GetChannelConfig(handle,&config);
-		CHECK_STATUS(status);
+		/*config was looked up on entry*/
 		/*mode is given by bit1-bit0 of ChannelConfig.Options*/
 		mode = (config->configOptions & SPI_CONFIG_OPTION_MODE_MASK);
 		/* Command to write 8bits */
@@ -978,6 +979,10 @@ FT_STATUS SPI_DelChannelConfig(FT_HANDLE handle)
 #ifdef NO_LINKED_LIST
 	status = FT_OK;
 #else
+	if((NULL != LastContext) && (LastContext->handle == handle))
+	{/*The node is about to be freed*/
+		LastContext = NULL;
+	}
 	if(NULL == ListHead)
 	{
 		DBG(MSG_NOTICE,"List is empty\n");
@@ -1109,12 +1114,22 @@ FT_STATUS SPI_GetChannelConfig(FT_HANDLE handle, ChannelConfig **config)
 	}
 	else
 	{
-		for(tempNode=ListHead; NULL != tempNode; tempNode=tempNode->next)
+		if((NULL != LastContext) && (LastContext->handle == handle))
+		{/*Same channel as last time*/
+			*config = &(LastContext->config);
+			status = FT_OK;
+		}
+		else
 		{
-			if(tempNode->handle == handle)
-			{/*Node found*/
-				*config = &(tempNode->config);
-				status = FT_OK;
+			for(tempNode=ListHead; NULL != tempNode; tempNode=tempNode->next)
+			{
+				if(tempNode->handle == handle)
+				{/*Node found*/
+					*config = &(tempNode->config);
+					LastContext = tempNode;
+					status = FT_OK;
+					break;
+				}
 			}
 		}
 	}
@@ -46,16 +46,25 @@
 // requires adding the base address (RAM_CMD 0x308000) to the resultant 32 bit value.
 
 #include "eve.h"     // Header for this file with prototypes, defines, and typedefs
+#include "eve_log.h" // Messages go through the non-blocking log
 #include "hw_api.h"  // For SPI abstraction
 #include <stdbool.h> // For true/false
 #include <stdint.h>  // Find integer types like "uint8_t"
 #include <stdio.h>
 
 #define WorkBuffSz 512
-#define Log printf
+#define MaxBurstSz 32768 // Largest single SPI write we hand the HAL, the bridges top out at 64K
+#define Log EVE_Debug
 
 // Global Variables
 uint16_t FifoWriteLocation = 0;
+static uint32_t *CaptureBuffer; // When set, Send_CMD() records into this instead of the FIFO
+static uint32_t CaptureCapacity;
+static uint32_t CaptureCount;
+static uint8_t IrqMask;  // Interrupts routed to INT_N, 0 when the bridge can't see the line
+static uint8_t IrqFlags; // REG_INT_FLAGS clears on read, so keep what we have seen until used
+static WriteBlockFn BlockWriter; // Replaces the plain burst in WriteBlockRAM() when set
+static uint32_t FontHandles;     // Bitmap handles given a font by Cmd_SetFont2() or Cmd_RomFont()
 char LogBuf[WorkBuffSz]; // The singular universal data array used for all things including logging
 
 const uint8_t Touch_il[] = {
@@ -165,7 +174,11 @@ static uint32_t Width;
 static uint32_t Height;
 static uint32_t HOffset;
 static uint32_t VOffset;
+static uint32_t RefreshRate;
 static uint8_t Touch;
+static int InitDisplay = -1; // EVE_Init() arguments, kept for EVE_Reinit()
+static int InitBoard;
+static int InitTouch;
 void Calibrate_Fixed(uint32_t width_pixels,
                      uint32_t height_pixels,
                      uint32_t touch_x_max,
@@ -195,6 +208,40 @@ uint32_t Display_VOffset()
   return VOffset;
 }
 
+// Panel refresh rate in millihertz, worked out from the timing EVE_Init() programmed
+uint32_t Display_RefreshRate()
+{
+  return RefreshRate;
+}
+
+// Bits per pixel of an uncompressed bitmap format, 0 for the formats that are not a whole number
+// of bits a pixel (ASTC, text and bargraph)
+uint8_t Bitmap_BitsPerPixel(uint8_t format)
+{
+  switch (format)
+  {
+  case L1:
+    return 1;
+  case L2:
+    return 2;
+  case L4:
+    return 4;
+  case L8:
+  case RGB332:
+  case ARGB2:
+  case PALETTED565:
+  case PALETTED4444:
+  case PALETTED8:
+    return 8;
+  case ARGB1555:
+  case ARGB4:
+  case RGB565:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
 #define COMMAND 0
 #define DATA 1
 #define CS_ENABLE 0
@@ -404,6 +451,9 @@ void MO_ST7789V_init(void)
 int EVE_Init(int display, int board, int touch)
 {
   uint32_t Ready = false;
+  InitDisplay = display;
+  InitBoard = board;
+  InitTouch = touch;
   int DWIDTH;
   int DHEIGHT;
   int PIXVOFFSET;
@@ -769,16 +819,11 @@ int EVE_Init(int display, int board, int touch)
   Ready = rd32(REG_CHIP_ID);
   uint16_t ValH = Ready >> 16;
   uint16_t ValL = Ready & 0xFFFF;
-  Log("Chip ID = 0x%04x%04x\n", ValH, ValL);
+  EVE_Info("Chip ID = 0x%04x%04x\n", ValH, ValL);
 
-  if (display == DISPLAY_101_1280x800)
-  {
-    wr32(REG_FREQUENCY + RAM_REG, 80000000); // Configure the system clock to 80MHz
-  }
-  else
-  {
-    wr32(REG_FREQUENCY + RAM_REG, 60000000); // Configure the system clock to 60MHz
-  }
+  uint32_t Frequency = (display == DISPLAY_101_1280x800) ? 80000000 : 60000000;
+  wr32(REG_FREQUENCY + RAM_REG, Frequency); // Configure the system clock to 80MHz or 60MHz
+  RefreshRate = (uint32_t)(((uint64_t)Frequency * 1000) / ((uint64_t)PCLK * HCYCLE * VCYCLE));
   // Before we go any further with EVE, it is a good idea to check to see if the EVE is wigging out
   // about something that happened before the last reset.  If EVE has just done a power cycle, this
   // would be unnecessary.
@@ -883,13 +928,29 @@ int EVE_Init(int display, int board, int touch)
   wr32(RAM_DL + 8, DISPLAY());
   wr8(REG_DLSWAP + RAM_REG, DLSWAP_FRAME); // Swap display lists
   wr8(REG_PCLK + RAM_REG, PCLK);           // After this display is visible on the TFT
+
+  EVE_IRQ_Enable(INT_CMDEMPTY | INT_CMDFLAG | INT_TAG | INT_TOUCH);
   return Ready;
 }
 
+// Run EVE_Init() again with the arguments it was last given, after closing the bridge.  This is
+// the slow path - a hardware reset and everything that follows.  Returns 0 if EVE_Init() was
+// never called.
+int EVE_Reinit(void)
+{
+  if (InitDisplay < 0)
+    return 0;
+  HAL_Close();
+  return EVE_Init(InitDisplay, InitBoard, InitTouch);
+}
+
 // Reset EVE chip via the hardware PDN line
 int Eve_Reset(void)
 {
   FifoWriteLocation = 0;
+  IrqMask = 0;
+  IrqFlags = 0;
+  FontHandles = 0;
   return HAL_Eve_Reset_HW();
 }
 
@@ -1142,6 +1203,14 @@ void rdN(uint32_t address, uint8_t *buffer, uint32_t size)
 // and "Command buffer" and "Coprocessor") Don't miss section 5.3 - Interaction with RAM_DL
 void Send_CMD(uint32_t data)
 {
+  if (CaptureBuffer)
+  {
+    if (CaptureCount < CaptureCapacity)
+      CaptureBuffer[CaptureCount] = data;
+    CaptureCount++;
+    return;
+  }
+
   wr32(FifoWriteLocation + RAM_CMD,
        data); // Write the command at the globally tracked "write pointer" for the FIFO
 
@@ -1150,6 +1219,78 @@ void Send_CMD(uint32_t data)
   FifoWriteLocation %= FT_CMD_FIFO_SIZE; // Wrap the address to the FIFO space
 }
 
+// *** Send_CMDs() - Send_CMD() for a block of commands.  The whole block goes out in one SPI
+// transaction per WorkBuffSz bytes (plus one where the FIFO wraps) instead of one transaction per
+// word.  Like Send_CMD() it does not update the write pointer and does not check for room.
+void Send_CMDs(const uint32_t *data, uint16_t count)
+{
+  uint8_t buffer[WorkBuffSz];
+
+  if (CaptureBuffer)
+  {
+    while (count--)
+      Send_CMD(*data++);
+    return;
+  }
+
+  while (count)
+  {
+    uint32_t words = (FT_CMD_FIFO_SIZE - FifoWriteLocation) / FT_CMD_SIZE; // Words before the wrap
+    if (words > count)
+      words = count;
+    if (words > WorkBuffSz / FT_CMD_SIZE)
+      words = WorkBuffSz / FT_CMD_SIZE;
+
+    for (uint32_t i = 0; i < words; i++)
+    {
+      buffer[i * 4 + 0] = (uint8_t)(data[i] & 0xff); // Little endian, same as wr32()
+      buffer[i * 4 + 1] = (uint8_t)((data[i] >> 8) & 0xff);
+      buffer[i * 4 + 2] = (uint8_t)((data[i] >> 16) & 0xff);
+      buffer[i * 4 + 3] = (uint8_t)((data[i] >> 24) & 0xff);
+    }
+
+    StartCoProTransfer(FifoWriteLocation + RAM_CMD, false);
+    HAL_SPI_WriteBuffer(buffer, words * FT_CMD_SIZE);
+    HAL_SPI_Disable();
+
+    FifoWriteLocation = (FifoWriteLocation + words * FT_CMD_SIZE) % FT_CMD_FIFO_SIZE;
+    data += words;
+    count -= words;
+  }
+}
+
+// *** Command capture - redirect Send_CMD() and Send_CMDs() into a host buffer
+// Between CoProCapture_Start() and CoProCapture_Stop() commands are recorded instead of being
+// written to the FIFO.  This lets a frame (or anything else) be built on the host while the
+// coprocessor is still busy, then sent in one go with Send_CMDs().  Stop returns the number of
+// words that were sent - if that is more than the capacity, the tail was lost.
+// Commands that return results in the FIFO (Cmd_MemCRC, CMD_GETPROPS ...) and data sent with
+// CoProWrCmdBuf() go straight to EVE and can not be captured.
+void CoProCapture_Start(uint32_t *buffer, uint32_t capacity)
+{
+  CaptureBuffer = buffer;
+  CaptureCapacity = capacity;
+  CaptureCount = 0;
+}
+
+uint32_t CoProCapture_Stop(void)
+{
+  CaptureBuffer = NULL;
+  return CaptureCount;
+}
+
+// True between CoProCapture_Start() and CoProCapture_Stop()
+bool CoProCapture_Active(void)
+{
+  return CaptureBuffer != NULL;
+}
+
+// Words captured so far, the index the next captured command will land at
+uint32_t CoProCapture_Count(void)
+{
+  return CaptureCount;
+}
+
 // UpdateFIFO - Cause the coprocessor to realize that it has work to do in the form of a
 // differential between the read pointer and write pointer.  The coprocessor (FIFO or "Command
 // buffer") does nothing until you tell it that the write position in the FIFO RAM has changed
@@ -1375,6 +1516,24 @@ void Cmd_SetFont2(uint32_t handle, uint32_t addr, uint32_t firstChar)
   Send_CMD(handle);
   Send_CMD(addr);
   Send_CMD(firstChar);
+  FontHandles |= 1UL << (handle & 31);
+}
+
+// *** Cmd_RomFont - load a ROM font into a bitmap handle - BT81x Series Programming Guide
+// Section 5.60 *******
+void Cmd_RomFont(uint32_t handle, uint32_t romSlot)
+{
+  Send_CMD(CMD_ROMFONT);
+  Send_CMD(handle);
+  Send_CMD(romSlot);
+  FontHandles |= 1UL << (handle & 31);
+}
+
+// Bit n set when handle n holds a font set up with Cmd_SetFont2() or Cmd_RomFont() since the last
+// reset.  Bitmap handle managers keep off these.
+uint32_t Font_Handles(void)
+{
+  return FontHandles;
 }
 // *** Cmd_SetBitmap - generate DL commands for bitmap parms - FT81x Series Programmers Guide
 // Section 5.65 *******
@@ -1399,6 +1558,60 @@ void Cmd_Memcpy(uint32_t dest, uint32_t src, uint32_t num)
   Send_CMD(num);
 }
 
+// *** Cmd_Snapshot2 - render part of the current screen into RAM_G as a bitmap of format fmt
+// (RGB565, ARGB4 or 0x20 for ARGB8) - BT81X Series Programmers Guide Section 5.72 ****************
+void Cmd_Snapshot2(uint32_t fmt, uint32_t ptr, int16_t x, int16_t y, uint16_t w, uint16_t h)
+{
+  Send_CMD(CMD_SNAPSHOT2);
+  Send_CMD(fmt);
+  Send_CMD(ptr);
+  Send_CMD(((uint32_t)(uint16_t)y << 16) | (uint16_t)x);
+  Send_CMD(((uint32_t)h << 16) | w);
+}
+
+// *** Cmd_Append - append a block of RAM_G to the display list - FT81x Series Programmers Guide
+// Section 5.26 ****************
+void Cmd_Append(uint32_t ptr, uint32_t num)
+{
+  Send_CMD(CMD_APPEND);
+  Send_CMD(ptr);
+  Send_CMD(num);
+}
+
+// *** Cmd_Memset - fill a block of memory with a byte value - FT81x Series Programmers Guide
+// ****************
+void Cmd_Memset(uint32_t ptr, uint8_t value, uint32_t num)
+{
+  Send_CMD(CMD_MEMSET);
+  Send_CMD(ptr);
+  Send_CMD((uint32_t)value);
+  Send_CMD(num);
+}
+
+// *** Cmd_Memzero - write zero to a block of memory - FT81x Series Programmers Guide
+// ****************
+void Cmd_Memzero(uint32_t ptr, uint32_t num)
+{
+  Send_CMD(CMD_MEMZERO);
+  Send_CMD(ptr);
+  Send_CMD(num);
+}
+
+// *** Cmd_MemCRC - compute a CRC-32 of a block of memory - FT81x Series Programmers Guide
+// ****************
+// The coprocessor writes the result over the last word of the command.  The returned value is the
+// FIFO location of the command, pass it to CoProResult() with word 3 once the FIFO has drained.
+uint16_t Cmd_MemCRC(uint32_t ptr, uint32_t num)
+{
+  uint16_t Location = FifoWriteLocation;
+
+  Send_CMD(CMD_MEMCRC);
+  Send_CMD(ptr);
+  Send_CMD(num);
+  Send_CMD(0); // result
+  return Location;
+}
+
 // *** Cmd_GetPtr - Get the last used address from CoPro operation - FT81x Series Programmers Guide
 // Section 5.47 *
 void Cmd_GetPtr(void)
@@ -1465,6 +1678,34 @@ void Cmd_Scale(uint32_t sx, uint32_t sy)
   Send_CMD(sy);
 }
 
+// *** Load Identity Matrix - FT81x Series Programmers Guide Section 5.47
+// ************************************************
+void Cmd_LoadIdentity(void)
+{
+  Send_CMD(CMD_LOADIDENTITY);
+}
+
+// *** Set Matrix - FT81x Series Programmers Guide Section 5.48
+// Writes the current matrix to the display list as BITMAP_TRANSFORM_A-F
+// ************************************************
+void Cmd_SetMatrix(void)
+{
+  Send_CMD(CMD_SETMATRIX);
+}
+
+// *** Get Matrix - FT81x Series Programmers Guide Section 5.52
+// Returns the FIFO location of the command, the coefficients a-f are words 1-6
+// ************************************************
+uint16_t Cmd_GetMatrix(void)
+{
+  uint16_t Location = FifoWriteLocation;
+
+  Send_CMD(CMD_GETMATRIX);
+  for (int i = 0; i < 6; i++)
+    Send_CMD(0);
+  return Location;
+}
+
 // *** Flash Fast - FT81x Series Programmers Guide Section x.xx
 // ************************************************
 void Cmd_Flash_Fast(void)
@@ -1473,6 +1714,17 @@ void Cmd_Flash_Fast(void)
   Send_CMD(0);
 }
 
+// *** Flash Read - copy flash to RAM_G - BT81x Series Programming Guide Section 5.73
+// ************************************************
+// * dest has to be 4 byte aligned, src 64 byte aligned and num a multiple of 4
+void Cmd_FlashRead(uint32_t dest, uint32_t src, uint32_t num)
+{
+  Send_CMD(CMD_FLASHREAD);
+  Send_CMD(dest);
+  Send_CMD(src);
+  Send_CMD(num);
+}
+
 // *** Calibrate Touch Digitizer - FT81x Series Programmers Guide Section 5.52
 // ***********************************
 // * This business about "result" in the manual really seems to be simply leftover cruft of no
@@ -1609,6 +1861,7 @@ void Calibrate_Manual(uint16_t Width, uint16_t Height, uint16_t V_Offset, uint16
 
     while (pressed == count)
     {
+      EVE_IRQ_Wait(INT_TOUCH, 100);
       touchValue = rd32(REG_TOUCH_DIRECT_XY + RAM_REG); // Read for any new touch tag inputs
       if (!(touchValue & 0x80000000))
       {
@@ -1696,6 +1949,80 @@ uint16_t CoProFIFO_FreeSpace(void)
   return (retval);
 }
 
+// Read back a word the coprocessor wrote into the FIFO as the result of a command.  Location is
+// the value of FifoWriteLocation before the command was sent and Word is the index of the result
+// within the command (the command itself being word 0).  The FIFO wraps, so do the math here.
+uint32_t CoProResult(uint16_t Location, uint8_t Word)
+{
+  return rd32(RAM_CMD + ((Location + (uint32_t)Word * FT_CMD_SIZE) % FT_CMD_FIFO_SIZE));
+}
+
+// Read back count bytes of FIFO from Location, for when several commands have left results.  Two
+// reads at most, split where the FIFO wraps.
+void CoProResults(uint16_t Location, uint8_t *buffer, uint32_t count)
+{
+  uint32_t run = FT_CMD_FIFO_SIZE - Location;
+  if (run > count)
+    run = count;
+  rdN(RAM_CMD + Location, buffer, run);
+  if (count > run)
+    rdN(RAM_CMD, buffer + run, count - run);
+}
+
+// *** Interrupts - EVE's INT_N line sampled through the bridge
+// When the bridge has INT_N wired (HAL_IRQ_Available()), waits sample the pin and only read
+// REG_INT_FLAGS once EVE has something to say.  Sampling a pin is one short USB round trip and
+// leaves the SPI bus alone.  Without the line everything falls back to register polling.
+#define IRQ_RECHECK_MS 20 // Look at the registers anyway this often, in case an edge is lost
+#define IRQ_SPIN_SAMPLES 4 // Samples taken back to back before a wait starts sleeping between them
+
+// Route mask to INT_N and turn on the interrupt output.  Returns the mask in use, which is 0 when
+// the bridge can not see INT_N.
+uint8_t EVE_IRQ_Enable(uint8_t mask)
+{
+  IrqMask = HAL_IRQ_Available() ? mask : 0;
+  IrqFlags = 0;
+  wr8(REG_INT_MASK + RAM_REG, IrqMask);
+  wr8(REG_INT_EN + RAM_REG, IrqMask ? 1 : 0);
+  rd8(REG_INT_FLAGS + RAM_REG); // Drop anything stale
+  return IrqMask;
+}
+
+// Interrupts seen since the last call.  Reading REG_INT_FLAGS clears it, this keeps the flags the
+// waits below have picked up so they are not lost to other users.
+uint8_t EVE_IRQ_Flags(void)
+{
+  uint8_t flags = IrqFlags | rd8(REG_INT_FLAGS + RAM_REG);
+  IrqFlags = 0;
+  return flags;
+}
+
+// Wait up to timeout_ms for one of the interrupts in mask, then consume it.  Returns false on
+// timeout.  When INT_N is not available this returns true at once, so a polling loop just carries
+// on polling the registers it was going to read anyway.
+bool EVE_IRQ_Wait(uint8_t mask, uint32_t timeout_ms)
+{
+  if (!(IrqMask & mask))
+    return true;
+
+  // The timeout is checked on every pass: INT_N can stay low for good (a miswired pin, or flags
+  // outside mask that keep firing).  The first few samples go back to back so a quick interrupt
+  // is seen quickly, after that the line is sampled once a millisecond.
+  uint64_t start = HAL_Micros();
+  uint32_t samples = 0;
+  while (!(IrqFlags & mask))
+  {
+    if (HAL_Micros() - start > (uint64_t)timeout_ms * 1000)
+      return false;
+    if (samples++ >= IRQ_SPIN_SAMPLES)
+      HAL_Delay(1);
+    if (HAL_IRQ_Asserted())
+      IrqFlags |= rd8(REG_INT_FLAGS + RAM_REG);
+  }
+  IrqFlags &= ~mask;
+  return true;
+}
+
 // Sit and wait until there are the specified number of bytes free in the <GPU/Coprocessor>
 // incoming FIFO
 void Wait4CoProFIFO(uint32_t room)
@@ -1713,7 +2040,7 @@ void Wait4CoProFIFO(uint32_t room)
 void Wait4CoProFIFOEmpty(void)
 {
   uint16_t ReadReg;
-  uint8_t ErrChar;
+  char Report[128];
   do
   {
     ReadReg = rd16(REG_CMD_READ + RAM_REG);
@@ -1721,17 +2048,11 @@ void Wait4CoProFIFOEmpty(void)
     {
       // This is a error which would require sophistication to fix and continue but we fake it
       // somewhat unsuccessfully
-      Log("\n");
-      uint8_t Offset = 0;
-      do
-      {
-        // Get the error character and display it
-        ErrChar = rd8(RAM_ERR_REPORT + Offset);
-        Offset++;
-        Log("%c", ErrChar);
-      } while ((ErrChar != 0) &&
-               (Offset < 128)); // When the last stuffed character was null, we are done
-      Log("\n");
+      // The report is a NUL terminated string of up to 128 bytes, read in one transfer and
+      // logged as a single message
+      rdN(RAM_ERR_REPORT, (uint8_t *)Report, sizeof(Report));
+      Report[sizeof(Report) - 1] = 0;
+      EVE_Error("Coprocessor fault: %s", Report);
 
       // EVE is unhappy - needs a paddling.
       uint32_t Patch_Add = rd32(REG_COPRO_PATCH_PTR + RAM_REG);
@@ -1744,7 +2065,12 @@ void Wait4CoProFIFOEmpty(void)
       HAL_Delay(250); // We already saw one error message and we don't need to see then 1000 times
                       // a second
     }
-  } while (ReadReg != rd16(REG_CMD_WRITE + RAM_REG));
+    else if (ReadReg == rd16(REG_CMD_WRITE + RAM_REG))
+    {
+      break;
+    }
+    EVE_IRQ_Wait(INT_CMDEMPTY, IRQ_RECHECK_MS); // Sleep on INT_N rather than the SPI bus
+  } while (true);
 }
 
 // Every CoPro transaction starts with enabling the SPI and sending an address
@@ -1819,19 +2145,33 @@ void CoProWrCmdBuf(const uint8_t *buff, uint32_t count)
   } while (Remaining > 0); // Keep going as long as we still want more
 }
 
-// Write a block of data into EVE RAM space a byte at a time.
+// Write a block of data into EVE RAM space in burst transfers.  If a writer has been installed
+// with WriteBlockRAM_Hook() (EVE_Mem_VerifyWrites() does this) the data goes through it instead.
 // Return the last written address + 1 (The next available RAM address)
 uint32_t WriteBlockRAM(uint32_t Add, const uint8_t *buff, uint32_t count)
 {
-  uint32_t index;
-  uint32_t WriteAddress =
-      Add; // I want to return the value instead of modifying the variable in place
+  if (BlockWriter)
+    return BlockWriter(Add, buff, count);
 
-  for (index = 0; index < count; index++)
+  while (count)
   {
-    wr8(WriteAddress++, buff[index]);
+    uint32_t TransferSize = count > MaxBurstSz ? MaxBurstSz : count;
+
+    StartCoProTransfer(Add, false);
+    HAL_SPI_WriteBuffer((uint8_t *)buff, TransferSize);
+    HAL_SPI_Disable();
+
+    Add += TransferSize;
+    buff += TransferSize;
+    count -= TransferSize;
   }
-  return (WriteAddress);
+  return (Add);
+}
+
+// Route WriteBlockRAM() through another writer, NULL restores the plain burst writes
+void WriteBlockRAM_Hook(WriteBlockFn writer)
+{
+  BlockWriter = writer;
 }
 
 // CalcCoef - Support function for manual screen calibration function
@@ -88,6 +88,7 @@ extern "C"
 #define CMD_SKETCH 0xFFFFFF30
 #define CMD_SLIDER 0xFFFFFF10
 #define CMD_SNAPSHOT 0xFFFFFF1F
+#define CMD_SNAPSHOT2 0xFFFFFF37
 #define CMD_SPINNER 0xFFFFFF16
 #define CMD_STOP 0xFFFFFF17
 #define CMD_SWAP 0xFFFFFF01
@@ -166,6 +167,7 @@ extern "C"
 #define RAM_ERR_REPORT 0x309800 // Max 128 bytes null terminated string
 #define RAM_FLASH 0x800000
 #define RAM_FLASH_POSTBLOB 0x801000
+#define ROM_FONTROOT 0x2FFFFC // Holds the address of the ROM font metric blocks
 
 // Graphics Engine Registers - FT81x Series Programmers Guide Section 3.1
 // Addresses defined as offsets from the base address called RAM_REG and located at 0x302000
@@ -181,6 +183,8 @@ extern "C"
 #define REG_HSIZE 0x34
 #define REG_HSYNC0 0x38
 #define REG_HSYNC1 0x3C
+#define REG_MACRO_0 0xD8
+#define REG_MACRO_1 0xDC
 #define REG_OUTBITS 0x5C
 #define REG_PCLK 0x70
 #define REG_PCLK_POL 0x6C
@@ -330,6 +334,31 @@ extern "C"
 #define PALETTED8 16
 #define L2 17
 
+// Blend Function Definitions - FT81x Series Programmers Guide Section 4.18
+#define ZERO 0
+#define ONE 1
+#define SRC_ALPHA 2
+#define DST_ALPHA 3
+#define ONE_MINUS_SRC_ALPHA 4
+#define ONE_MINUS_DST_ALPHA 5
+
+// Test Function Definitions for ALPHA_FUNC, STENCIL_FUNC - FT81x Series Programmers Guide 4.4
+#define NEVER 0
+#define LESS 1
+#define LEQUAL 2
+#define GREATER 3
+#define GEQUAL 4
+#define EQUAL 5
+#define NOTEQUAL 6
+#define ALWAYS 7
+
+// Stencil Operation Definitions for STENCIL_OP - FT81x Series Programmers Guide Section 4.42
+#define KEEP 1
+#define REPLACE 2
+#define INCR 3
+#define DECR 4
+#define INVERT 5
+
 // Bitmap Layout Format Definitions - BT81X Series Programming Guide Section 4.6
 #define COMPRESSED_RGBA_ASTC_4x4_KHR 37808   // 8.00
 #define COMPRESSED_RGBA_ASTC_5x4_KHR 37809   // 6.40
@@ -352,6 +381,21 @@ extern "C"
 #define NEAREST 0
 #define BILINEAR 1
 
+// Audio Playback Formats for REG_PLAYBACK_FORMAT - FT81x Series Programmers Guide Section 4.2
+#define LINEAR_SAMPLES 0
+#define ULAW_SAMPLES 1
+#define ADPCM_SAMPLES 2
+
+// Interrupt Flags for REG_INT_FLAGS, REG_INT_MASK - FT81x Series Programmers Guide Section 3.6
+#define INT_SWAP 0x01
+#define INT_TOUCH 0x02
+#define INT_TAG 0x04
+#define INT_SOUND 0x08
+#define INT_PLAYBACK 0x10
+#define INT_CMDEMPTY 0x20
+#define INT_CMDFLAG 0x40
+#define INT_CONVCOMPLETE 0x80
+
 // Flash Status
 #define FLASH_STATUS_INIT 0UL
 #define FLASH_STATUS_DETACHED 1UL
@@ -390,6 +434,36 @@ extern "C"
 #define BITMAP_SIZE(filter, wrapx, wrapy, width, height)                                          \
   ((8UL << 24) | (((filter)&1UL) << 20) | (((wrapx)&1UL) << 19) | (((wrapy)&1UL) << 18) |         \
    (((width)&511UL) << 9) | (((height)&511UL) << 0)) // BITMAP_SIZE - FT-PG Section 4.09
+// BITMAP_TRANSFORM_A/B/D/E take 8.8 fixed point, or 1.15 when p is 1 (BT81x only).  C and F are
+// 15.8 fixed point.
+#define BITMAP_TRANSFORM_A(p, a)                                                                  \
+  ((21UL << 24) | (((p)&1UL) << 17) | (((a)&131071UL) << 0)) // BITMAP_TRANSFORM_A - FT-PG 4.12
+#define BITMAP_TRANSFORM_B(p, b)                                                                  \
+  ((22UL << 24) | (((p)&1UL) << 17) | (((b)&131071UL) << 0)) // BITMAP_TRANSFORM_B - FT-PG 4.13
+#define BITMAP_TRANSFORM_C(c)                                                                     \
+  ((23UL << 24) | (((c)&16777215UL) << 0)) // BITMAP_TRANSFORM_C - FT-PG Section 4.14
+#define BITMAP_TRANSFORM_D(p, d)                                                                  \
+  ((24UL << 24) | (((p)&1UL) << 17) | (((d)&131071UL) << 0)) // BITMAP_TRANSFORM_D - FT-PG 4.15
+#define BITMAP_TRANSFORM_E(p, e)                                                                  \
+  ((25UL << 24) | (((p)&1UL) << 17) | (((e)&131071UL) << 0)) // BITMAP_TRANSFORM_E - FT-PG 4.16
+#define BITMAP_TRANSFORM_F(f)                                                                     \
+  ((26UL << 24) | (((f)&16777215UL) << 0)) // BITMAP_TRANSFORM_F - FT-PG Section 4.17
+#define BITMAP_LAYOUT_H(linestride, height)                                                       \
+  ((40UL << 24) | ((((linestride) >> 10) & 3UL) << 2) |                                           \
+   (((height) >> 9) & 3UL)) // BITMAP_LAYOUT_H - FT-PG Section 4.8
+#define BITMAP_SIZE_H(width, height)                                                              \
+  ((41UL << 24) | ((((width) >> 9) & 3UL) << 2) |                                                 \
+   (((height) >> 9) & 3UL)) // BITMAP_SIZE_H - FT-PG Section 4.10
+#define PALETTE_SOURCE(addr)                                                                      \
+  ((42UL << 24) | (((addr)&4194303UL) << 0)) // PALETTE_SOURCE - FT-PG Section 4.35
+#define BLEND_FUNC(src, dst)                                                                      \
+  ((11UL << 24) | (((src)&7UL) << 3) | (((dst)&7UL) << 0)) // BLEND_FUNC - FT-PG Section 4.18
+#define COLOR_MASK(r, g, b, a)                                                                    \
+  ((32UL << 24) | (((r)&1UL) << 3) | (((g)&1UL) << 2) | (((b)&1UL) << 1) |                        \
+   (((a)&1UL) << 0))                    // COLOR_MASK - FT-PG Section 4.27
+#define SAVE_CONTEXT() ((34UL << 24))    // SAVE_CONTEXT - FT-PG Section 4.39
+#define RESTORE_CONTEXT() ((35UL << 24)) // RESTORE_CONTEXT - FT-PG Section 4.37
+#define MACRO(m) ((37UL << 24) | (((m)&1UL) << 0)) // MACRO - FT-PG Section 4.33
 #define TAG(s) ((3UL << 24) | (((s)&255UL) << 0))    // TAG - FT-PG Section 4.43
 #define POINT_SIZE(sighs)                                                                         \
   ((13UL << 24) | (((sighs)&8191UL) << 0)) // POINT_SIZE - FT-PG Section 4.36
@@ -418,6 +492,7 @@ extern "C"
   // else the chipID of the EVE IC that was detected.
   // The Display, board and touch defines can be found in displays.h
   int EVE_EXPORT EVE_Init(int display, int board, int touch);
+  int EVE_EXPORT EVE_Reinit(void);
 
   int EVE_EXPORT Eve_Reset(void);
   void EVE_EXPORT Cap_Touch_Upload(void);
@@ -431,6 +506,11 @@ extern "C"
   uint32_t EVE_EXPORT rd32(uint32_t RegAddr);
   void EVE_EXPORT rdN(uint32_t address, uint8_t *buffer, uint32_t size);
   void EVE_EXPORT Send_CMD(uint32_t data);
+  void EVE_EXPORT Send_CMDs(const uint32_t *data, uint16_t count);
+  void EVE_EXPORT CoProCapture_Start(uint32_t *buffer, uint32_t capacity);
+  uint32_t EVE_EXPORT CoProCapture_Stop(void);
+  uint32_t EVE_EXPORT CoProCapture_Count(void);
+  bool EVE_EXPORT CoProCapture_Active(void);
   void EVE_EXPORT UpdateFIFO(void);
   uint8_t EVE_EXPORT Cmd_READ_REG_ID(void);
 
@@ -478,6 +558,16 @@ extern "C"
 
   void EVE_EXPORT Cmd_SetBitmap(uint32_t addr, uint16_t fmt, uint16_t width, uint16_t height);
   void EVE_EXPORT Cmd_Memcpy(uint32_t dest, uint32_t src, uint32_t num);
+  void EVE_EXPORT Cmd_Append(uint32_t ptr, uint32_t num);
+  void EVE_EXPORT Cmd_Snapshot2(uint32_t fmt,
+                                uint32_t ptr,
+                                int16_t x,
+                                int16_t y,
+                                uint16_t w,
+                                uint16_t h);
+  void EVE_EXPORT Cmd_Memset(uint32_t ptr, uint8_t value, uint32_t num);
+  void EVE_EXPORT Cmd_Memzero(uint32_t ptr, uint32_t num);
+  uint16_t EVE_EXPORT Cmd_MemCRC(uint32_t ptr, uint32_t num);
   void EVE_EXPORT Cmd_GetPtr(void);
   void EVE_EXPORT Cmd_GradientColor(uint32_t c);
   void EVE_EXPORT Cmd_FGcolor(uint32_t c);
@@ -486,8 +576,12 @@ extern "C"
   void EVE_EXPORT Cmd_Rotate(uint32_t a);
   void EVE_EXPORT Cmd_SetRotate(uint32_t rotation);
   void EVE_EXPORT Cmd_Scale(uint32_t sx, uint32_t sy);
+  void EVE_EXPORT Cmd_LoadIdentity(void);
+  void EVE_EXPORT Cmd_SetMatrix(void);
+  uint16_t EVE_EXPORT Cmd_GetMatrix(void);
   void EVE_EXPORT Cmd_Calibrate(uint32_t result);
   void EVE_EXPORT Cmd_Flash_Fast(void);
+  void EVE_EXPORT Cmd_FlashRead(uint32_t dest, uint32_t src, uint32_t num);
 
   void EVE_EXPORT Cmd_AnimStart(int32_t ch, uint32_t aoptr, uint32_t loop);
   void EVE_EXPORT Cmd_AnimStop(int32_t ch);
@@ -500,18 +594,29 @@ extern "C"
                                    uint16_t V_Offset,
                                    uint16_t H_Offset);
   void EVE_EXPORT Cmd_SetFont2(uint32_t handle, uint32_t addr, uint32_t firstChar);
+  void EVE_EXPORT Cmd_RomFont(uint32_t handle, uint32_t romSlot);
+  uint32_t EVE_EXPORT Font_Handles(void);
   uint16_t EVE_EXPORT CoProFIFO_FreeSpace(void);
+  uint32_t EVE_EXPORT CoProResult(uint16_t Location, uint8_t Word);
+  void EVE_EXPORT CoProResults(uint16_t Location, uint8_t *buffer, uint32_t count);
   void EVE_EXPORT Wait4CoProFIFO(uint32_t room);
   void EVE_EXPORT Wait4CoProFIFOEmpty(void);
+  uint8_t EVE_EXPORT EVE_IRQ_Enable(uint8_t mask);
+  uint8_t EVE_EXPORT EVE_IRQ_Flags(void);
+  bool EVE_EXPORT EVE_IRQ_Wait(uint8_t mask, uint32_t timeout_ms);
   void EVE_EXPORT StartCoProTransfer(uint32_t address, uint8_t reading);
   void EVE_EXPORT CoProWrCmdBuf(const uint8_t *buffer, uint32_t count);
   uint32_t EVE_EXPORT WriteBlockRAM(uint32_t Add, const uint8_t *buff, uint32_t count);
+  typedef uint32_t (*WriteBlockFn)(uint32_t Add, const uint8_t *buff, uint32_t count);
+  void EVE_EXPORT WriteBlockRAM_Hook(WriteBlockFn writer);
   int32_t EVE_EXPORT CalcCoef(int32_t Q, int32_t K);
   uint32_t EVE_EXPORT Display_Width();
   uint32_t EVE_EXPORT Display_Height();
   uint8_t EVE_EXPORT Display_Touch();
   uint32_t EVE_EXPORT Display_HOffset();
   uint32_t EVE_EXPORT Display_VOffset();
+  uint32_t EVE_EXPORT Display_RefreshRate();
+  uint8_t EVE_EXPORT Bitmap_BitsPerPixel(uint8_t format);
 
   /* Flash commands */
   bool EVE_EXPORT FlashAttach(void);
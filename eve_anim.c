@@ -0,0 +1,212 @@
+// Animation scheduler - host side timing and easing, one burst of commands per frame
+
+#include "eve_anim.h"
+#include "hw_api.h"
+
+// Map progress (0..65536 in 16.16) through the easing curve
+static uint32_t Ease(uint8_t easing, uint32_t t)
+{
+  switch (easing)
+  {
+  case EVE_EASE_IN:
+    return (t * t) >> 16;
+  case EVE_EASE_OUT:
+    return 2 * t - ((t * t) >> 16);
+  case EVE_EASE_IN_OUT:
+    if (t < 32768)
+      return (t * t) >> 15;
+    t = 65536 - t;
+    return 65536 - ((t * t) >> 15);
+  default:
+    return t;
+  }
+}
+
+static void Position(const EVE_AnimChannel *c, uint32_t frame, int16_t *x, int16_t *y)
+{
+  uint32_t elapsed = frame - c->MoveStart;
+
+  if (!c->MoveFrames || elapsed >= c->MoveFrames)
+  {
+    *x = c->ToX;
+    *y = c->ToY;
+    return;
+  }
+  // elapsed < MoveFrames, so progress stays below 1.0 and t * t in Ease() fits 32 bits
+  int64_t e = Ease(c->Easing, (elapsed << 16) / c->MoveFrames);
+  *x = (int16_t)(c->FromX + (((c->ToX - c->FromX) * e) >> 16));
+  *y = (int16_t)(c->FromY + (((c->ToY - c->FromY) * e) >> 16));
+}
+
+static int Claim(EVE_AnimScheduler *sched)
+{
+  for (int ch = 0; ch < EVE_ANIM_CHANNELS; ch++)
+  {
+    EVE_AnimChannel *c = &sched->Channels[ch];
+    if (!c->Active && !c->StopPending)
+    {
+      memset(c, 0, sizeof(*c));
+      c->Active = true;
+      return ch;
+    }
+  }
+  return -1;
+}
+
+static bool Valid(const EVE_AnimScheduler *sched, int channel)
+{
+  return channel >= 0 && channel < EVE_ANIM_CHANNELS && sched->Channels[channel].Active;
+}
+
+void EVE_Anim_Init(EVE_AnimScheduler *sched)
+{
+  memset(sched, 0, sizeof(*sched));
+}
+
+int EVE_Anim_Play(EVE_AnimScheduler *sched, uint32_t object, uint8_t loop, int16_t x, int16_t y)
+{
+  int ch = Claim(sched);
+  if (ch < 0)
+    return -1;
+
+  EVE_AnimChannel *c = &sched->Channels[ch];
+  c->Object = object;
+  c->Loop = loop;
+  c->FromX = c->ToX = x;
+  c->FromY = c->ToY = y;
+  return ch;
+}
+
+int EVE_Anim_PlayFrames(EVE_AnimScheduler *sched,
+                        uint32_t object,
+                        uint16_t frameCount,
+                        uint8_t divider,
+                        uint8_t loop,
+                        int16_t x,
+                        int16_t y)
+{
+  int ch = EVE_Anim_Play(sched, object, loop, x, y);
+  if (ch < 0)
+    return -1;
+
+  EVE_AnimChannel *c = &sched->Channels[ch];
+  c->HostTimed = true;
+  c->FrameCount = frameCount ? frameCount : 1;
+  c->Divider = divider ? divider : 1;
+  return ch;
+}
+
+void EVE_Anim_MoveTo(
+    EVE_AnimScheduler *sched, int channel, int16_t x, int16_t y, uint16_t frames, EVE_Easing easing)
+{
+  if (!Valid(sched, channel))
+    return;
+
+  EVE_AnimChannel *c = &sched->Channels[channel];
+  Position(c, sched->Frame, &c->FromX, &c->FromY); // Start from wherever it is now
+  c->ToX = x;
+  c->ToY = y;
+  c->MoveStart = sched->Frame;
+  c->MoveFrames = frames;
+  c->Easing = (uint8_t)easing;
+}
+
+void EVE_Anim_Stop(EVE_AnimScheduler *sched, int channel)
+{
+  if (!Valid(sched, channel))
+    return;
+
+  EVE_AnimChannel *c = &sched->Channels[channel];
+  c->Active = false;
+  c->StopPending = !c->HostTimed && c->Started; // Only coprocessor channels need telling
+}
+
+bool EVE_Anim_Active(const EVE_AnimScheduler *sched, int channel)
+{
+  return Valid(sched, channel);
+}
+
+uint16_t EVE_Anim_Emit(EVE_AnimScheduler *sched)
+{
+  uint16_t n = 0;
+  uint32_t *b = sched->Batch;
+
+  sched->Frame = rd32(REG_FRAMES + RAM_REG); // The only read per frame, however many animations
+
+  for (int ch = 0; ch < EVE_ANIM_CHANNELS; ch++)
+  {
+    EVE_AnimChannel *c = &sched->Channels[ch];
+    int16_t x, y;
+
+    if (c->StopPending)
+    {
+      b[n++] = CMD_ANIMSTOP;
+      b[n++] = (uint32_t)ch;
+      c->StopPending = false;
+      continue;
+    }
+    if (!c->Active)
+      continue;
+
+    if (!c->Started)
+    {
+      // Anchor the timeline to the first frame the animation is actually shown
+      c->FrameStart = sched->Frame;
+      c->MoveStart = sched->Frame;
+      c->Started = true;
+      if (!c->HostTimed)
+      {
+        b[n++] = CMD_ANIMSTART;
+        b[n++] = (uint32_t)ch;
+        b[n++] = c->Object;
+        b[n++] = c->Loop;
+      }
+    }
+
+    Position(c, sched->Frame, &x, &y);
+    uint32_t xy = ((uint32_t)(uint16_t)y << 16) | (uint16_t)x;
+
+    if (c->HostTimed)
+    {
+      uint32_t frame = (sched->Frame - c->FrameStart) / c->Divider;
+      if (frame >= c->FrameCount)
+      {
+        if (c->Loop == ANIM_LOOP)
+        {
+          frame %= c->FrameCount;
+        }
+        else if (c->Loop == ANIM_HOLD)
+        {
+          frame = c->FrameCount - 1;
+        }
+        else
+        {
+          c->Active = false; // ANIM_ONCE has played out
+          continue;
+        }
+      }
+      b[n++] = CMD_ANIMFRAME;
+      b[n++] = xy;
+      b[n++] = c->Object;
+      b[n++] = frame;
+    }
+    else
+    {
+      b[n++] = CMD_ANIMXY;
+      b[n++] = (uint32_t)ch;
+      b[n++] = xy;
+      b[n++] = CMD_ANIMDRAW;
+      b[n++] = (uint32_t)ch;
+    }
+  }
+
+  // Straight into the FIFO, make room for the whole burst first.  Free space is worked out from
+  // REG_CMD_WRITE, so what the display list has sent so far goes out with it.
+  if (n && !CoProCapture_Active())
+  {
+    UpdateFIFO();
+    Wait4CoProFIFO(n * FT_CMD_SIZE);
+  }
+  Send_CMDs(sched->Batch, n);
+  return n;
+}
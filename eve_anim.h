@@ -0,0 +1,97 @@
+#ifndef __EVE_ANIM_H
+#define __EVE_ANIM_H
+
+// Animation scheduler
+//
+// Keeps track of up to 32 animations and turns them into one contiguous block of coprocessor
+// commands per frame.  Positions (and, for host timed animations, frame numbers) are worked out
+// on the host from a single REG_FRAMES read, then the whole block is burst into the FIFO with
+// Send_CMDs().  Adding another animation adds a few words to the burst, not another round of
+// SPI transactions.
+//
+// Two kinds of animation are supported:
+//  - Channel animations use one of EVE's ANIM channels.  The coprocessor picks the frame,
+//    the scheduler emits CMD_ANIMSTART once and CMD_ANIMXY / CMD_ANIMDRAW every frame.
+//  - Host timed animations are drawn with CMD_ANIMFRAME and the host picks the frame, which
+//    allows running them at a fraction of the panel refresh rate.
+//
+// Animation objects live in flash.  CMD_ANIMSTART and CMD_ANIMFRAME take the flash address of
+// the object directly, the flash has to be attached and in full speed mode (FlashFast()).
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_ANIM_CHANNELS 32
+#define EVE_ANIM_WORDS 9 // Worst case words per animation per frame (start + XY + draw)
+
+  typedef enum
+  {
+    EVE_EASE_LINEAR,
+    EVE_EASE_IN,
+    EVE_EASE_OUT,
+    EVE_EASE_IN_OUT
+  } EVE_Easing;
+
+  typedef struct
+  {
+    uint32_t Object; // Flash address of the animation object
+    bool Active;
+    bool HostTimed;
+    bool Started;     // CMD_ANIMSTART has been sent for a channel animation
+    bool StopPending; // CMD_ANIMSTOP goes out with the next batch
+    uint8_t Loop;     // ANIM_ONCE, ANIM_LOOP or ANIM_HOLD
+    uint8_t Easing;
+    uint8_t Divider;     // Display frames per animation frame (host timed)
+    uint16_t FrameCount; // Frames in the object (host timed)
+    uint32_t FrameStart; // REG_FRAMES when the animation started
+    int16_t FromX, FromY, ToX, ToY;
+    uint32_t MoveStart; // REG_FRAMES when the current move started
+    uint16_t MoveFrames;
+  } EVE_AnimChannel;
+
+  typedef struct
+  {
+    EVE_AnimChannel Channels[EVE_ANIM_CHANNELS];
+    uint32_t Frame; // REG_FRAMES as sampled by the last EVE_Anim_Emit()
+    uint32_t Batch[EVE_ANIM_CHANNELS * EVE_ANIM_WORDS];
+  } EVE_AnimScheduler;
+
+  void EVE_EXPORT EVE_Anim_Init(EVE_AnimScheduler *sched);
+
+  // Start a coprocessor timed animation on a free ANIM channel.  Returns the channel or -1.
+  int EVE_EXPORT
+  EVE_Anim_Play(EVE_AnimScheduler *sched, uint32_t object, uint8_t loop, int16_t x, int16_t y);
+
+  // Start a host timed animation that advances one frame every divider display frames
+  int EVE_EXPORT EVE_Anim_PlayFrames(EVE_AnimScheduler *sched,
+                                     uint32_t object,
+                                     uint16_t frameCount,
+                                     uint8_t divider,
+                                     uint8_t loop,
+                                     int16_t x,
+                                     int16_t y);
+
+  // Glide to a new position over the given number of display frames (0 jumps there)
+  void EVE_EXPORT EVE_Anim_MoveTo(EVE_AnimScheduler *sched,
+                                  int channel,
+                                  int16_t x,
+                                  int16_t y,
+                                  uint16_t frames,
+                                  EVE_Easing easing);
+
+  void EVE_EXPORT EVE_Anim_Stop(EVE_AnimScheduler *sched, int channel);
+  bool EVE_EXPORT EVE_Anim_Active(const EVE_AnimScheduler *sched, int channel);
+
+  // Emit this frame's commands for every animation.  Call it while building a display list,
+  // between CMD_DLSTART and DISPLAY().  Returns the number of words sent.
+  uint16_t EVE_EXPORT EVE_Anim_Emit(EVE_AnimScheduler *sched);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
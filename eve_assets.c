@@ -0,0 +1,215 @@
+// Resident assets and bridge reconnect - probe EVE, restore host state, re-upload what was lost
+
+#include "eve_assets.h"
+#include "eve_memory.h"
+#include "hw_api.h"
+
+#define CRC_BATCH 32 // CMD_MEMCRC commands per round trip, 512 bytes of FIFO
+
+typedef struct
+{
+  uint32_t Address;
+  const uint8_t *Data;
+  uint32_t Length;
+  uint32_t CRC;
+  uint8_t Priority;
+  bool Used;
+} Asset;
+
+static Asset Assets[EVE_ASSET_MAX];
+static uint32_t CheckpointFrames;
+static uint64_t CheckpointTime; // 0 until the first checkpoint
+static EVE_ReconnectStats Stats;
+
+static bool Valid(int asset)
+{
+  return asset >= 0 && asset < EVE_ASSET_MAX && Assets[asset].Used;
+}
+
+// Collect the registered assets, lowest priority number first.  Returns how many there are.
+static int ByPriority(int *out)
+{
+  int count = 0;
+
+  for (int i = 0; i < EVE_ASSET_MAX; i++)
+  {
+    if (!Assets[i].Used)
+      continue;
+    int pos = count++;
+    while (pos > 0 && Assets[out[pos - 1]].Priority > Assets[i].Priority)
+    {
+      out[pos] = out[pos - 1];
+      pos--;
+    }
+    out[pos] = i;
+  }
+  return count;
+}
+
+int EVE_Asset_Register(uint32_t address, const uint8_t *data, uint32_t length, uint8_t priority)
+{
+  for (int i = 0; i < EVE_ASSET_MAX; i++)
+  {
+    if (Assets[i].Used)
+      continue;
+    Assets[i].Address = address;
+    Assets[i].Data = data;
+    Assets[i].Length = length;
+    Assets[i].Priority = priority;
+    Assets[i].CRC = EVE_CRC32(0, data, length);
+    Assets[i].Used = true;
+    return i;
+  }
+  return -1;
+}
+
+void EVE_Asset_Unregister(int asset)
+{
+  if (Valid(asset))
+    Assets[asset].Used = false;
+}
+
+void EVE_Asset_Changed(int asset)
+{
+  if (Valid(asset))
+    Assets[asset].CRC = EVE_CRC32(0, Assets[asset].Data, Assets[asset].Length);
+}
+
+uint32_t EVE_Asset_UploadAll(void)
+{
+  int order[EVE_ASSET_MAX];
+  int count = ByPriority(order);
+  uint32_t bytes = 0;
+
+  for (int i = 0; i < count; i++)
+  {
+    Asset *a = &Assets[order[i]];
+    WriteBlockRAM(a->Address, a->Data, a->Length);
+    bytes += a->Length;
+  }
+  EVE_Asset_Checkpoint();
+  return bytes;
+}
+
+void EVE_Asset_Checkpoint(void)
+{
+  CheckpointFrames = rd32(REG_FRAMES + RAM_REG);
+  CheckpointTime = HAL_Micros();
+}
+
+// Did EVE keep power and keep running while the bridge was gone?
+static bool Survived(void)
+{
+  if (rd8(REG_ID + RAM_REG) != 0x7C)
+    return false;
+
+  uint32_t frames = rd32(REG_FRAMES + RAM_REG);
+  if (!CheckpointTime)
+    return frames != 0; // Nothing to compare with, a reset EVE at least has not started counting
+
+  // The frame counter has to have moved on by about as many refreshes as fit in the time since
+  // the checkpoint.  Allow a factor of two either way for clock error and the probe itself.
+  uint64_t elapsed = HAL_Micros() - CheckpointTime;
+  uint64_t expected = elapsed * Display_RefreshRate() / 1000000000ULL;
+  uint32_t counted = frames - CheckpointFrames;
+  if (counted < expected / 2 || counted > expected * 2 + 2)
+    return false;
+
+  return rd16(REG_CMD_READ + RAM_REG) != 0xFFF;
+}
+
+// CRC every asset on EVE in batches and upload the ones that do not match, in priority order.
+// Returns how many were uploaded.
+static uint32_t Repair(void)
+{
+  int order[EVE_ASSET_MAX];
+  uint8_t results[CRC_BATCH * 4 * FT_CMD_SIZE];
+  int count = ByPriority(order);
+  uint32_t uploaded = 0;
+
+  for (int first = 0; first < count; first += CRC_BATCH)
+  {
+    int n = (count - first > CRC_BATCH) ? CRC_BATCH : count - first;
+
+    Wait4CoProFIFO(n * 4 * FT_CMD_SIZE);
+    uint16_t Location = FifoWriteLocation;
+    for (int i = 0; i < n; i++)
+      Cmd_MemCRC(Assets[order[first + i]].Address, Assets[order[first + i]].Length);
+    UpdateFIFO();
+    Wait4CoProFIFOEmpty();
+    CoProResults(Location, results, n * 4 * FT_CMD_SIZE);
+
+    for (int i = 0; i < n; i++)
+    {
+      Asset *a = &Assets[order[first + i]];
+      const uint8_t *p = &results[i * 4 * FT_CMD_SIZE + 3 * FT_CMD_SIZE];
+      uint32_t crc = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+                     ((uint32_t)p[3] << 24);
+      if (crc != a->CRC)
+      {
+        WriteBlockRAM(a->Address, a->Data, a->Length);
+        uploaded++;
+      }
+    }
+  }
+  return uploaded;
+}
+
+EVE_ReconnectResult EVE_Reconnect(void)
+{
+  EVE_ReconnectResult result;
+  uint64_t start = HAL_Micros();
+
+  Stats.Attempts++;
+  if (!HAL_Reopen())
+  {
+    result = EVE_RECONNECT_FAILED;
+  }
+  else if (Survived())
+  {
+    // Anything written to the FIFO after the last REG_CMD_WRITE update never reached the
+    // coprocessor, so pick up from where EVE thinks the FIFO ends
+    FifoWriteLocation = rd16(REG_CMD_WRITE + RAM_REG);
+    Wait4CoProFIFOEmpty();
+
+    uint32_t uploaded = Repair();
+    Stats.AssetsUploaded += uploaded;
+    result = uploaded ? EVE_RECONNECT_REPAIRED : EVE_RECONNECT_RESTORED;
+  }
+  else if (EVE_Reinit() > 1)
+  {
+    for (int i = 0; i < EVE_ASSET_MAX; i++)
+      Stats.AssetsUploaded += Assets[i].Used;
+    EVE_Asset_UploadAll();
+    result = EVE_RECONNECT_RELOADED;
+  }
+  else
+  {
+    result = EVE_RECONNECT_FAILED;
+  }
+
+  switch (result)
+  {
+  case EVE_RECONNECT_RESTORED:
+    Stats.Restored++;
+    break;
+  case EVE_RECONNECT_REPAIRED:
+    Stats.Repaired++;
+    break;
+  case EVE_RECONNECT_RELOADED:
+    Stats.Reloaded++;
+    break;
+  default:
+    Stats.Failed++;
+    break;
+  }
+  if (result != EVE_RECONNECT_FAILED)
+    EVE_Asset_Checkpoint();
+  Stats.LastTime_us = (uint32_t)(HAL_Micros() - start);
+  return result;
+}
+
+const EVE_ReconnectStats *EVE_Reconnect_Stats(void)
+{
+  return &Stats;
+}
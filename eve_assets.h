@@ -0,0 +1,69 @@
+#ifndef __EVE_ASSETS_H
+#define __EVE_ASSETS_H
+
+// Resident assets and reconnecting after the USB bridge is lost
+//
+// Register everything that lives in EVE memory (bitmaps, fonts, tables) together with the host
+// copy it came from.  When the bridge drops off the bus and comes back, EVE_Reconnect() reopens
+// it without a hardware reset and works out whether EVE kept running:
+//  - REG_ID still answers 0x7C
+//  - REG_FRAMES has advanced by roughly what the host clock says since the last checkpoint,
+//    which a reset or power cycle (counter back at 0, pixel clock off) can not fake
+//  - the coprocessor is not in an error state
+// If so, only the host side FIFO pointer is restored, and the CRC of every asset is checked with
+// a batch of CMD_MEMCRC.  Assets that do not match are uploaded again.  If EVE did not survive,
+// EVE_Reinit() runs and every asset is uploaded, lowest priority number first.
+//
+// The host copies are not duplicated, the pointers given to EVE_Asset_Register() must stay valid.
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_ASSET_MAX 64
+
+  typedef enum
+  {
+    EVE_RECONNECT_FAILED,   // Bridge or EVE not found, try again later
+    EVE_RECONNECT_RESTORED, // EVE kept its state, nothing was uploaded
+    EVE_RECONNECT_REPAIRED, // EVE kept running but some assets had to be uploaded again
+    EVE_RECONNECT_RELOADED  // EVE was reinitialised and every asset uploaded, redraw everything
+  } EVE_ReconnectResult;
+
+  typedef struct
+  {
+    uint32_t Attempts;
+    uint32_t Restored;
+    uint32_t Repaired;
+    uint32_t Reloaded;
+    uint32_t Failed;
+    uint32_t AssetsUploaded; // By reconnects, not by EVE_Asset_UploadAll()
+    uint32_t LastTime_us;    // Duration of the last reconnect
+  } EVE_ReconnectStats;
+
+  // Returns an asset number or -1 when the table is full.  Priority 0 is uploaded first.
+  int EVE_EXPORT EVE_Asset_Register(uint32_t address,
+                                    const uint8_t *data,
+                                    uint32_t length,
+                                    uint8_t priority);
+  void EVE_EXPORT EVE_Asset_Unregister(int asset);
+  // The host copy changed, work out its CRC again
+  void EVE_EXPORT EVE_Asset_Changed(int asset);
+  // Upload every registered asset in priority order with WriteBlockRAM(), returns bytes sent
+  uint32_t EVE_EXPORT EVE_Asset_UploadAll(void);
+
+  // Note REG_FRAMES and the host time.  EVE_Reconnect() compares against the latest checkpoint,
+  // so call this every so often (once a second is plenty) while the bridge is healthy.
+  void EVE_EXPORT EVE_Asset_Checkpoint(void);
+
+  EVE_ReconnectResult EVE_EXPORT EVE_Reconnect(void);
+  const EVE_ReconnectStats EVE_EXPORT *EVE_Reconnect_Stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,252 @@
+// Sprite atlases - icons packed into CELL addressed strips, looked up by name
+
+#include "eve_atlas.h"
+#include <stdlib.h>
+
+#define INDEX_SIZE (2 * EVE_ATLAS_ICONS)
+
+static uint32_t FNV1a(const char *name)
+{
+  uint32_t hash = 2166136261UL;
+
+  while (*name)
+  {
+    hash ^= (uint8_t)*name++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+// Slot in the index that holds name, or the empty slot where it would go
+static uint16_t Slot(const EVE_Atlas *atlas, const char *name, uint32_t hash)
+{
+  uint16_t i = (uint16_t)(hash % INDEX_SIZE);
+
+  while (atlas->Index[i])
+  {
+    const EVE_AtlasIcon *icon = &atlas->Icons[atlas->Index[i] - 1];
+    if (icon->Hash == hash && !strcmp(icon->Name, name))
+      break;
+    i = (uint16_t)((i + 1) % INDEX_SIZE);
+  }
+  return i;
+}
+
+static uint16_t RoundUp(uint16_t v, uint16_t round)
+{
+  return round > 1 ? (uint16_t)((v + round - 1) / round * round) : v;
+}
+
+void EVE_Atlas_Init(EVE_Atlas *atlas, const uint8_t *handles, uint8_t handleCount, uint16_t round)
+{
+  memset(atlas, 0, sizeof(*atlas));
+  atlas->Handles = handles;
+  atlas->HandleCount = handleCount;
+  atlas->Round = round;
+  atlas->LastStrip = -1;
+  for (int i = 0; i < EVE_ATLAS_STRIPS; i++)
+    atlas->Strips[i].Region = -1;
+}
+
+bool EVE_Atlas_Add(EVE_Atlas *atlas,
+                   const char *name,
+                   const uint8_t *pixels,
+                   uint16_t width,
+                   uint16_t height,
+                   uint8_t format)
+{
+  uint32_t bits = Bitmap_BitsPerPixel(format);
+  uint32_t hash = FNV1a(name);
+
+  if (atlas->Built || atlas->IconCount >= EVE_ATLAS_ICONS || !bits || !width || !height)
+    return false;
+  if ((RoundUp(width, atlas->Round) * bits) % 8)
+    return false;
+
+  uint16_t slot = Slot(atlas, name, hash);
+  if (atlas->Index[slot])
+    return false;
+
+  EVE_AtlasIcon *icon = &atlas->Icons[atlas->IconCount];
+  icon->Name = name;
+  icon->Pixels = pixels;
+  icon->Hash = hash;
+  icon->Width = width;
+  icon->Height = height;
+  icon->Format = format;
+  atlas->Index[slot] = ++atlas->IconCount;
+  return true;
+}
+
+// Strip for an icon, a new one when no strip of its cell size has room
+static int Place(EVE_Atlas *atlas, const EVE_AtlasIcon *icon)
+{
+  uint16_t w = RoundUp(icon->Width, atlas->Round), h = RoundUp(icon->Height, atlas->Round);
+
+  for (int s = 0; s < atlas->StripCount; s++)
+  {
+    EVE_AtlasStrip *strip = &atlas->Strips[s];
+    if (strip->Format == icon->Format && strip->Width == w && strip->Height == h &&
+        strip->Cells < EVE_ATLAS_CELLS)
+      return s;
+  }
+  if (atlas->StripCount >= EVE_ATLAS_STRIPS || atlas->StripCount >= atlas->HandleCount)
+    return -1;
+
+  EVE_AtlasStrip *strip = &atlas->Strips[atlas->StripCount];
+  strip->Handle = atlas->Handles[atlas->StripCount];
+  strip->Format = icon->Format;
+  strip->Width = w;
+  strip->Height = h;
+  strip->LineStride = (uint16_t)(w * Bitmap_BitsPerPixel(icon->Format) / 8);
+  strip->Cells = 0;
+  return atlas->StripCount++;
+}
+
+// Pack a strip's icons on the host and write the whole strip at once
+static bool Upload(EVE_Atlas *atlas, int s)
+{
+  EVE_AtlasStrip *strip = &atlas->Strips[s];
+  uint32_t cellBytes = (uint32_t)strip->LineStride * strip->Height;
+  uint32_t bytes = cellBytes * strip->Cells;
+  uint8_t *buffer = calloc(bytes, 1);
+
+  if (!buffer)
+    return false;
+  strip->Region = EVE_RamG_Alloc(bytes);
+  if (strip->Region < 0)
+  {
+    free(buffer);
+    return false;
+  }
+
+  uint32_t bits = Bitmap_BitsPerPixel(strip->Format);
+  for (int i = 0; i < atlas->IconCount; i++)
+  {
+    const EVE_AtlasIcon *icon = &atlas->Icons[i];
+    if (icon->Strip != s)
+      continue;
+    uint32_t row = (icon->Width * bits + 7) / 8;
+    uint8_t *cell = buffer + icon->Cell * cellBytes;
+    for (uint32_t y = 0; y < icon->Height; y++)
+      memcpy(cell + y * strip->LineStride, icon->Pixels + y * row, row);
+  }
+  WriteBlockRAM(EVE_RamG_Address(strip->Region), buffer, bytes);
+  atlas->BytesUploaded += bytes;
+  free(buffer);
+  return true;
+}
+
+bool EVE_Atlas_Build(EVE_Atlas *atlas)
+{
+  if (atlas->Built)
+    return true;
+
+  for (int i = 0; i < atlas->IconCount; i++)
+  {
+    EVE_AtlasIcon *icon = &atlas->Icons[i];
+    int s = Place(atlas, icon);
+    if (s < 0)
+    {
+      EVE_Atlas_Free(atlas);
+      return false;
+    }
+    icon->Strip = (uint8_t)s;
+    icon->Cell = atlas->Strips[s].Cells++;
+  }
+  for (int s = 0; s < atlas->StripCount; s++)
+  {
+    if (!Upload(atlas, s))
+    {
+      EVE_Atlas_Free(atlas);
+      return false;
+    }
+  }
+  atlas->Built = true;
+  return true;
+}
+
+void EVE_Atlas_Free(EVE_Atlas *atlas)
+{
+  for (int s = 0; s < atlas->StripCount; s++)
+  {
+    EVE_RamG_Free(atlas->Strips[s].Region);
+    atlas->Strips[s].Region = -1;
+    atlas->Strips[s].Cells = 0;
+  }
+  atlas->StripCount = 0;
+  atlas->Built = false;
+}
+
+int EVE_Atlas_Find(const EVE_Atlas *atlas, const char *name)
+{
+  uint16_t slot = Slot(atlas, name, FNV1a(name));
+  return atlas->Index[slot] - 1;
+}
+
+const EVE_AtlasIcon *EVE_Atlas_Icon(const EVE_Atlas *atlas, int id)
+{
+  return (id >= 0 && id < atlas->IconCount) ? &atlas->Icons[id] : NULL;
+}
+
+void EVE_Atlas_Setup(const EVE_Atlas *atlas)
+{
+  for (int s = 0; s < atlas->StripCount; s++)
+  {
+    const EVE_AtlasStrip *strip = &atlas->Strips[s];
+    uint32_t dl[] = {
+        BITMAP_HANDLE(strip->Handle),
+        BITMAP_SOURCE(EVE_RamG_Address(strip->Region)),
+        BITMAP_LAYOUT(strip->Format, strip->LineStride, strip->Height),
+        BITMAP_LAYOUT_H(strip->LineStride, strip->Height),
+        BITMAP_SIZE(NEAREST, BORDER, BORDER, strip->Width, strip->Height),
+        BITMAP_SIZE_H(strip->Width, strip->Height),
+    };
+    Send_CMDs(dl, sizeof(dl) / sizeof(dl[0]));
+  }
+}
+
+void EVE_Atlas_Begin(EVE_Atlas *atlas)
+{
+  atlas->LastStrip = -1;
+  Send_CMD(SAVE_CONTEXT());
+  Send_CMD(VERTEXFORMAT(0));
+  Send_CMD(BEGIN(BITMAPS));
+}
+
+void EVE_Atlas_Draw(EVE_Atlas *atlas, int id, int16_t x, int16_t y)
+{
+  const EVE_AtlasIcon *icon = EVE_Atlas_Icon(atlas, id);
+
+  if (!icon || !atlas->Built)
+    return;
+
+  const EVE_AtlasStrip *strip = &atlas->Strips[icon->Strip];
+  if (x >= 0 && x < 512 && y >= 0 && y < 512)
+  {
+    // VERTEX2II carries the handle and cell itself.  It leaves the current handle alone, so the
+    // tracking is unchanged.
+    Send_CMD(VERTEX2II(x, y, strip->Handle, icon->Cell));
+    return;
+  }
+
+  if (atlas->LastStrip != icon->Strip)
+  {
+    Send_CMD(BITMAP_HANDLE(strip->Handle));
+    atlas->LastStrip = icon->Strip;
+  }
+  uint32_t dl[2] = {CELL(icon->Cell), VERTEX2F(x, y)};
+  Send_CMDs(dl, 2);
+}
+
+void EVE_Atlas_DrawNamed(EVE_Atlas *atlas, const char *name, int16_t x, int16_t y)
+{
+  EVE_Atlas_Draw(atlas, EVE_Atlas_Find(atlas, name), x, y);
+}
+
+void EVE_Atlas_End(EVE_Atlas *atlas)
+{
+  atlas->LastStrip = -1;
+  Send_CMD(END());
+  Send_CMD(RESTORE_CONTEXT());
+}
@@ -0,0 +1,105 @@
+#ifndef __EVE_ATLAS_H
+#define __EVE_ATLAS_H
+
+// Sprite atlases
+//
+// Packs many small images into a few RAM_G strips so they share bitmap handles.  A strip holds
+// images of one format and one cell size one after the other, which is the layout EVE's CELL
+// addresses: with BITMAP_LAYOUT set to one cell, CELL n draws the n-th image.  A strip holds up
+// to 128 cells and takes one bitmap handle and one upload, however many icons are in it.
+//
+// Images of different sizes go in different strips.  Passing round to EVE_Atlas_Init() pads the
+// cell sizes up to a multiple of round so near sizes share a strip, with the padding left
+// transparent (zero).
+//
+// Icons are looked up by name (an FNV-1a hash) once and then drawn by id.  Between
+// EVE_Atlas_Begin() and EVE_Atlas_End() an icon costs one VERTEX2II word when it is on the
+// first 512x512 pixels of the screen, otherwise CELL and VERTEX2F, plus BITMAP_HANDLE whenever the
+// strip changes.  The handle state of every strip is sent by EVE_Atlas_Setup().
+
+#include "eve.h"
+#include "eve_memory.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_ATLAS_ICONS 256
+#define EVE_ATLAS_STRIPS 16
+#define EVE_ATLAS_CELLS 128 // CELL is 7 bits
+
+  typedef struct
+  {
+    const char *Name;
+    const uint8_t *Pixels;
+    uint32_t Hash;
+    uint16_t Width, Height;
+    uint8_t Format;
+    uint8_t Strip;
+    uint8_t Cell;
+  } EVE_AtlasIcon;
+
+  typedef struct
+  {
+    uint8_t Handle;
+    uint8_t Format;
+    uint16_t Width, Height; // Cell size
+    uint16_t LineStride;
+    uint8_t Cells;
+    EVE_Region Region;
+  } EVE_AtlasStrip;
+
+  typedef struct
+  {
+    EVE_AtlasIcon Icons[EVE_ATLAS_ICONS];
+    uint16_t IconCount;
+    uint16_t Index[2 * EVE_ATLAS_ICONS]; // Hash table of icon + 1, 0 is empty
+    EVE_AtlasStrip Strips[EVE_ATLAS_STRIPS];
+    uint8_t StripCount;
+    const uint8_t *Handles; // Bitmap handles the strips may use, in order
+    uint8_t HandleCount;
+    uint16_t Round;
+    bool Built;
+    int16_t LastStrip; // Strip of the last icon drawn since EVE_Atlas_Begin()
+    uint32_t BytesUploaded;
+  } EVE_Atlas;
+
+  // handles lists the bitmap handles the atlas may use, one per strip.  round pads cell sizes to a
+  // multiple of it, 0 or 1 keeps the exact sizes.
+  void EVE_EXPORT EVE_Atlas_Init(EVE_Atlas *atlas,
+                                 const uint8_t *handles,
+                                 uint8_t handleCount,
+                                 uint16_t round);
+  // Add an image in format with rows packed tight.  name and pixels are not copied and have to
+  // stay valid until EVE_Atlas_Build().  Returns false if the atlas is full, already built, the
+  // name is taken or the rows are not whole bytes.
+  bool EVE_EXPORT EVE_Atlas_Add(EVE_Atlas *atlas,
+                                const char *name,
+                                const uint8_t *pixels,
+                                uint16_t width,
+                                uint16_t height,
+                                uint8_t format);
+  // Sort the images into strips, allocate them in RAM_G and upload each strip in one transfer.
+  // Returns false if there are more strips than handles or RAM_G is full.
+  bool EVE_EXPORT EVE_Atlas_Build(EVE_Atlas *atlas);
+  void EVE_EXPORT EVE_Atlas_Free(EVE_Atlas *atlas);
+
+  // Icon id for name, -1 if there is no such icon
+  int EVE_EXPORT EVE_Atlas_Find(const EVE_Atlas *atlas, const char *name);
+  const EVE_AtlasIcon EVE_EXPORT *EVE_Atlas_Icon(const EVE_Atlas *atlas, int id);
+
+  // Handle state for every strip, once per display list before the icons are drawn
+  void EVE_EXPORT EVE_Atlas_Setup(const EVE_Atlas *atlas);
+  // SAVE_CONTEXT, VERTEXFORMAT(0) and BEGIN(BITMAPS).  Coordinates are pixels until
+  // EVE_Atlas_End().
+  void EVE_EXPORT EVE_Atlas_Begin(EVE_Atlas *atlas);
+  void EVE_EXPORT EVE_Atlas_Draw(EVE_Atlas *atlas, int id, int16_t x, int16_t y);
+  void EVE_EXPORT EVE_Atlas_DrawNamed(EVE_Atlas *atlas, const char *name, int16_t x, int16_t y);
+  void EVE_EXPORT EVE_Atlas_End(EVE_Atlas *atlas);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
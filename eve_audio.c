@@ -0,0 +1,193 @@
+// Streaming audio playback through a looped RAM_G ring
+//
+// The player only tells us where it is (REG_PLAYBACK_READPTR), so the host keeps its own write
+// offset and a count of bytes written but not yet played.  The difference between two read
+// pointer samples is what was consumed in between; if that is more than was pending the player
+// ran into stale data and we count an underrun.
+
+#include "eve_audio.h"
+#include "hw_api.h"
+
+#define RING_GUARD 8 // Never fill the ring completely so write == read always means "empty"
+
+// Write a run of bytes into the ring, splitting at the wrap point
+static void WriteRing(EVE_AudioStream *stream, uint32_t offset, const uint8_t *data, uint32_t len)
+{
+  while (len)
+  {
+    uint32_t run = stream->RingSize - offset;
+    if (run > len)
+      run = len;
+    StartCoProTransfer(stream->RingAddress + offset, false);
+    HAL_SPI_WriteBuffer((uint8_t *)data, run);
+    HAL_SPI_Disable();
+    data += run;
+    len -= run;
+    offset = (offset + run) % stream->RingSize;
+  }
+}
+
+// Once the source is exhausted, overwrite everything past the end of the audio with silence so
+// the looping player does not replay old samples before we get around to stopping it.
+static void FillSilence(EVE_AudioStream *stream)
+{
+  uint32_t offset = stream->WriteOffset;
+  uint32_t remaining = stream->RingSize - stream->Pending;
+
+  memset(stream->Staging, stream->Silence, sizeof(stream->Staging));
+  while (remaining)
+  {
+    uint32_t n = remaining > sizeof(stream->Staging) ? sizeof(stream->Staging) : remaining;
+    WriteRing(stream, offset, stream->Staging, n);
+    offset = (offset + n) % stream->RingSize;
+    remaining -= n;
+  }
+}
+
+static uint32_t Fill(EVE_AudioStream *stream, uint32_t budget)
+{
+  uint32_t written = 0;
+
+  while (!stream->SourceDone && budget)
+  {
+    uint32_t room = stream->RingSize - RING_GUARD - stream->Pending;
+    uint32_t n = room;
+    if (n > budget)
+      n = budget;
+    if (n > sizeof(stream->Staging))
+      n = sizeof(stream->Staging);
+    if (!n)
+      break;
+
+    uint32_t got = stream->Source(stream->Context, stream->Staging, n);
+    if (!got)
+    {
+      stream->SourceDone = true;
+      FillSilence(stream);
+      break;
+    }
+    WriteRing(stream, stream->WriteOffset, stream->Staging, got);
+    stream->WriteOffset = (stream->WriteOffset + got) % stream->RingSize;
+    stream->Pending += got;
+    written += got;
+    budget -= got;
+  }
+  return written;
+}
+
+bool EVE_Audio_Open(EVE_AudioStream *stream,
+                    uint32_t ringSize,
+                    uint8_t format,
+                    uint16_t sampleRate,
+                    EVE_AudioSourceFn source,
+                    void *context)
+{
+  memset(stream, 0, sizeof(*stream));
+  ringSize &= ~7UL; // The player works in 8 byte units
+  if (ringSize <= RING_GUARD)
+    return false;
+
+  stream->Ring = EVE_RamG_Alloc(ringSize);
+  if (stream->Ring < 0)
+    return false;
+
+  stream->RingAddress = EVE_RamG_Address(stream->Ring);
+  stream->RingSize = ringSize;
+  stream->Format = format;
+  stream->SampleRate = sampleRate;
+  stream->Source = source;
+  stream->Context = context;
+  switch (format)
+  {
+  case ULAW_SAMPLES:
+    stream->Silence = 0xFF;
+    break;
+  case ADPCM_SAMPLES:
+    stream->Silence = 0x80; // +0 then -0: the decoder settles on its smallest step
+    break;
+  default:
+    stream->Silence = 0x00;
+    break;
+  }
+  return true;
+}
+
+void EVE_Audio_Start(EVE_AudioStream *stream)
+{
+  Fill(stream, stream->RingSize);
+
+  wr32(REG_PLAYBACK_START + RAM_REG, stream->RingAddress);
+  wr32(REG_PLAYBACK_LENGTH + RAM_REG, stream->RingSize);
+  wr16(REG_PLAYBACK_FREQ + RAM_REG, stream->SampleRate);
+  wr8(REG_PLAYBACK_FORMAT + RAM_REG, stream->Format);
+  wr8(REG_PLAYBACK_LOOP + RAM_REG, 1);
+  wr8(REG_PLAYBACK_PLAY + RAM_REG, 1);
+
+  stream->ReadOffset = 0;
+  stream->Playing = true;
+}
+
+uint32_t EVE_Audio_Service(EVE_AudioStream *stream, uint32_t maxBytes)
+{
+  if (!stream->Playing)
+    return 0;
+
+  uint32_t readPtr = (rd32(REG_PLAYBACK_READPTR + RAM_REG) & 0xFFFFF) - stream->RingAddress;
+  if (readPtr >= stream->RingSize)
+    readPtr = stream->ReadOffset; // Not ours (yet), leave things alone
+
+  uint32_t consumed = (readPtr + stream->RingSize - stream->ReadOffset) % stream->RingSize;
+  stream->ReadOffset = readPtr;
+  if (consumed > stream->Pending)
+  {
+    if (!stream->SourceDone)
+    {
+      // The player overtook us and is playing old samples.  Restart filling right behind it.
+      stream->Underruns++;
+      stream->WriteOffset = readPtr;
+    }
+    stream->Pending = 0;
+  }
+  else
+  {
+    stream->Pending -= consumed;
+  }
+
+  if (stream->SourceDone && !stream->Pending)
+  {
+    EVE_Audio_Stop(stream);
+    return 0;
+  }
+  return Fill(stream, maxBytes);
+}
+
+bool EVE_Audio_Finished(const EVE_AudioStream *stream)
+{
+  return stream->SourceDone && !stream->Playing;
+}
+
+void EVE_Audio_Stop(EVE_AudioStream *stream)
+{
+  // A zero length play request stops the player
+  wr32(REG_PLAYBACK_LENGTH + RAM_REG, 0);
+  wr8(REG_PLAYBACK_PLAY + RAM_REG, 1);
+  stream->Playing = false;
+}
+
+void EVE_Audio_Close(EVE_AudioStream *stream)
+{
+  if (stream->Playing)
+    EVE_Audio_Stop(stream);
+  EVE_RamG_Free(stream->Ring);
+  stream->Ring = -1;
+}
+
+void EVE_Audio_SetVolume(uint8_t volume)
+{
+  wr8(REG_VOL_PB + RAM_REG, volume);
+}
+
+uint32_t EVE_Audio_FileSource(void *context, uint8_t *buffer, uint32_t length)
+{
+  return (uint32_t)fread(buffer, 1, length, (FILE *)context);
+}
@@ -0,0 +1,78 @@
+#ifndef __EVE_AUDIO_H
+#define __EVE_AUDIO_H
+
+// Streaming audio playback
+//
+// EVE plays samples straight out of RAM_G using the REG_PLAYBACK_* registers.  With
+// REG_PLAYBACK_LOOP set the player wraps around its buffer forever, which turns a small region of
+// RAM_G into a ring: the host tops it up behind REG_PLAYBACK_READPTR and the stream can be as
+// long as the source feeding it.
+//
+// Nothing here blocks.  Call EVE_Audio_Service() from the main loop (once per frame is plenty)
+// with a byte budget and it does one register read plus one or two burst writes, so refills sit
+// in between display updates instead of stalling them.
+//
+// Size the ring for the longest gap between service calls: at 8kHz u-law a 4K ring lasts half a
+// second.
+
+#include "eve.h"
+#include "eve_memory.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_AUDIO_CHUNK 1024 // Host staging buffer used per burst write
+
+  // Fill buffer with up to length bytes of sample data.  Return the number of bytes written, 0
+  // means the stream has ended.
+  typedef uint32_t (*EVE_AudioSourceFn)(void *context, uint8_t *buffer, uint32_t length);
+
+  typedef struct
+  {
+    EVE_Region Ring;
+    uint32_t RingAddress;
+    uint32_t RingSize;
+    uint32_t WriteOffset; // Next ring offset the host will fill
+    uint32_t ReadOffset;  // Player position seen at the last service call
+    uint32_t Pending;     // Bytes written but not yet played
+    uint16_t SampleRate;
+    uint8_t Format;
+    uint8_t Silence;
+    bool Playing;
+    bool SourceDone;
+    uint32_t Underruns;
+    EVE_AudioSourceFn Source;
+    void *Context;
+    uint8_t Staging[EVE_AUDIO_CHUNK];
+  } EVE_AudioStream;
+
+  // Allocate the ring from RAM_G and attach a source.  Format is one of LINEAR_SAMPLES,
+  // ULAW_SAMPLES or ADPCM_SAMPLES.  Returns false if RAM_G is exhausted.
+  bool EVE_EXPORT EVE_Audio_Open(EVE_AudioStream *stream,
+                                 uint32_t ringSize,
+                                 uint8_t format,
+                                 uint16_t sampleRate,
+                                 EVE_AudioSourceFn source,
+                                 void *context);
+
+  // Prefill the ring and start the player
+  void EVE_EXPORT EVE_Audio_Start(EVE_AudioStream *stream);
+
+  // Refill up to maxBytes behind the play position.  Returns the number of bytes written.
+  uint32_t EVE_EXPORT EVE_Audio_Service(EVE_AudioStream *stream, uint32_t maxBytes);
+
+  bool EVE_EXPORT EVE_Audio_Finished(const EVE_AudioStream *stream);
+  void EVE_EXPORT EVE_Audio_Stop(EVE_AudioStream *stream);
+  void EVE_EXPORT EVE_Audio_Close(EVE_AudioStream *stream);
+  void EVE_EXPORT EVE_Audio_SetVolume(uint8_t volume);
+
+  // Ready made source for a FILE * opened in binary mode
+  uint32_t EVE_EXPORT EVE_Audio_FileSource(void *context, uint8_t *buffer, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,181 @@
+// Bridge tuning - time transfers against EVE and pick USB latency and chunk settings per profile
+
+#include "eve_bridge.h"
+
+#define MAX_REPEATS 32
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+// Candidates tried by EVE_Bridge_AutoTune()
+static const uint8_t Latencies[] = {1, 2, 4, 8, 16};
+static const uint32_t Chunks[] = {4096, 16384, 65536};
+
+static HAL_Tuning Profiles[EVE_PROFILE_COUNT];
+static bool ProfileSet[EVE_PROFILE_COUNT];
+static EVE_Profile Current = EVE_PROFILE_INTERACTIVE;
+static bool Applied; // Current is what the HAL was last given
+
+static uint32_t Median(uint32_t *times, uint32_t count)
+{
+  for (uint32_t i = 1; i < count; i++)
+  {
+    uint32_t t = times[i];
+    uint32_t j = i;
+    for (; j > 0 && times[j - 1] > t; j--)
+      times[j] = times[j - 1];
+    times[j] = t;
+  }
+  return count ? times[count / 2] : 0;
+}
+
+static uint32_t Clamp(uint32_t repeats)
+{
+  if (!repeats)
+    return 1;
+  return repeats > MAX_REPEATS ? MAX_REPEATS : repeats;
+}
+
+uint32_t EVE_Bridge_RoundTrip(uint32_t repeats)
+{
+  uint32_t times[MAX_REPEATS];
+
+  repeats = Clamp(repeats);
+  for (uint32_t r = 0; r < repeats; r++)
+  {
+    uint64_t start = HAL_Micros();
+    rd32(REG_ID + RAM_REG);
+    times[r] = (uint32_t)(HAL_Micros() - start);
+  }
+  return Median(times, repeats);
+}
+
+static uint32_t TimeRead(uint32_t address, uint8_t *buffer, uint32_t size)
+{
+  uint64_t start = HAL_Micros();
+  rdN(address, buffer, size);
+  return (uint32_t)(HAL_Micros() - start);
+}
+
+// Writes are queued by the bridge, the read after them only returns once they have gone out
+static uint32_t TimeWrite(uint32_t address, uint8_t *buffer, uint32_t size)
+{
+  uint64_t start = HAL_Micros();
+  StartCoProTransfer(address, false);
+  HAL_SPI_WriteBuffer(buffer, size);
+  HAL_SPI_Disable();
+  rd8(REG_ID + RAM_REG);
+  return (uint32_t)(HAL_Micros() - start);
+}
+
+void EVE_Bridge_Measure(uint32_t address,
+                        EVE_BridgeSample *samples,
+                        uint32_t count,
+                        uint32_t repeats)
+{
+  uint32_t reads[MAX_REPEATS];
+  uint32_t writes[MAX_REPEATS];
+  uint32_t largest = 0;
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (samples[i].Size > largest)
+      largest = samples[i].Size;
+  }
+  uint8_t *buffer = malloc(largest ? largest : 1);
+  if (!buffer)
+    return;
+  for (uint32_t i = 0; i < largest; i++)
+    buffer[i] = (uint8_t)(i * 7); // Not all zeros or ones, in case the bridge cares
+
+  repeats = Clamp(repeats);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    uint32_t size = samples[i].Size ? samples[i].Size : 1;
+    for (uint32_t r = 0; r < repeats; r++)
+    {
+      writes[r] = TimeWrite(address, buffer, size);
+      reads[r] = TimeRead(address, buffer, size);
+    }
+    samples[i].Read_us = Median(reads, repeats);
+    samples[i].Write_us = Median(writes, repeats);
+  }
+  free(buffer);
+}
+
+bool EVE_Bridge_AutoTune(uint32_t scratch)
+{
+  HAL_Tuning original;
+  HAL_Tuning best[EVE_PROFILE_COUNT];
+  uint32_t bestTime[EVE_PROFILE_COUNT] = {UINT32_MAX, UINT32_MAX};
+  EVE_BridgeSample sample = {EVE_BRIDGE_BULK_SIZE, 0, 0};
+
+  HAL_GetTuning(&original);
+  for (uint32_t l = 0; l < COUNT(Latencies); l++)
+  {
+    for (uint32_t c = 0; c < COUNT(Chunks); c++)
+    {
+      HAL_Tuning t = {Latencies[l], Chunks[c], Chunks[c]};
+      if (!HAL_SetTuning(&t))
+        continue;
+
+      uint32_t roundTrip = EVE_Bridge_RoundTrip(EVE_BRIDGE_REPEATS);
+      if (roundTrip < bestTime[EVE_PROFILE_INTERACTIVE])
+      {
+        bestTime[EVE_PROFILE_INTERACTIVE] = roundTrip;
+        best[EVE_PROFILE_INTERACTIVE] = t;
+      }
+      EVE_Bridge_Measure(scratch, &sample, 1, EVE_BRIDGE_REPEATS / 2);
+      if (sample.Read_us + sample.Write_us < bestTime[EVE_PROFILE_BULK])
+      {
+        bestTime[EVE_PROFILE_BULK] = sample.Read_us + sample.Write_us;
+        best[EVE_PROFILE_BULK] = t;
+      }
+    }
+  }
+
+  if (bestTime[EVE_PROFILE_BULK] == UINT32_MAX)
+  {
+    HAL_SetTuning(&original); // The bridge took none of them
+    return false;
+  }
+  EVE_Bridge_SetProfile(EVE_PROFILE_INTERACTIVE, &best[EVE_PROFILE_INTERACTIVE]);
+  EVE_Bridge_SetProfile(EVE_PROFILE_BULK, &best[EVE_PROFILE_BULK]);
+  Applied = false;
+  EVE_Bridge_Use(EVE_PROFILE_INTERACTIVE);
+  return true;
+}
+
+void EVE_Bridge_SetProfile(EVE_Profile profile, const HAL_Tuning *tuning)
+{
+  if (profile >= EVE_PROFILE_COUNT)
+    return;
+  Profiles[profile] = *tuning;
+  ProfileSet[profile] = true;
+  if (profile == Current && Applied)
+  {
+    Applied = false;
+    EVE_Bridge_Use(profile);
+  }
+}
+
+const HAL_Tuning *EVE_Bridge_Profile(EVE_Profile profile)
+{
+  if (profile >= EVE_PROFILE_COUNT || !ProfileSet[profile])
+    return NULL;
+  return &Profiles[profile];
+}
+
+void EVE_Bridge_Use(EVE_Profile profile)
+{
+  if (profile >= EVE_PROFILE_COUNT || !ProfileSet[profile])
+    return;
+  if (Applied && profile == Current)
+    return;
+  HAL_SetTuning(&Profiles[profile]);
+  Current = profile;
+  Applied = true;
+}
+
+EVE_Profile EVE_Bridge_Current(void)
+{
+  return Current;
+}
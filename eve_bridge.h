@@ -0,0 +1,67 @@
+#ifndef __EVE_BRIDGE_H
+#define __EVE_BRIDGE_H
+
+// USB bridge characterisation and tuning
+//
+// How fast the bridge moves data depends on the USB latency timer and transfer (chunk) sizes, and
+// the best values differ between short register traffic and bulk uploads.  EVE_Bridge_Measure()
+// times reads and writes of a range of sizes against EVE with the settings in use, which is what
+// the bridge_tune tool prints.  EVE_Bridge_AutoTune() tries the candidate settings and keeps two
+// profiles:
+//   EVE_PROFILE_INTERACTIVE  the lowest round trip time for register reads and small writes
+//   EVE_PROFILE_BULK         the highest throughput for EVE_BRIDGE_BULK_SIZE byte transfers
+// EVE_Bridge_Use() switches between them; the transport scheduler does so whenever its bulk
+// queue starts or runs dry.  Each switch costs a few USB control transfers, so it is meant for
+// the start and end of a burst of uploads, not for every transfer.
+//
+// Until a profile is set, by EVE_Bridge_AutoTune() or EVE_Bridge_SetProfile(), switching to it
+// does nothing and the bridge keeps its defaults.
+
+#include "eve.h"
+#include "hw_api.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_BRIDGE_BULK_SIZE 16384 // Transfer size bulk throughput is judged on
+#define EVE_BRIDGE_REPEATS 8       // Measurements per size, the median is kept
+
+  typedef enum
+  {
+    EVE_PROFILE_INTERACTIVE,
+    EVE_PROFILE_BULK,
+    EVE_PROFILE_COUNT
+  } EVE_Profile;
+
+  typedef struct
+  {
+    uint32_t Size;     // Bytes per transfer
+    uint32_t Read_us;  // Median time of one rdN() of Size bytes
+    uint32_t Write_us; // Median time of one burst write, including a read that confirms it landed
+  } EVE_BridgeSample;
+
+  // Median time of a 32 bit register read
+  uint32_t EVE_EXPORT EVE_Bridge_RoundTrip(uint32_t repeats);
+  // Time reads and writes of samples[i].Size bytes at address in RAM_G, which has to have room
+  // for the largest size and is overwritten
+  void EVE_EXPORT EVE_Bridge_Measure(uint32_t address,
+                                     EVE_BridgeSample *samples,
+                                     uint32_t count,
+                                     uint32_t repeats);
+
+  // Try the latency timers and chunk sizes with EVE_BRIDGE_BULK_SIZE bytes of RAM_G at scratch,
+  // which is overwritten, and set both profiles.  Leaves the interactive profile in use.
+  bool EVE_EXPORT EVE_Bridge_AutoTune(uint32_t scratch);
+  void EVE_EXPORT EVE_Bridge_SetProfile(EVE_Profile profile, const HAL_Tuning *tuning);
+  // NULL while the profile has not been set
+  const HAL_Tuning EVE_EXPORT *EVE_Bridge_Profile(EVE_Profile profile);
+  void EVE_EXPORT EVE_Bridge_Use(EVE_Profile profile);
+  EVE_Profile EVE_EXPORT EVE_Bridge_Current(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
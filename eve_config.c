@@ -0,0 +1,278 @@
+// Runtime configuration - display, board and touch from a file, environment or command line
+
+#include "eve_config.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct
+{
+  const char *Name;
+  int Value;
+  int Board; // The board the display comes on
+} Choice;
+
+static const Choice Displays[] = {
+    {"70_800x480", DISPLAY_70_800x480, BOARD_EVE3},
+    {"70_800x480_WG", DISPLAY_70_800x480_WG, BOARD_EVE3},
+    {"50_800x480", DISPLAY_50_800x480, BOARD_EVE3},
+    {"43_480x272", DISPLAY_43_480x272, BOARD_EVE3},
+    {"43_800x480", DISPLAY_43_800x480, BOARD_EVE3},
+    {"39_480x128", DISPLAY_39_480x128, BOARD_EVE3},
+    {"38_480x116", DISPLAY_38_480x116, BOARD_EVE3},
+    {"35_320x240", DISPLAY_35_320x240, BOARD_EVE3},
+    {"29_320x102", DISPLAY_29_320x102, BOARD_EVE3},
+    {"24_320x240", DISPLAY_24_320x240, BOARD_EVE3},
+    {"52_480x128", DISPLAY_52_480x128, BOARD_EVE3},
+    {"40_720x720", DISPLAY_40_720x720, BOARD_EVE4},
+    {"101_1280x800", DISPLAY_101_1280x800, BOARD_EVE4},
+    {"70_1024x600", DISPLAY_70_1024x600, BOARD_EVE4},
+    {"70_1024x600_WG", DISPLAY_70_1024x600_WG, BOARD_EVE4},
+    {"101_1024x600_ILI", DISPLAY_101_1024x600_ILI, BOARD_EVE4},
+    {"101_1024x600_GiX", DISPLAY_101_1024x600_GiX, BOARD_EVE4},
+};
+
+static const Choice Boards[] = {
+    {"EVE2", BOARD_EVE2, 0},
+    {"EVE3", BOARD_EVE3, 0},
+    {"EVE4", BOARD_EVE4, 0},
+};
+
+static const Choice Touches[] = {
+    {"TPN", TOUCH_TPN, 0},
+    {"TPR", TOUCH_TPR, 0},
+    {"TPC", TOUCH_TPC, 0},
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static bool Same(const char *a, const char *b)
+{
+  while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b))
+  {
+    a++;
+    b++;
+  }
+  return !*a && !*b;
+}
+
+static bool Prefixed(const char *name, const char *prefix)
+{
+  while (*prefix && toupper((unsigned char)*name) == *prefix)
+  {
+    name++;
+    prefix++;
+  }
+  return !*prefix && *name;
+}
+
+static const Choice *Find(const Choice *choices,
+                          size_t count,
+                          const char *prefix,
+                          const char *name)
+{
+  // Accept the displays.h name with its prefix too
+  if (Prefixed(name, prefix))
+    name += strlen(prefix);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    if (Same(choices[i].Name, name))
+      return &choices[i];
+  }
+  return NULL;
+}
+
+int EVE_Config_Display(const char *name)
+{
+  const Choice *c = Find(Displays, COUNT(Displays), "DISPLAY_", name);
+  return c ? c->Value : -1;
+}
+
+int EVE_Config_Board(const char *name)
+{
+  const Choice *c = Find(Boards, COUNT(Boards), "BOARD_", name);
+  return c ? c->Value : -1;
+}
+
+int EVE_Config_Touch(const char *name)
+{
+  const Choice *c = Find(Touches, COUNT(Touches), "TOUCH_", name);
+  return c ? c->Value : -1;
+}
+
+void EVE_Config_Usage(const char *program)
+{
+  printf("Usage: %s --display <display> [--board <board>] [--touch <touch>] [--config <file>]\n",
+         program ? program : "demo");
+  printf("  Also EVE_DISPLAY, EVE_BOARD, EVE_TOUCH, EVE_CONFIG or " EVE_CONFIG_FILE "\n");
+  printf("  display:");
+  for (size_t i = 0; i < COUNT(Displays); i++)
+    printf(" %s", Displays[i].Name);
+  printf("\n  board: EVE2 EVE3 EVE4 (default: the display's own)\n");
+  printf("  touch: TPN TPR TPC (default TPN)\n");
+}
+
+// Set key to value, from names where the message says it came from
+static bool Set(EVE_Config *config, const char *key, const char *value, const char *from)
+{
+  int *field;
+  int v;
+
+  if (Same(key, "display"))
+  {
+    field = &config->Display;
+    v = EVE_Config_Display(value);
+  }
+  else if (Same(key, "board"))
+  {
+    field = &config->Board;
+    v = EVE_Config_Board(value);
+  }
+  else if (Same(key, "touch"))
+  {
+    field = &config->Touch;
+    v = EVE_Config_Touch(value);
+  }
+  else
+  {
+    printf("ERROR: Unknown setting '%s' in %s\n", key, from);
+    return false;
+  }
+
+  if (v < 0)
+  {
+    printf("ERROR: Unknown %s '%s' in %s\n", key, value, from);
+    return false;
+  }
+  *field = v;
+  return true;
+}
+
+static char *Trim(char *s)
+{
+  while (isspace((unsigned char)*s))
+    s++;
+  char *end = s + strlen(s);
+  while (end > s && isspace((unsigned char)end[-1]))
+    *--end = 0;
+  return s;
+}
+
+// A missing file is only an error when it was asked for by name
+static bool ReadFile(EVE_Config *config, const char *path, bool required)
+{
+  FILE *f = fopen(path, "r");
+  char line[128];
+  bool ok = true;
+
+  if (!f)
+  {
+    if (required)
+      printf("ERROR: Can not open %s\n", path);
+    return !required;
+  }
+  while (ok && fgets(line, sizeof(line), f))
+  {
+    char *hash = strchr(line, '#');
+    if (hash)
+      *hash = 0;
+    char *text = Trim(line);
+    if (!*text)
+      continue;
+    char *equals = strchr(text, '=');
+    if (!equals)
+    {
+      printf("ERROR: Expected 'setting = value' in %s: %s\n", path, text);
+      ok = false;
+      break;
+    }
+    *equals = 0;
+    ok = Set(config, Trim(text), Trim(equals + 1), path);
+  }
+  fclose(f);
+  return ok;
+}
+
+bool EVE_Config_Load(EVE_Config *config, int argc, char **argv)
+{
+  static const char *Keys[] = {"display", "board", "touch"};
+  static const char *Variables[] = {"EVE_DISPLAY", "EVE_BOARD", "EVE_TOUCH"};
+  const char *program = argc > 0 ? argv[0] : NULL;
+  const char *file = getenv("EVE_CONFIG");
+  bool named = file != NULL;
+
+  config->Display = config->Board = config->Touch = -1;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--config") && i + 1 < argc)
+    {
+      file = argv[i + 1];
+      named = true;
+    }
+    else if (!strncmp(argv[i], "--config=", 9))
+    {
+      file = argv[i] + 9;
+      named = true;
+    }
+  }
+  if (!ReadFile(config, named ? file : EVE_CONFIG_FILE, named))
+    return false;
+
+  for (size_t k = 0; k < COUNT(Keys); k++)
+  {
+    const char *value = getenv(Variables[k]);
+    if (value && *value && !Set(config, Keys[k], value, Variables[k]))
+      return false;
+  }
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char *arg = argv[i];
+    if (!strcmp(arg, "--help") || !strcmp(arg, "-h"))
+    {
+      EVE_Config_Usage(program);
+      return false;
+    }
+    if (strncmp(arg, "--", 2))
+      continue; // Left for the demo
+
+    char key[16];
+    const char *value = strchr(arg, '=');
+    size_t length = value ? (size_t)(value - arg - 2) : strlen(arg + 2);
+    if (length >= sizeof(key))
+      continue;
+    memcpy(key, arg + 2, length);
+    key[length] = 0;
+    if (value)
+      value++;
+    else if (i + 1 < argc)
+      value = argv[++i];
+    if (Same(key, "config"))
+      continue;
+    if (!value || !Set(config, key, value, "the command line"))
+    {
+      EVE_Config_Usage(program);
+      return false;
+    }
+  }
+
+  if (config->Display < 0)
+  {
+    printf("ERROR: No display given\n");
+    EVE_Config_Usage(program);
+    return false;
+  }
+  if (config->Board < 0)
+  {
+    for (size_t i = 0; i < COUNT(Displays); i++)
+    {
+      if (Displays[i].Value == config->Display)
+        config->Board = Displays[i].Board;
+    }
+  }
+  if (config->Touch < 0)
+    config->Touch = TOUCH_TPN;
+  return true;
+}
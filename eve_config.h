@@ -0,0 +1,48 @@
+#ifndef __EVE_CONFIG_H
+#define __EVE_CONFIG_H
+
+// Runtime panel configuration
+//
+// Picks the display, board and touch values for EVE_Init() at run time, so one binary drives
+// every panel.  Each source overrides the one before it:
+//
+//   config file   "eve.conf" in the working directory, or the file named by EVE_CONFIG or
+//                 --config.  Lines of "display = 43_480x272", "board = EVE3", "touch = TPC",
+//                 '#' starts a comment.
+//   environment   EVE_DISPLAY, EVE_BOARD, EVE_TOUCH
+//   command line  --display 43_480x272 --board EVE3 --touch TPC (or --display=43_480x272)
+//
+// Names are those of displays.h with or without their prefix (DISPLAY_43_480x272 and 43_480x272
+// are the same) in any case.  Without a board the display's own is used, without a touch TPN.
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_CONFIG_FILE "eve.conf"
+
+  typedef struct
+  {
+    int Display;
+    int Board;
+    int Touch;
+  } EVE_Config;
+
+  // Fill config from the file, the environment and argv.  Prints what is wrong and the usage,
+  // then returns false, when no display was given or a value is not known.
+  bool EVE_EXPORT EVE_Config_Load(EVE_Config *config, int argc, char **argv);
+  void EVE_EXPORT EVE_Config_Usage(const char *program);
+
+  // Values from names, -1 if the name is not known
+  int EVE_EXPORT EVE_Config_Display(const char *name);
+  int EVE_EXPORT EVE_Config_Board(const char *name);
+  int EVE_EXPORT EVE_Config_Touch(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,407 @@
+// Command stream files - .ecmd writer, recorder and memory mapped player
+
+#include "eve_ecmd.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The file is little endian whatever the host is, and fields are not necessarily aligned
+static uint32_t Get32(const uint8_t *p)
+{
+  return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t Get16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void Put32(uint8_t *p, uint32_t value)
+{
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+  p[2] = (uint8_t)(value >> 16);
+  p[3] = (uint8_t)(value >> 24);
+}
+
+static void Put16(uint8_t *p, uint16_t value)
+{
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static void CopyName(char *dest, const char *name)
+{
+  memset(dest, 0, EVE_ECMD_NAME);
+  strncpy(dest, name, EVE_ECMD_NAME - 1);
+}
+
+// *** Writer
+
+void EVE_EcmdWriter_Init(EVE_EcmdWriter *writer, uint32_t *buffer, uint32_t capacity)
+{
+  memset(writer, 0, sizeof(*writer));
+  writer->Commands = buffer;
+  writer->Capacity = capacity;
+}
+
+int16_t EVE_EcmdWriter_Asset(EVE_EcmdWriter *writer, const char *name, uint32_t size)
+{
+  if (writer->Assets >= EVE_ECMD_ASSETS)
+  {
+    writer->Overflow = true;
+    return -1;
+  }
+  CopyName(writer->AssetName[writer->Assets], name);
+  writer->AssetSize[writer->Assets] = size;
+  return (int16_t)writer->Assets++;
+}
+
+bool EVE_EcmdWriter_Words(EVE_EcmdWriter *writer, const uint32_t *words, uint32_t count)
+{
+  if (writer->Recording || count > writer->Capacity - writer->Words)
+  {
+    writer->Overflow = true;
+    return false;
+  }
+  memcpy(writer->Commands + writer->Words, words, count * sizeof(uint32_t));
+  writer->Words += count;
+  return true;
+}
+
+bool EVE_EcmdWriter_Record(EVE_EcmdWriter *writer)
+{
+  // There is one capture buffer.  Taking it over from a frame (or another writer) would lose
+  // what that one has recorded so far.
+  if (writer->Recording || CoProCapture_Active())
+    return false;
+  CoProCapture_Start(writer->Commands + writer->Words, writer->Capacity - writer->Words);
+  writer->Recording = true;
+  return true;
+}
+
+bool EVE_EcmdWriter_Stop(EVE_EcmdWriter *writer)
+{
+  if (!writer->Recording)
+    return false; // Whatever is capturing now is not ours to stop
+
+  uint32_t count = CoProCapture_Stop();
+
+  writer->Recording = false;
+  if (count > writer->Capacity - writer->Words)
+  {
+    count = writer->Capacity - writer->Words;
+    writer->Overflow = true;
+  }
+  writer->Words += count;
+  return !writer->Overflow;
+}
+
+uint32_t EVE_EcmdWriter_Position(const EVE_EcmdWriter *writer)
+{
+  return writer->Words + (writer->Recording ? CoProCapture_Count() : 0);
+}
+
+bool EVE_EcmdWriter_Relocate(EVE_EcmdWriter *writer, uint32_t word, uint16_t asset, uint32_t mask)
+{
+  if (word >= EVE_EcmdWriter_Position(writer) || word >= writer->Capacity ||
+      asset >= writer->Assets || writer->Relocations >= EVE_ECMD_RELOCATIONS)
+  {
+    writer->Overflow = true;
+    return false;
+  }
+
+  EVE_EcmdRelocation *r = &writer->Relocation[writer->Relocations++];
+  r->Word = word;
+  r->Offset = writer->Commands[word] & mask;
+  r->Mask = mask;
+  r->Asset = asset;
+  return true;
+}
+
+bool EVE_EcmdWriter_Parameter(EVE_EcmdWriter *writer,
+                              const char *name,
+                              uint32_t word,
+                              uint32_t mask,
+                              uint8_t shift)
+{
+  if (word >= EVE_EcmdWriter_Position(writer) || writer->Parameters >= EVE_ECMD_PARAMETERS)
+  {
+    writer->Overflow = true;
+    return false;
+  }
+
+  EVE_EcmdParameter *p = &writer->Parameter[writer->Parameters++];
+  CopyName(p->Name, name);
+  p->Word = word;
+  p->Mask = mask;
+  p->Shift = shift;
+  return true;
+}
+
+uint32_t EVE_EcmdWriter_Size(const EVE_EcmdWriter *writer)
+{
+  return EVE_ECMD_HEADER_SIZE + writer->Assets * EVE_ECMD_ASSET_SIZE +
+         writer->Relocations * EVE_ECMD_RELOCATION_SIZE +
+         writer->Parameters * EVE_ECMD_PARAMETER_SIZE + writer->Words * 4;
+}
+
+void EVE_EcmdWriter_Serialize(const EVE_EcmdWriter *writer, uint8_t *out)
+{
+  memset(out, 0, EVE_EcmdWriter_Size(writer));
+
+  Put32(out, EVE_ECMD_MAGIC);
+  Put16(out + 4, EVE_ECMD_VERSION);
+  Put16(out + 6, writer->Assets);
+  Put16(out + 8, writer->Relocations);
+  Put16(out + 10, writer->Parameters);
+  Put32(out + 12, writer->Words);
+  out += EVE_ECMD_HEADER_SIZE;
+
+  for (uint16_t i = 0; i < writer->Assets; i++, out += EVE_ECMD_ASSET_SIZE)
+  {
+    memcpy(out, writer->AssetName[i], EVE_ECMD_NAME);
+    Put32(out + 20, writer->AssetSize[i]);
+  }
+  for (uint16_t i = 0; i < writer->Relocations; i++, out += EVE_ECMD_RELOCATION_SIZE)
+  {
+    const EVE_EcmdRelocation *r = &writer->Relocation[i];
+    Put32(out, r->Word);
+    Put32(out + 4, r->Offset);
+    Put32(out + 8, r->Mask);
+    Put16(out + 12, r->Asset);
+  }
+  for (uint16_t i = 0; i < writer->Parameters; i++, out += EVE_ECMD_PARAMETER_SIZE)
+  {
+    const EVE_EcmdParameter *p = &writer->Parameter[i];
+    memcpy(out, p->Name, EVE_ECMD_NAME);
+    Put32(out + 20, p->Word);
+    Put32(out + 24, p->Mask);
+    out[28] = p->Shift;
+  }
+  for (uint32_t i = 0; i < writer->Words; i++, out += 4)
+    Put32(out, writer->Commands[i]);
+}
+
+bool EVE_EcmdWriter_Save(const EVE_EcmdWriter *writer, const char *path)
+{
+  if (writer->Overflow || writer->Recording)
+    return false;
+
+  uint32_t size = EVE_EcmdWriter_Size(writer);
+  uint8_t *data = malloc(size);
+  if (!data)
+    return false;
+  EVE_EcmdWriter_Serialize(writer, data);
+
+  FILE *f = fopen(path, "wb");
+  bool ok = f && fwrite(data, 1, size, f) == size;
+  if (f && fclose(f))
+    ok = false;
+  free(data);
+  return ok;
+}
+
+// *** Player
+
+// Check the tables against the file and each other so that Bind(), Set() and Play() can trust
+// them
+static bool Parse(EVE_Ecmd *ecmd)
+{
+  uint8_t *p = ecmd->Data;
+
+  if (ecmd->Length < EVE_ECMD_HEADER_SIZE || Get32(p) != EVE_ECMD_MAGIC ||
+      Get16(p + 4) != EVE_ECMD_VERSION)
+    return false;
+  ecmd->Assets = Get16(p + 6);
+  ecmd->Relocations = Get16(p + 8);
+  ecmd->Parameters = Get16(p + 10);
+  ecmd->Words = Get32(p + 12);
+  if (ecmd->Assets > EVE_ECMD_ASSETS)
+    return false;
+
+  uint64_t size = EVE_ECMD_HEADER_SIZE + (uint64_t)ecmd->Assets * EVE_ECMD_ASSET_SIZE +
+                  (uint64_t)ecmd->Relocations * EVE_ECMD_RELOCATION_SIZE +
+                  (uint64_t)ecmd->Parameters * EVE_ECMD_PARAMETER_SIZE +
+                  (uint64_t)ecmd->Words * 4;
+  if (size > ecmd->Length)
+    return false;
+
+  ecmd->AssetTable = p + EVE_ECMD_HEADER_SIZE;
+  ecmd->RelocationTable = ecmd->AssetTable + ecmd->Assets * EVE_ECMD_ASSET_SIZE;
+  ecmd->ParameterTable = ecmd->RelocationTable + ecmd->Relocations * EVE_ECMD_RELOCATION_SIZE;
+  ecmd->Commands = ecmd->ParameterTable + ecmd->Parameters * EVE_ECMD_PARAMETER_SIZE;
+
+  for (uint16_t i = 0; i < ecmd->Assets; i++)
+  {
+    if (ecmd->AssetTable[i * EVE_ECMD_ASSET_SIZE + EVE_ECMD_NAME - 1])
+      return false; // Name not terminated
+    ecmd->Base[i] = EVE_ECMD_UNBOUND;
+  }
+  for (uint16_t i = 0; i < ecmd->Relocations; i++)
+  {
+    const uint8_t *r = ecmd->RelocationTable + i * EVE_ECMD_RELOCATION_SIZE;
+    if (Get32(r) >= ecmd->Words || Get16(r + 12) >= ecmd->Assets)
+      return false;
+  }
+  for (uint16_t i = 0; i < ecmd->Parameters; i++)
+  {
+    const uint8_t *q = ecmd->ParameterTable + i * EVE_ECMD_PARAMETER_SIZE;
+    if (q[EVE_ECMD_NAME - 1] || Get32(q + 20) >= ecmd->Words)
+      return false;
+  }
+  return true;
+}
+
+bool EVE_Ecmd_FromMemory(EVE_Ecmd *ecmd, uint8_t *data, uint32_t length)
+{
+  memset(ecmd, 0, sizeof(*ecmd));
+  ecmd->Data = data;
+  ecmd->Length = length;
+  return Parse(ecmd);
+}
+
+bool EVE_Ecmd_Open(EVE_Ecmd *ecmd, const char *path)
+{
+  memset(ecmd, 0, sizeof(*ecmd));
+
+  // Mapped copy on write, patches go to private pages and never back to the file
+#ifdef _WIN32
+  HANDLE file = CreateFileA(
+      path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  DWORD length = GetFileSize(file, NULL);
+  HANDLE mapping = length && length != INVALID_FILE_SIZE
+                       ? CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL)
+                       : NULL;
+  CloseHandle(file);
+  if (!mapping)
+    return false;
+  ecmd->Data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  if (!ecmd->Data)
+  {
+    CloseHandle(mapping);
+    return false;
+  }
+  ecmd->Mapping = mapping;
+  ecmd->Length = length;
+#else
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0)
+    return false;
+  if (fstat(fd, &st) || st.st_size <= 0 || (uint64_t)st.st_size > 0xFFFFFFFFUL)
+  {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  ecmd->Data = data;
+  ecmd->Mapping = data;
+  ecmd->Length = (uint32_t)st.st_size;
+#endif
+
+  if (!Parse(ecmd))
+  {
+    EVE_Ecmd_Close(ecmd);
+    return false;
+  }
+  return true;
+}
+
+void EVE_Ecmd_Close(EVE_Ecmd *ecmd)
+{
+  if (ecmd->Mapping)
+  {
+#ifdef _WIN32
+    UnmapViewOfFile(ecmd->Data);
+    CloseHandle(ecmd->Mapping);
+#else
+    munmap(ecmd->Data, ecmd->Length);
+#endif
+  }
+  memset(ecmd, 0, sizeof(*ecmd));
+}
+
+bool EVE_Ecmd_Asset(const EVE_Ecmd *ecmd, uint16_t index, const char **name, uint32_t *size)
+{
+  if (index >= ecmd->Assets)
+    return false;
+
+  const uint8_t *a = ecmd->AssetTable + index * EVE_ECMD_ASSET_SIZE;
+  if (name)
+    *name = (const char *)a;
+  if (size)
+    *size = Get32(a + 20);
+  return true;
+}
+
+// Replace the masked bits of command word index
+static void Patch(EVE_Ecmd *ecmd, uint32_t index, uint32_t mask, uint32_t value)
+{
+  uint8_t *word = ecmd->Commands + index * 4;
+  Put32(word, (Get32(word) & ~mask) | (value & mask));
+}
+
+bool EVE_Ecmd_Bind(EVE_Ecmd *ecmd, const char *asset, uint32_t address)
+{
+  for (uint16_t i = 0; i < ecmd->Assets; i++)
+  {
+    if (strcmp((const char *)ecmd->AssetTable + i * EVE_ECMD_ASSET_SIZE, asset))
+      continue;
+
+    // Relocations store their offset, so binding again simply overwrites the last address
+    ecmd->Base[i] = address;
+    for (uint16_t j = 0; j < ecmd->Relocations; j++)
+    {
+      const uint8_t *r = ecmd->RelocationTable + j * EVE_ECMD_RELOCATION_SIZE;
+      if (Get16(r + 12) == i)
+        Patch(ecmd, Get32(r), Get32(r + 8), address + Get32(r + 4));
+    }
+    return true;
+  }
+  return false;
+}
+
+bool EVE_Ecmd_Set(EVE_Ecmd *ecmd, const char *parameter, uint32_t value)
+{
+  bool found = false;
+
+  for (uint16_t i = 0; i < ecmd->Parameters; i++)
+  {
+    const uint8_t *q = ecmd->ParameterTable + i * EVE_ECMD_PARAMETER_SIZE;
+    if (strcmp((const char *)q, parameter))
+      continue;
+    Patch(ecmd, Get32(q + 20), Get32(q + 24), value << q[28]);
+    found = true;
+  }
+  return found;
+}
+
+bool EVE_Ecmd_Play(const EVE_Ecmd *ecmd)
+{
+  // CoProWrCmdBuf() goes straight to the FIFO, so inside a frame the stream would go out ahead of
+  // the frame's own commands
+  if (CoProCapture_Active())
+    return false;
+  for (uint16_t i = 0; i < ecmd->Assets; i++)
+  {
+    if (ecmd->Base[i] == EVE_ECMD_UNBOUND)
+      return false;
+  }
+  if (ecmd->Words)
+    CoProWrCmdBuf(ecmd->Commands, ecmd->Words * 4);
+  return true;
+}
@@ -0,0 +1,154 @@
+#ifndef __EVE_ECMD_H
+#define __EVE_ECMD_H
+
+// Command stream files (.ecmd)
+//
+// A screen authored offline and shipped as data instead of as C code.  The file holds a raw
+// coprocessor command stream together with the information needed to replay it somewhere else:
+//
+//   header      "ECMD", version, table sizes and the length of the command stream
+//   assets      name and size of each block of RAM_G the stream refers to
+//   relocations command words holding a RAM_G address, stored as an offset into an asset
+//   parameters  named fields of command words the application fills in (colours, positions ...)
+//   commands    little endian words, exactly as they go into the FIFO
+//
+// Everything is little endian and every table is a whole number of words, so the command stream
+// is word aligned within the file.
+//
+// EVE_EcmdWriter builds a file, either from words or by recording whatever a sequence of
+// Send_CMD() calls emits (built on CoProCapture_Start()).  EVE_Ecmd maps a file (mmap, or
+// MapViewOfFile on Windows) copy on write, patches relocations and parameters in place as they
+// are bound and set, and streams the commands to the FIFO straight out of the mapping in the
+// largest bursts CoProWrCmdBuf() can make.
+//
+//   EVE_Ecmd screen;
+//   EVE_Ecmd_Open(&screen, "home.ecmd");
+//   EVE_Ecmd_Bind(&screen, "logo", EVE_RamG_Address(logo));
+//   EVE_Ecmd_Set(&screen, "accent", 0x1A1AC0);
+//   EVE_Ecmd_Play(&screen);
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_ECMD_MAGIC 0x444D4345UL // "ECMD"
+#define EVE_ECMD_VERSION 1
+#define EVE_ECMD_NAME 20 // Name field, including the terminating 0
+#define EVE_ECMD_ASSETS 32
+#define EVE_ECMD_RELOCATIONS 256
+#define EVE_ECMD_PARAMETERS 64
+#define EVE_ECMD_UNBOUND 0xFFFFFFFFUL
+
+#define EVE_ECMD_HEADER_SIZE 16
+#define EVE_ECMD_ASSET_SIZE 24      // Name, size
+#define EVE_ECMD_RELOCATION_SIZE 16 // Word, offset, mask, asset, pad
+#define EVE_ECMD_PARAMETER_SIZE 32  // Name, word, mask, shift, pad
+
+// Masks for the address fields of the usual commands
+#define EVE_ECMD_MASK_WORD 0xFFFFFFFFUL   // A whole command argument, e.g. Cmd_SetBitmap()
+#define EVE_ECMD_MASK_SOURCE 0x000FFFFFUL // BITMAP_SOURCE()
+
+  typedef struct
+  {
+    uint32_t Word;   // Index into the command stream
+    uint32_t Offset; // Into the asset
+    uint32_t Mask;   // Bits of the word holding the address
+    uint16_t Asset;
+  } EVE_EcmdRelocation;
+
+  typedef struct
+  {
+    char Name[EVE_ECMD_NAME];
+    uint32_t Word;
+    uint32_t Mask; // Bits of the word the value goes into, after shifting
+    uint8_t Shift;
+  } EVE_EcmdParameter;
+
+  typedef struct
+  {
+    uint32_t *Commands; // Caller's buffer
+    uint32_t Capacity;  // In words
+    uint32_t Words;
+    bool Recording;
+    bool Overflow; // Something did not fit, Save() will refuse
+    uint16_t Assets;
+    uint16_t Relocations;
+    uint16_t Parameters;
+    char AssetName[EVE_ECMD_ASSETS][EVE_ECMD_NAME];
+    uint32_t AssetSize[EVE_ECMD_ASSETS];
+    EVE_EcmdRelocation Relocation[EVE_ECMD_RELOCATIONS];
+    EVE_EcmdParameter Parameter[EVE_ECMD_PARAMETERS];
+  } EVE_EcmdWriter;
+
+  typedef struct
+  {
+    uint8_t *Data; // The whole file
+    uint32_t Length;
+    uint16_t Assets;
+    uint16_t Relocations;
+    uint16_t Parameters;
+    uint32_t Words;
+    uint8_t *AssetTable;
+    uint8_t *RelocationTable;
+    uint8_t *ParameterTable;
+    uint8_t *Commands;
+    uint32_t Base[EVE_ECMD_ASSETS]; // RAM_G address of each asset, or EVE_ECMD_UNBOUND
+    void *Mapping;                  // Platform handle when the file is mapped
+  } EVE_Ecmd;
+
+  // Writer - buffer holds the command stream, capacity in words
+  void EVE_EXPORT EVE_EcmdWriter_Init(EVE_EcmdWriter *writer, uint32_t *buffer, uint32_t capacity);
+  // Declare an asset, returns its index or -1 if the table is full
+  int16_t EVE_EXPORT EVE_EcmdWriter_Asset(EVE_EcmdWriter *writer, const char *name, uint32_t size);
+  bool EVE_EXPORT EVE_EcmdWriter_Words(EVE_EcmdWriter *writer,
+                                       const uint32_t *words,
+                                       uint32_t count);
+  // Between Record() and Stop() Send_CMD() and Send_CMDs() append to the writer instead of going
+  // to the FIFO.  Record() returns false, and records nothing, while a capture is already running
+  // (inside EVE_Frame_Begin() / EVE_Frame_End(), say).  Stop() returns false if the buffer
+  // overflowed or the writer was not recording.
+  bool EVE_EXPORT EVE_EcmdWriter_Record(EVE_EcmdWriter *writer);
+  bool EVE_EXPORT EVE_EcmdWriter_Stop(EVE_EcmdWriter *writer);
+  // Index the next command word will have, also while recording
+  uint32_t EVE_EXPORT EVE_EcmdWriter_Position(const EVE_EcmdWriter *writer);
+  // Mark an already written word as holding an address in asset.  The masked bits of the word are
+  // taken as the offset into the asset.
+  bool EVE_EXPORT EVE_EcmdWriter_Relocate(EVE_EcmdWriter *writer,
+                                          uint32_t word,
+                                          uint16_t asset,
+                                          uint32_t mask);
+  bool EVE_EXPORT EVE_EcmdWriter_Parameter(EVE_EcmdWriter *writer,
+                                           const char *name,
+                                           uint32_t word,
+                                           uint32_t mask,
+                                           uint8_t shift);
+  // Bytes Serialize() writes
+  uint32_t EVE_EXPORT EVE_EcmdWriter_Size(const EVE_EcmdWriter *writer);
+  void EVE_EXPORT EVE_EcmdWriter_Serialize(const EVE_EcmdWriter *writer, uint8_t *out);
+  bool EVE_EXPORT EVE_EcmdWriter_Save(const EVE_EcmdWriter *writer, const char *path);
+
+  // Player - map a file, or use one already in writable memory
+  bool EVE_EXPORT EVE_Ecmd_Open(EVE_Ecmd *ecmd, const char *path);
+  bool EVE_EXPORT EVE_Ecmd_FromMemory(EVE_Ecmd *ecmd, uint8_t *data, uint32_t length);
+  void EVE_EXPORT EVE_Ecmd_Close(EVE_Ecmd *ecmd);
+  // Name and RAM_G size of asset index, false past the end
+  bool EVE_EXPORT EVE_Ecmd_Asset(const EVE_Ecmd *ecmd,
+                                 uint16_t index,
+                                 const char **name,
+                                 uint32_t *size);
+  // Place an asset at address and patch every word that refers to it
+  bool EVE_EXPORT EVE_Ecmd_Bind(EVE_Ecmd *ecmd, const char *asset, uint32_t address);
+  // Patch a parameter, every field of that name gets value
+  bool EVE_EXPORT EVE_Ecmd_Set(EVE_Ecmd *ecmd, const char *parameter, uint32_t value);
+  // Stream the commands to the FIFO.  False, and nothing sent, while an asset is unbound or a
+  // capture is running (inside EVE_Frame_Begin() / EVE_Frame_End(), say).
+  bool EVE_EXPORT EVE_Ecmd_Play(const EVE_Ecmd *ecmd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+// Display list fragments - recorded from RAM_DL into RAM_G, appended, patched through REG_MACRO
+
+#include "eve_fragment.h"
+
+// Let the coprocessor catch up and report how far into RAM_DL it has written
+static uint32_t DisplayListEnd(void)
+{
+  UpdateFIFO();
+  Wait4CoProFIFOEmpty();
+  return rd32(REG_CMD_DL + RAM_REG);
+}
+
+void EVE_Fragment_Begin(EVE_Fragment *fragment)
+{
+  memset(fragment, 0, sizeof(*fragment));
+  fragment->Region = -1;
+  fragment->Start = DisplayListEnd();
+}
+
+void EVE_Fragment_Slot(EVE_Fragment *fragment, uint8_t slot, uint32_t value)
+{
+  if (slot >= EVE_FRAGMENT_SLOTS)
+    return;
+  fragment->Slots |= 1 << slot;
+  EVE_Fragment_Set(fragment, slot, value);
+  Send_CMD(MACRO(slot));
+}
+
+bool EVE_Fragment_End(EVE_Fragment *fragment)
+{
+  uint32_t end = DisplayListEnd();
+
+  if (end <= fragment->Start)
+    return false;
+  fragment->Size = end - fragment->Start;
+  fragment->Region = EVE_RamG_Alloc(fragment->Size);
+  if (fragment->Region < 0)
+    return false;
+
+  Cmd_Memcpy(EVE_RamG_Address(fragment->Region), RAM_DL + fragment->Start, fragment->Size);
+  UpdateFIFO();
+  Wait4CoProFIFOEmpty(); // Before a CMD_DLSTART can clear RAM_DL under it
+  return true;
+}
+
+void EVE_Fragment_Free(EVE_Fragment *fragment)
+{
+  EVE_RamG_Free(fragment->Region);
+  fragment->Region = -1;
+  fragment->Size = 0;
+}
+
+void EVE_Fragment_Draw(const EVE_Fragment *fragment)
+{
+  if (fragment->Region >= 0)
+    Cmd_Append(EVE_RamG_Address(fragment->Region), fragment->Size);
+}
+
+void EVE_Fragment_Set(EVE_Fragment *fragment, uint8_t slot, uint32_t value)
+{
+  if (slot >= EVE_FRAGMENT_SLOTS)
+    return;
+  fragment->Values[slot] = value;
+  wr32(REG_MACRO_0 + RAM_REG + 4 * slot, value);
+}
@@ -0,0 +1,61 @@
+#ifndef __EVE_FRAGMENT_H
+#define __EVE_FRAGMENT_H
+
+// Cached display list fragments with patchable slots
+//
+// A fragment is a run of display list words recorded once, kept in RAM_G and added to later
+// display lists with CMD_APPEND (3 FIFO words, however long the fragment is).  Anything the
+// coprocessor can draw can be recorded, widgets included, since it is the coprocessor's output
+// in RAM_DL that is kept:
+//
+//   EVE_Fragment_Begin(&gauge);
+//   Cmd_Gauge(...);
+//   EVE_Fragment_Slot(&gauge, 0, COLOR_RGB(255, 0, 0)); // Patchable from here on
+//   Cmd_Text(...);
+//   EVE_Fragment_End(&gauge);
+//
+// A slot is a MACRO(0) or MACRO(1) word, which EVE replaces with REG_MACRO_0 or REG_MACRO_1 while
+// it draws.  Changing a slot is one register write, the fragment and the display list stay as
+// they are, and the change shows on the next refresh without a new display list.  There are only
+// the two registers, so every fragment that uses slot 0 shows the same value there.
+//
+// Recording flushes the FIFO to read REG_CMD_DL, so it is not for use while a frame is captured
+// by the frame scheduler.  Record fragments at start up, or between frames.
+
+#include "eve.h"
+#include "eve_memory.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_FRAGMENT_SLOTS 2
+
+  typedef struct
+  {
+    EVE_Region Region;
+    uint32_t Size;  // Bytes of display list
+    uint32_t Start; // REG_CMD_DL when recording began
+    uint8_t Slots;  // Bit n set when slot n is used
+    uint32_t Values[EVE_FRAGMENT_SLOTS];
+  } EVE_Fragment;
+
+  void EVE_EXPORT EVE_Fragment_Begin(EVE_Fragment *fragment);
+  // Put a slot into the fragment being recorded and give it its first value
+  void EVE_EXPORT EVE_Fragment_Slot(EVE_Fragment *fragment, uint8_t slot, uint32_t value);
+  // Copy what was recorded into RAM_G.  Returns false if nothing was recorded or RAM_G is full.
+  bool EVE_EXPORT EVE_Fragment_End(EVE_Fragment *fragment);
+  void EVE_EXPORT EVE_Fragment_Free(EVE_Fragment *fragment);
+
+  // Add the fragment to the display list being built
+  void EVE_EXPORT EVE_Fragment_Draw(const EVE_Fragment *fragment);
+  // Change a slot, a single register write.  value is a display list word, COLOR_RGB(),
+  // VERTEX2F() and so on.
+  void EVE_EXPORT EVE_Fragment_Set(EVE_Fragment *fragment, uint8_t slot, uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
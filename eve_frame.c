@@ -0,0 +1,129 @@
+// Frame scheduler - vsync paced display list swaps with the next frame built while EVE renders
+
+#include "eve_frame.h"
+#include "hw_api.h"
+
+// Stream a finished frame into the FIFO a free-space-sized piece at a time.  Free space is worked
+// out from our own write pointer so each piece costs one register read.  Once the first piece is
+// in, nothing else may write to the FIFO until the last one is.
+static void Submit(const uint32_t *data, uint32_t count)
+{
+  while (count)
+  {
+    uint16_t rd = rd16(REG_CMD_READ + RAM_REG);
+    if (rd == 0xFFF)
+    {
+      Wait4CoProFIFOEmpty(); // Reports the fault and resets the coprocessor
+      continue;
+    }
+
+    uint16_t used = (uint16_t)(FifoWriteLocation - rd) % FT_CMD_FIFO_SIZE;
+    uint32_t words = ((FT_CMD_FIFO_SIZE - FT_CMD_SIZE) - used) / FT_CMD_SIZE;
+    if (words > count)
+      words = count;
+    if (!words)
+      continue; // No idle hook here, anything it sent would land inside this frame
+
+    Send_CMDs(data, (uint16_t)words);
+    UpdateFIFO();
+    data += words;
+    count -= words;
+  }
+}
+
+void EVE_Frame_Init(EVE_FrameScheduler *frame, uint32_t *buffer, uint32_t capacity, uint32_t targetHz)
+{
+  uint32_t refresh = Display_RefreshRate(); // mHz
+
+  memset(frame, 0, sizeof(*frame));
+  frame->Buffer = buffer;
+  frame->Capacity = capacity;
+  frame->Interval = 1;
+  if (targetHz && refresh)
+    frame->Interval = (refresh + targetHz * 500) / (targetHz * 1000);
+  if (!frame->Interval)
+    frame->Interval = 1;
+}
+
+void EVE_Frame_SetIdle(EVE_FrameScheduler *frame, EVE_FrameIdleFn idle, void *context)
+{
+  frame->Idle = idle;
+  frame->IdleContext = context;
+}
+
+void EVE_Frame_Begin(EVE_FrameScheduler *frame)
+{
+  frame->BeginTime = HAL_Micros();
+  CoProCapture_Start(frame->Buffer, frame->Capacity);
+  Send_CMD(CMD_DLSTART);
+}
+
+bool EVE_Frame_End(EVE_FrameScheduler *frame)
+{
+  Send_CMD(DISPLAY());
+  Send_CMD(CMD_SWAP);
+  uint32_t count = CoProCapture_Stop();
+
+  uint64_t now = HAL_Micros();
+  frame->Stats.BuildTime_us = (uint32_t)(now - frame->BeginTime);
+
+  if (count > frame->Capacity)
+  {
+    frame->Stats.Overflows++;
+    return false;
+  }
+
+  // Wait for the pacing point.  REG_FRAMES counts panel refreshes, so this lines the swap up with
+  // the refresh after the one the previous frame went out on.
+  uint32_t frames = rd32(REG_FRAMES + RAM_REG);
+  frame->Stats.Slack_us = 0;
+  if (frame->Started)
+  {
+    uint32_t target = frame->LastFrame + frame->Interval;
+    if ((int32_t)(frames - target) < 0)
+    {
+      do
+      {
+        if (frame->Idle)
+          frame->Idle(frame->IdleContext);
+        frames = rd32(REG_FRAMES + RAM_REG);
+      } while ((int32_t)(frames - target) < 0);
+      frame->Stats.Slack_us = (uint32_t)(HAL_Micros() - now);
+    }
+    else
+    {
+      frame->Stats.Missed += (frames - frame->LastFrame) / frame->Interval - 1;
+    }
+  }
+
+  // Only the previous frame's swap is allowed to be outstanding, so never run more than a frame
+  // ahead of the display
+  if (frame->Started)
+  {
+    uint16_t rd;
+    while ((rd = rd16(REG_CMD_READ + RAM_REG)) != 0xFFF &&
+           (uint16_t)(rd - frame->SwapEnd) % FT_CMD_FIFO_SIZE >
+               (uint16_t)(FifoWriteLocation - frame->SwapEnd) % FT_CMD_FIFO_SIZE)
+    {
+      if (frame->Idle)
+        frame->Idle(frame->IdleContext);
+    }
+  }
+
+  Submit(frame->Buffer, count);
+  frame->SwapEnd = FifoWriteLocation;
+
+  now = HAL_Micros();
+  if (frame->Started)
+    frame->Stats.FrameTime_us = (uint32_t)(now - frame->LastSubmit);
+  frame->LastSubmit = now;
+  frame->LastFrame = frames;
+  frame->Started = true;
+  frame->Stats.Frames++;
+  return true;
+}
+
+const EVE_FrameStats *EVE_Frame_Stats(const EVE_FrameScheduler *frame)
+{
+  return &frame->Stats;
+}
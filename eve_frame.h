@@ -0,0 +1,77 @@
+#ifndef __EVE_FRAME_H
+#define __EVE_FRAME_H
+
+// Frame scheduler
+//
+// Paces display list swaps to the panel refresh and overlaps host and coprocessor work:
+//
+//   EVE_Frame_Begin(&frame);    // Commands from here on are captured on the host
+//   ... Send_CMD / Cmd_Text / EVE_Anim_Emit ...
+//   EVE_Frame_End(&frame);      // Waits for the pacing point, sends the frame, returns at once
+//
+// EVE_Frame_End() does not wait for the coprocessor to finish the frame it just sent.  The next
+// frame is built on the host while EVE is still busy, and the only wait is for the previous
+// frame's CMD_SWAP to leave the FIFO.  The target rate is a whole divisor of the panel refresh
+// rate (Display_RefreshRate()) and time is kept with REG_FRAMES.
+//
+// Time spent waiting for the pacing point and for the previous swap is handed to the idle
+// callback, which is a good place for EVE_Audio_Service() and other background transfers.  The
+// callback only runs before any of the new frame is in the FIFO, so it may send commands of its
+// own, as long as each one it starts is complete when it returns.  Waits for FIFO room while the
+// frame is going out do not call it.
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  typedef void (*EVE_FrameIdleFn)(void *context);
+
+  typedef struct
+  {
+    uint32_t Frames;       // Frames submitted
+    uint32_t Missed;       // Pacing points that passed without a new frame
+    uint32_t FrameTime_us; // Host time between the last two submissions
+    uint32_t BuildTime_us; // Host time between the last Begin and End
+    uint32_t Slack_us;     // Time the last frame waited for its pacing point
+    uint32_t Overflows;    // Frames that did not fit the capture buffer
+  } EVE_FrameStats;
+
+  typedef struct
+  {
+    uint32_t *Buffer;
+    uint32_t Capacity; // In words
+    uint32_t Interval; // Panel refreshes per frame
+    uint32_t LastFrame;
+    uint64_t LastSubmit;
+    uint64_t BeginTime;
+    uint16_t SwapEnd; // FIFO location just past the previous frame's CMD_SWAP
+    bool Started;
+    EVE_FrameIdleFn Idle;
+    void *IdleContext;
+    EVE_FrameStats Stats;
+  } EVE_FrameScheduler;
+
+  // buffer / capacity (in words) hold one frame while it is built.  targetHz is rounded to the
+  // nearest whole divisor of the panel refresh rate, 0 means every refresh.
+  void EVE_EXPORT EVE_Frame_Init(EVE_FrameScheduler *frame,
+                                 uint32_t *buffer,
+                                 uint32_t capacity,
+                                 uint32_t targetHz);
+  void EVE_EXPORT EVE_Frame_SetIdle(EVE_FrameScheduler *frame, EVE_FrameIdleFn idle, void *context);
+
+  // Starts capturing and emits CMD_DLSTART
+  void EVE_EXPORT EVE_Frame_Begin(EVE_FrameScheduler *frame);
+  // Emits DISPLAY() and CMD_SWAP, paces and submits.  Returns false if the frame was too big
+  // for the buffer and had to be dropped.
+  bool EVE_EXPORT EVE_Frame_End(EVE_FrameScheduler *frame);
+
+  const EVE_FrameStats EVE_EXPORT *EVE_Frame_Stats(const EVE_FrameScheduler *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,138 @@
+// Virtual bitmap handles - any number of bitmaps mapped onto the free physical handles by LRU
+
+#include "eve_handles.h"
+
+typedef struct
+{
+  EVE_Bitmap *Owner; // Bitmap whose state the handle holds, NULL for none
+  uint32_t LastUsed; // Tick of the last select, for LRU
+  uint32_t Frame;    // Display list the handle was last drawn in
+  bool Sent;         // Its state was sent in that display list
+} Handle;
+
+static Handle Handles[EVE_HANDLES_COUNT];
+static uint32_t Reserved = EVE_HANDLES_RESERVED;
+static uint32_t Frame = 1;
+static uint32_t Tick;
+static EVE_HandleStats Stats;
+
+void EVE_Bitmap_Init(EVE_Bitmap *bitmap,
+                     uint32_t source,
+                     uint8_t format,
+                     uint16_t width,
+                     uint16_t height)
+{
+  bitmap->Source = source;
+  bitmap->Format = format;
+  bitmap->Filter = NEAREST;
+  bitmap->WrapX = bitmap->WrapY = BORDER;
+  bitmap->LineStride = (uint16_t)((width * Bitmap_BitsPerPixel(format) + 7) / 8);
+  bitmap->Width = width;
+  bitmap->Height = height;
+  bitmap->Handle = -1;
+}
+
+void EVE_Handles_Init(uint32_t reserved)
+{
+  memset(Handles, 0, sizeof(Handles));
+  Reserved = reserved;
+  Frame = 1;
+}
+
+void EVE_Handles_Reserve(uint8_t handle)
+{
+  if (handle < EVE_HANDLES_COUNT)
+    Reserved |= 1UL << handle;
+}
+
+void EVE_Handles_Release(uint8_t handle)
+{
+  if (handle < EVE_HANDLES_COUNT)
+    Reserved &= ~(1UL << handle);
+}
+
+void EVE_Handles_Frame(void)
+{
+  Frame++;
+}
+
+// Free handle, or the least recently used one that may be rebound in this display list
+static int8_t Victim(void)
+{
+  uint32_t unusable = Reserved | Font_Handles();
+  int8_t victim = -1;
+
+  for (int8_t h = 0; h < EVE_HANDLES_COUNT; h++)
+  {
+    if (unusable & (1UL << h))
+      continue;
+    if (Handles[h].Frame == Frame && !Handles[h].Sent)
+      continue; // Drawn here with state from an earlier display list
+    if (!Handles[h].Owner)
+      return h;
+    if (victim < 0 || Handles[h].LastUsed < Handles[victim].LastUsed)
+      victim = h;
+  }
+  return victim;
+}
+
+int8_t EVE_Handles_Select(EVE_Bitmap *bitmap)
+{
+  int8_t h = bitmap->Handle;
+
+  if (h >= 0 && Handles[h].Owner == bitmap && !((Reserved | Font_Handles()) & (1UL << h)))
+  {
+    Stats.Hits++;
+    if (Handles[h].Frame != Frame)
+    {
+      Handles[h].Frame = Frame;
+      Handles[h].Sent = false;
+    }
+    Send_CMD(BITMAP_HANDLE(h));
+  }
+  else
+  {
+    h = Victim();
+    if (h < 0)
+    {
+      Stats.Failures++;
+      return -1;
+    }
+    if (Handles[h].Owner)
+    {
+      Stats.Evictions++;
+      if (Handles[h].Owner->Handle == h)
+        Handles[h].Owner->Handle = -1;
+    }
+    Stats.Binds++;
+
+    uint32_t dl[] = {
+        BITMAP_HANDLE(h),
+        BITMAP_SOURCE(bitmap->Source),
+        BITMAP_LAYOUT(bitmap->Format, bitmap->LineStride, bitmap->Height),
+        BITMAP_LAYOUT_H(bitmap->LineStride, bitmap->Height),
+        BITMAP_SIZE(bitmap->Filter, bitmap->WrapX, bitmap->WrapY, bitmap->Width, bitmap->Height),
+        BITMAP_SIZE_H(bitmap->Width, bitmap->Height),
+    };
+    Send_CMDs(dl, sizeof(dl) / sizeof(dl[0]));
+    Handles[h].Owner = bitmap;
+    Handles[h].Frame = Frame;
+    Handles[h].Sent = true;
+    bitmap->Handle = h;
+  }
+
+  Handles[h].LastUsed = ++Tick;
+  return h;
+}
+
+void EVE_Handles_Forget(EVE_Bitmap *bitmap)
+{
+  if (bitmap->Handle >= 0 && Handles[bitmap->Handle].Owner == bitmap)
+    Handles[bitmap->Handle].Owner = NULL;
+  bitmap->Handle = -1;
+}
+
+const EVE_HandleStats *EVE_Handles_Stats(void)
+{
+  return &Stats;
+}
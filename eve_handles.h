@@ -0,0 +1,77 @@
+#ifndef __EVE_HANDLES_H
+#define __EVE_HANDLES_H
+
+// Virtual bitmap handles
+//
+// EVE has 32 bitmap handles and several of them are spoken for: 15 is the coprocessor's scratch
+// handle for widgets, 16..31 hold the ROM fonts at reset, and custom fonts take more.  Here any
+// number of EVE_Bitmap descriptions share the rest.  EVE_Handles_Select() maps a bitmap onto a
+// physical handle, reusing the least recently used one, and sends BITMAP_SOURCE / LAYOUT / SIZE
+// only when that handle does not already hold the bitmap.  A screen that keeps drawing the same
+// bitmaps sends their state once and then only BITMAP_HANDLE.
+//
+// Handle state outlives the display list that set it, but EVE runs the whole display list for
+// every line it draws.  A handle drawn in the current display list on the strength of state
+// from an earlier one can not be rebound later in the same list, or its earlier uses would pick
+// up the new state.  Those handles are left alone until EVE_Handles_Frame() starts the next list.
+//
+// Handles that hold fonts (Font_Handles(), from Cmd_SetFont2() and Cmd_RomFont()) are never used.
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_HANDLES_COUNT 32
+#define EVE_HANDLES_RESERVED 0xFFFF8000UL // Handle 15 and the ROM fonts in 16..31
+
+  typedef struct
+  {
+    uint32_t Source;
+    uint8_t Format;
+    uint8_t Filter; // NEAREST or BILINEAR
+    uint8_t WrapX, WrapY;
+    uint16_t LineStride;
+    uint16_t Width, Height;
+    int8_t Handle; // Physical handle it was last bound to, -1 for none
+  } EVE_Bitmap;
+
+  typedef struct
+  {
+    uint32_t Hits;     // Selects that found the bitmap still bound
+    uint32_t Binds;    // Selects that had to send the bitmap state
+    uint32_t Evictions;
+    uint32_t Failures; // Selects with every usable handle pinned
+  } EVE_HandleStats;
+
+  // Describe an uncompressed bitmap, line stride worked out from the format
+  void EVE_EXPORT EVE_Bitmap_Init(EVE_Bitmap *bitmap,
+                                  uint32_t source,
+                                  uint8_t format,
+                                  uint16_t width,
+                                  uint16_t height);
+
+  // Start over with the given handles kept out of use (bit n for handle n).  Also needed after
+  // EVE is reset, since the handles then hold nothing.
+  void EVE_EXPORT EVE_Handles_Init(uint32_t reserved);
+  void EVE_EXPORT EVE_Handles_Reserve(uint8_t handle);
+  void EVE_EXPORT EVE_Handles_Release(uint8_t handle);
+  // Call after CMD_DLSTART, at the start of every display list
+  void EVE_EXPORT EVE_Handles_Frame(void);
+
+  // Bind bitmap to a handle and make it the current handle.  Returns the handle, which can also
+  // go in VERTEX2II, or -1 if no handle could be had.
+  int8_t EVE_EXPORT EVE_Handles_Select(EVE_Bitmap *bitmap);
+  // The bitmap changed or is going away, drop its binding so the state is sent again.  A bound
+  // bitmap has to be forgotten before its memory is reused, the handle table points at it.
+  void EVE_EXPORT EVE_Handles_Forget(EVE_Bitmap *bitmap);
+
+  const EVE_HandleStats EVE_EXPORT *EVE_Handles_Stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
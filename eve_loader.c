@@ -0,0 +1,171 @@
+// Progressive asset loading - manifest uploaded in priority order within a per frame budget
+
+#include "eve_loader.h"
+#include "hw_api.h"
+
+// Give back every region the loader took for assets, and make the allocated ones allocatable
+// again
+static void Release(EVE_LoaderAsset *assets, uint16_t count, const bool *allocated)
+{
+  for (uint16_t i = 0; i < count; i++)
+  {
+    if (assets[i].Region < 0)
+      continue;
+    EVE_RamG_Free(assets[i].Region);
+    assets[i].Region = -1;
+    if (allocated[i])
+      assets[i].Address = EVE_LOADER_ALLOCATE;
+  }
+}
+
+bool EVE_Loader_Init(EVE_Loader *loader,
+                     EVE_LoaderAsset *assets,
+                     uint16_t count,
+                     uint32_t frameBudget)
+{
+  bool allocated[EVE_LOADER_ASSETS] = {false};
+
+  memset(loader, 0, sizeof(*loader));
+  if (count > EVE_LOADER_ASSETS)
+    return false;
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    assets[i].Sent = 0;
+    assets[i].Loaded = false;
+    assets[i].Region = -1;
+  }
+
+  // Fixed addresses are reserved first, so nothing allocated below can land on top of them.  Two
+  // fixed assets that overlap, or one on memory already handed out, fail the manifest.
+  for (uint16_t i = 0; i < count; i++)
+  {
+    EVE_LoaderAsset *a = &assets[i];
+    if (a->Address != EVE_LOADER_ALLOCATE && !EVE_RamG_Reserve(a->Address, a->Length, &a->Region))
+    {
+      Release(assets, count, allocated);
+      return false;
+    }
+  }
+  for (uint16_t i = 0; i < count; i++)
+  {
+    EVE_LoaderAsset *a = &assets[i];
+    if (a->Address != EVE_LOADER_ALLOCATE)
+      continue;
+    a->Region = EVE_RamG_Alloc(a->Length);
+    if (a->Region < 0)
+    {
+      Release(assets, count, allocated); // So the manifest can be tried again
+      return false;
+    }
+    a->Address = EVE_RamG_Address(a->Region);
+    allocated[i] = true;
+  }
+
+  loader->Assets = assets;
+  loader->Count = count;
+  loader->FrameBudget = frameBudget;
+  loader->Started = HAL_Micros();
+  for (uint16_t i = 0; i < count; i++)
+  {
+    loader->Total += assets[i].Length;
+
+    // Insertion sort, equal priorities keep their manifest order
+    uint16_t pos = i;
+    while (pos > 0 && assets[loader->Order[pos - 1]].Priority > assets[i].Priority)
+    {
+      loader->Order[pos] = loader->Order[pos - 1];
+      pos--;
+    }
+    loader->Order[pos] = i;
+  }
+  return true;
+}
+
+// Send up to budget bytes of asset, firing its callback when it is complete
+static uint32_t Send(EVE_Loader *loader, EVE_LoaderAsset *asset, uint32_t budget)
+{
+  uint32_t sent = 0;
+
+  while (asset->Sent < asset->Length && sent < budget)
+  {
+    uint32_t n = asset->Length - asset->Sent;
+    if (n > budget - sent)
+      n = budget - sent;
+    if (n > EVE_LOADER_CHUNK)
+      n = EVE_LOADER_CHUNK;
+    WriteBlockRAM(asset->Address + asset->Sent, asset->Data + asset->Sent, n);
+    asset->Sent += n;
+    sent += n;
+  }
+  loader->Loaded += sent;
+
+  if (asset->Sent >= asset->Length && !asset->Loaded)
+  {
+    asset->Loaded = true;
+    if (asset->Ready)
+      asset->Ready(asset, asset->Context);
+  }
+  return sent;
+}
+
+static void Advance(EVE_Loader *loader)
+{
+  while (loader->Next < loader->Count && loader->Assets[loader->Order[loader->Next]].Loaded)
+    loader->Next++;
+  if (loader->Next >= loader->Count && !loader->LoadTime_us)
+    loader->LoadTime_us = (uint32_t)(HAL_Micros() - loader->Started);
+}
+
+void EVE_Loader_LoadNow(EVE_Loader *loader, uint8_t maxPriority)
+{
+  for (uint16_t i = 0; i < loader->Count; i++)
+  {
+    EVE_LoaderAsset *a = &loader->Assets[loader->Order[i]];
+    if (a->Priority > maxPriority)
+      break;
+    Send(loader, a, a->Length - a->Sent);
+  }
+  Advance(loader);
+}
+
+uint32_t EVE_Loader_Step(EVE_Loader *loader)
+{
+  uint32_t sent = 0;
+
+  Advance(loader);
+  while (loader->Next < loader->Count && sent < loader->FrameBudget)
+  {
+    sent += Send(loader, &loader->Assets[loader->Order[loader->Next]], loader->FrameBudget - sent);
+    Advance(loader);
+  }
+  return sent;
+}
+
+EVE_LoaderAsset *EVE_Loader_Find(const EVE_Loader *loader, const char *name)
+{
+  for (uint16_t i = 0; i < loader->Count; i++)
+  {
+    if (loader->Assets[i].Name && !strcmp(loader->Assets[i].Name, name))
+      return &loader->Assets[i];
+  }
+  return NULL;
+}
+
+bool EVE_Loader_IsReady(const EVE_Loader *loader, const char *name)
+{
+  const EVE_LoaderAsset *a = EVE_Loader_Find(loader, name);
+  return a && a->Loaded;
+}
+
+bool EVE_Loader_Done(const EVE_Loader *loader)
+{
+  return loader->Next >= loader->Count;
+}
+
+uint8_t EVE_Loader_Progress(const EVE_Loader *loader)
+{
+  if (!loader->Total)
+    return 100;
+  return (uint8_t)((uint64_t)loader->Loaded * 100 / loader->Total);
+}
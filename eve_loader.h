@@ -0,0 +1,81 @@
+#ifndef __EVE_LOADER_H
+#define __EVE_LOADER_H
+
+// Progressive asset loading
+//
+// Instead of uploading every font and bitmap before the first frame, the application hands the
+// loader a manifest and draws straight away.  EVE_Loader_LoadNow() uploads what the first screen
+// can not do without (a splash logo, say), and EVE_Loader_Step(), called once a frame, moves the
+// rest in priority order within a per frame byte budget.  Each asset's Ready callback fires when
+// it has landed, and until then screens draw a placeholder in its place (EVE_Loader_IsReady()).
+//
+// Assets either have a fixed RAM_G address, for data that points at itself like an xfont and its
+// glyphs, or are given one by the RAM_G allocator when the loader starts.  Their addresses are
+// known from the start, only the contents arrive later.
+
+#include "eve.h"
+#include "eve_memory.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_LOADER_ASSETS 64
+#define EVE_LOADER_ALLOCATE 0xFFFFFFFFUL // Address for an asset that can go anywhere
+#define EVE_LOADER_CHUNK 4096            // Largest single write, so a frame's budget is spread
+
+  struct EVE_LoaderAsset;
+  typedef void (*EVE_AssetReadyFn)(struct EVE_LoaderAsset *asset, void *context);
+
+  typedef struct EVE_LoaderAsset
+  {
+    const char *Name;
+    const uint8_t *Data;
+    uint32_t Length;
+    uint32_t Address; // RAM_G address, or EVE_LOADER_ALLOCATE.  Set by the loader when allocated.
+    uint8_t Priority; // Lower loads first
+    EVE_AssetReadyFn Ready;
+    void *Context;
+    EVE_Region Region; // Set by the loader
+    uint32_t Sent;
+    bool Loaded;
+  } EVE_LoaderAsset;
+
+  typedef struct
+  {
+    EVE_LoaderAsset *Assets;
+    uint16_t Count;
+    uint16_t Order[EVE_LOADER_ASSETS]; // Assets by priority
+    uint16_t Next;                     // Position in Order of the asset being loaded
+    uint32_t FrameBudget;              // Bytes per EVE_Loader_Step()
+    uint32_t Total;                    // Bytes in the manifest
+    uint32_t Loaded;                   // Bytes uploaded so far
+    uint64_t Started;
+    uint32_t LoadTime_us; // From EVE_Loader_Init() to the last asset, 0 until then
+  } EVE_Loader;
+
+  // Take a manifest of count assets (it has to stay valid), reserve the fixed addresses with the
+  // RAM_G allocator and allocate RAM_G for the assets that need it.  Returns false if there are
+  // too many assets, fixed assets overlap each other or memory already allocated, or RAM_G is
+  // full, and then leaves nothing allocated, with those addresses back at EVE_LOADER_ALLOCATE.
+  bool EVE_EXPORT EVE_Loader_Init(EVE_Loader *loader,
+                                  EVE_LoaderAsset *assets,
+                                  uint16_t count,
+                                  uint32_t frameBudget);
+  // Upload every asset with a priority up to maxPriority right away
+  void EVE_EXPORT EVE_Loader_LoadNow(EVE_Loader *loader, uint8_t maxPriority);
+  // Upload up to the frame budget.  Returns the bytes sent, 0 once everything is loaded.
+  uint32_t EVE_EXPORT EVE_Loader_Step(EVE_Loader *loader);
+
+  EVE_LoaderAsset EVE_EXPORT *EVE_Loader_Find(const EVE_Loader *loader, const char *name);
+  bool EVE_EXPORT EVE_Loader_IsReady(const EVE_Loader *loader, const char *name);
+  bool EVE_EXPORT EVE_Loader_Done(const EVE_Loader *loader);
+  // 0..100
+  uint8_t EVE_EXPORT EVE_Loader_Progress(const EVE_Loader *loader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
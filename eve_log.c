@@ -0,0 +1,237 @@
+// Logging - lock free ring of messages drained to a sink
+
+#include "eve_log.h"
+#include "eve_thread.h"
+#include "hw_api.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#define Load(p) InterlockedCompareExchange((volatile LONG *)(p), 0, 0)
+#define Store(p, v) InterlockedExchange((volatile LONG *)(p), (LONG)(v))
+#define Add(p, v) InterlockedExchangeAdd((volatile LONG *)(p), (LONG)(v))
+#define Swap(p, expected, value)                                                                  \
+  (InterlockedCompareExchange((volatile LONG *)(p), (LONG)(value), (LONG)(expected)) ==          \
+   (LONG)(expected))
+#else
+#define Load(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define Store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define Add(p, v) __atomic_fetch_add((p), (v), __ATOMIC_ACQ_REL)
+#define Swap(p, expected, value)                                                                  \
+  __extension__({                                                                                 \
+    uint32_t e = (expected);                                                                      \
+    __atomic_compare_exchange_n((p), &e, (value), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);     \
+  })
+#endif
+
+#define SLOT_MASK (EVE_LOG_SLOTS - 1)
+
+// Bounded queue after Dmitry Vyukov: a slot whose sequence equals the write position is free,
+// one past it holds a message
+typedef struct
+{
+  volatile uint32_t Sequence;
+  uint8_t Level;
+  uint64_t Time;
+  char Message[EVE_LOG_MESSAGE];
+} Slot;
+
+static Slot Slots[EVE_LOG_SLOTS];
+static volatile uint32_t Head; // Next position to write
+static uint32_t Tail;          // Next position to drain, only the drainer touches it
+static volatile uint32_t Ready;
+static volatile uint32_t Draining;
+static EVE_LogSink Sink;
+static void *SinkContext;
+static volatile uint32_t Level = EVE_LOG_LEVEL;
+static volatile uint32_t Window;   // Second the rate is being counted for
+static volatile uint32_t InWindow; // Messages so far in that second
+static volatile uint32_t Lost;     // Dropped or limited and not yet reported to the sink
+static EVE_LogStats Stats;
+static EVE_Future *Drainer;
+static volatile uint32_t DrainerRunning; // Drainer as seen from writers on other threads
+static volatile uint32_t DrainerStop;
+
+static void Print(uint8_t level, uint64_t time_us, const char *message, void *context)
+{
+  (void)time_us;
+  (void)context;
+  printf("%s%s\n", level == EVE_LOG_ERROR ? "ERROR: " : level == EVE_LOG_WARN ? "WARNING: " : "",
+         message);
+}
+
+static void HalLog(uint8_t level, const char *message)
+{
+  EVE_Log_Write(level, "%s", message);
+}
+
+static void Setup(void)
+{
+  if (Swap(&Ready, 0, 1))
+  {
+    for (uint32_t i = 0; i < EVE_LOG_SLOTS; i++)
+      Slots[i].Sequence = i;
+    Store(&Ready, 2);
+    atexit(EVE_Log_Flush);
+  }
+  while (Load(&Ready) != 2)
+    ; // Another thread is halfway through
+}
+
+void EVE_Log_Init(EVE_LogSink sink, void *context)
+{
+  Setup();
+  EVE_Log_Flush(); // What was queued went to the old sink
+  Sink = sink;
+  SinkContext = context;
+  HAL_SetLogger(HalLog);
+}
+
+void EVE_Log_SetLevel(uint8_t level)
+{
+  Store(&Level, level);
+}
+
+bool EVE_Log_WriteV(uint8_t level, const char *format, va_list args)
+{
+  if (level > Load(&Level))
+    return false;
+  Setup();
+
+#if EVE_LOG_RATE
+  // Errors are never limited.  They are rare, and a burst of warnings must not hide the one
+  // that explains it.
+  if (level != EVE_LOG_ERROR)
+  {
+    uint32_t second = (uint32_t)(HAL_Micros() / 1000000);
+    uint32_t window = Load(&Window);
+    if (second != window && Swap(&Window, window, second))
+      Store(&InWindow, 0);
+    if ((uint32_t)Add(&InWindow, 1) >= EVE_LOG_RATE)
+    {
+      Add(&Stats.RateLimited, 1);
+      Add(&Lost, 1);
+      return false;
+    }
+  }
+#endif
+
+  uint32_t position = Load(&Head);
+  Slot *slot;
+  for (;;)
+  {
+    slot = &Slots[position & SLOT_MASK];
+    int32_t diff = (int32_t)(Load(&slot->Sequence) - position);
+    if (diff == 0 && Swap(&Head, position, position + 1))
+      break;
+    if (diff < 0)
+    {
+      Add(&Stats.Dropped, 1);
+      Add(&Lost, 1);
+      return false;
+    }
+    position = Load(&Head);
+  }
+
+  slot->Level = level;
+  slot->Time = HAL_Micros();
+  vsnprintf(slot->Message, EVE_LOG_MESSAGE, format, args);
+  size_t length = strlen(slot->Message);
+  if (length && slot->Message[length - 1] == '\n')
+    slot->Message[length - 1] = 0;
+  Store(&slot->Sequence, position + 1);
+  Add(&Stats.Written, 1);
+
+  // With nobody draining, an error could sit in the ring until exit, or for good if the program
+  // is killed.  Print it now, as the synchronous logger did.
+  if (level == EVE_LOG_ERROR && !Sink && !Load(&DrainerRunning))
+    EVE_Log_Flush();
+  return true;
+}
+
+bool EVE_Log_Write(uint8_t level, const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  bool queued = EVE_Log_WriteV(level, format, args);
+  va_end(args);
+  return queued;
+}
+
+void EVE_Log_Flush(void)
+{
+  EVE_LogSink sink = Sink ? Sink : Print;
+
+  if (Load(&Ready) != 2 || !Swap(&Draining, 0, 1))
+    return;
+  for (;;)
+  {
+    Slot *slot = &Slots[Tail & SLOT_MASK];
+    if (Load(&slot->Sequence) != Tail + 1)
+      break;
+    sink(slot->Level, slot->Time, slot->Message, SinkContext);
+    Store(&slot->Sequence, Tail + EVE_LOG_SLOTS);
+    Tail++;
+  }
+
+  uint32_t lost = Load(&Lost);
+  if (lost)
+  {
+    char note[48];
+    Add(&Lost, 0U - lost);
+    snprintf(note, sizeof(note), "%lu log messages lost", (unsigned long)lost);
+    sink(EVE_LOG_WARN, HAL_Micros(), note, SinkContext);
+  }
+  Store(&Draining, 0);
+}
+
+void EVE_Log_Idle(void *context)
+{
+  (void)context;
+  EVE_Log_Flush();
+}
+
+static int Drain(void *context)
+{
+  uint32_t interval = (uint32_t)(uintptr_t)context;
+
+  while (!Load(&DrainerStop))
+  {
+    EVE_Log_Flush();
+    HAL_Delay(interval);
+  }
+  EVE_Log_Flush();
+  return 0;
+}
+
+bool EVE_Log_Start(uint32_t interval_ms)
+{
+  if (Drainer)
+    return true;
+  Setup();
+  Store(&DrainerStop, 0);
+  Drainer = EVE_Thread_Run(Drain, (void *)(uintptr_t)(interval_ms ? interval_ms : 10));
+  Store(&DrainerRunning, Drainer != NULL);
+  return Drainer != NULL;
+}
+
+void EVE_Log_Stop(void)
+{
+  if (!Drainer)
+    return;
+  Store(&DrainerStop, 1);
+  EVE_Future_Wait(Drainer);
+  Store(&DrainerRunning, 0);
+  EVE_Future_Free(Drainer);
+  Drainer = NULL;
+}
+
+EVE_LogStats EVE_Log_Stats(void)
+{
+  EVE_LogStats stats;
+  stats.Written = Load(&Stats.Written);
+  stats.Dropped = Load(&Stats.Dropped);
+  stats.RateLimited = Load(&Stats.RateLimited);
+  return stats;
+}
@@ -0,0 +1,79 @@
+#ifndef __EVE_LOG_H
+#define __EVE_LOG_H
+
+// Logging
+//
+// Messages go into a lock free ring of fixed size records and reach the sink (stdout unless
+// EVE_Log_Init() was given another) when the ring is drained: by EVE_Log_Flush(), by
+// EVE_Log_Idle() as a frame idle hook, by the thread EVE_Log_Start() runs, or at exit.  Writing
+// never blocks and never does I/O, so a slow serial console can no longer stall rendering.  When
+// the ring is full, or more than EVE_LOG_RATE messages arrive in a second, messages are dropped
+// and counted, and the sink is told how many were lost.  Errors do not count against the rate,
+// and while there is neither a sink nor a drain thread an error is printed as soon as it is
+// written, so a fault report is never left waiting in the ring.
+//
+// Levels above EVE_LOG_LEVEL are compiled out of the EVE_Error() ... EVE_Debug() macros
+// altogether, format strings included.  EVE_Log_SetLevel() filters further at run time.
+
+#include "eve.h"
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_LOG_ERROR 0
+#define EVE_LOG_WARN 1
+#define EVE_LOG_INFO 2
+#define EVE_LOG_DEBUG 3
+
+#ifndef EVE_LOG_LEVEL
+#define EVE_LOG_LEVEL EVE_LOG_INFO
+#endif
+
+#define EVE_LOG_SLOTS 64    // Power of two
+#define EVE_LOG_MESSAGE 160 // Longest message, longer ones are cut
+#define EVE_LOG_RATE 100    // Messages a second, 0 for no limit
+
+#define EVE_LOG(level, ...)                                                                       \
+  do                                                                                              \
+  {                                                                                               \
+    if ((level) <= EVE_LOG_LEVEL)                                                                 \
+      EVE_Log_Write((level), __VA_ARGS__);                                                        \
+  } while (0)
+#define EVE_Error(...) EVE_LOG(EVE_LOG_ERROR, __VA_ARGS__)
+#define EVE_Warn(...) EVE_LOG(EVE_LOG_WARN, __VA_ARGS__)
+#define EVE_Info(...) EVE_LOG(EVE_LOG_INFO, __VA_ARGS__)
+#define EVE_Debug(...) EVE_LOG(EVE_LOG_DEBUG, __VA_ARGS__)
+
+  // Called for each message, without a trailing newline, on the thread that drains the ring
+  typedef void (*EVE_LogSink)(uint8_t level, uint64_t time_us, const char *message, void *context);
+
+  typedef struct
+  {
+    uint32_t Written;
+    uint32_t Dropped;     // Ring full
+    uint32_t RateLimited; // Over EVE_LOG_RATE
+  } EVE_LogStats;
+
+  // Send messages to sink, NULL for stdout.  Also routes the HAL's messages through the log.
+  void EVE_EXPORT EVE_Log_Init(EVE_LogSink sink, void *context);
+  void EVE_EXPORT EVE_Log_SetLevel(uint8_t level);
+  // Queue a message, safe from any thread.  False if it was dropped or filtered.
+  bool EVE_EXPORT EVE_Log_Write(uint8_t level, const char *format, ...);
+  bool EVE_EXPORT EVE_Log_WriteV(uint8_t level, const char *format, va_list args);
+  // Hand every queued message to the sink.  Only one thread may drain at a time.
+  void EVE_EXPORT EVE_Log_Flush(void);
+  // EVE_FrameIdleFn that drains the ring
+  void EVE_EXPORT EVE_Log_Idle(void *context);
+  // Drain every interval_ms on a thread of its own, until EVE_Log_Stop()
+  bool EVE_EXPORT EVE_Log_Start(uint32_t interval_ms);
+  void EVE_EXPORT EVE_Log_Stop(void);
+  EVE_LogStats EVE_EXPORT EVE_Log_Stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+// Bitmap transforms computed on the host - 16.16 fixed point affine matrices
+
+#include "eve_matrix.h"
+#include <math.h>
+
+#define PI 3.14159265358979323846
+
+// 16.16 multiply with rounding
+static int32_t Mul(int32_t a, int32_t b)
+{
+  return (int32_t)(((int64_t)a * b + 0x8000) >> 16);
+}
+
+// Reduce a 16.16 value by shift bits with rounding
+static int32_t Round(int64_t v, int shift)
+{
+  return (int32_t)((v + ((int64_t)1 << (shift - 1))) >> shift);
+}
+
+// BITMAP_TRANSFORM_A/B/D/E hold a signed 17 bit field
+static bool Fits(int32_t v, int shift)
+{
+  int32_t r = Round(v, shift);
+  return r >= -65536 && r <= 65535;
+}
+
+// v reduced to its field, clamped to the field's range.  Clears ok when it had to clamp.
+static int32_t Field(int32_t v, int shift, bool *ok)
+{
+  int32_t r = Round(v, shift);
+
+  if (r < -65536 || r > 65535)
+  {
+    *ok = false;
+    return r < 0 ? -65536 : 65535;
+  }
+  return r;
+}
+
+void EVE_Matrix_Identity(EVE_Matrix *m)
+{
+  m->A = m->E = 65536;
+  m->B = m->C = m->D = m->F = 0;
+}
+
+void EVE_Matrix_Translate(EVE_Matrix *m, int32_t tx, int32_t ty)
+{
+  m->C += Mul(m->A, tx) + Mul(m->B, ty);
+  m->F += Mul(m->D, tx) + Mul(m->E, ty);
+}
+
+void EVE_Matrix_Scale(EVE_Matrix *m, int32_t sx, int32_t sy)
+{
+  m->A = Mul(m->A, sx);
+  m->D = Mul(m->D, sx);
+  m->B = Mul(m->B, sy);
+  m->E = Mul(m->E, sy);
+}
+
+void EVE_Matrix_Rotate(EVE_Matrix *m, uint32_t a)
+{
+  double angle = (a & 0xFFFF) * (2 * PI / 65536);
+  int32_t c = (int32_t)lround(cos(angle) * 65536);
+  int32_t s = (int32_t)lround(sin(angle) * 65536);
+  EVE_Matrix r = {c, -s, 0, s, c, 0};
+
+  EVE_Matrix_Multiply(m, m, &r);
+}
+
+void EVE_Matrix_RotateAround(EVE_Matrix *m, uint32_t a, int32_t cx, int32_t cy)
+{
+  EVE_Matrix_Translate(m, cx, cy);
+  EVE_Matrix_Rotate(m, a);
+  EVE_Matrix_Translate(m, -cx, -cy);
+}
+
+void EVE_Matrix_Multiply(EVE_Matrix *out, const EVE_Matrix *first, const EVE_Matrix *then)
+{
+  EVE_Matrix r;
+
+  r.A = Mul(first->A, then->A) + Mul(first->B, then->D);
+  r.B = Mul(first->A, then->B) + Mul(first->B, then->E);
+  r.C = Mul(first->A, then->C) + Mul(first->B, then->F) + first->C;
+  r.D = Mul(first->D, then->A) + Mul(first->E, then->D);
+  r.E = Mul(first->D, then->B) + Mul(first->E, then->E);
+  r.F = Mul(first->D, then->C) + Mul(first->E, then->F) + first->F;
+  *out = r;
+}
+
+bool EVE_Matrix_Emit(const EVE_Matrix *m, uint32_t *out, bool precise)
+{
+  int64_t det = (int64_t)m->A * m->E - (int64_t)m->B * m->D; // 32.32
+  int32_t a = 65536, b = 0, c = 0, d = 0, e = 65536, f = 0;
+  bool ok = det != 0;
+
+  if (ok)
+  {
+    // Inverse of the 2x2 part, still 16.16, then the translation run back through it
+    // Scaled by multiplying, a left shift of a negative value is undefined
+    const int64_t one = (int64_t)1 << 32;
+    a = (int32_t)((m->E * one) / det);
+    b = (int32_t)(-(m->B * one) / det);
+    d = (int32_t)(-(m->D * one) / det);
+    e = (int32_t)((m->A * one) / det);
+    c = -(Mul(a, m->C) + Mul(b, m->F));
+    f = -(Mul(d, m->C) + Mul(e, m->F));
+  }
+
+  // 1.15 covers -2.0 up to just under 2.0 after rounding, anything bigger needs 8.8, which in
+  // turn stops at +-256
+  int p = precise && Fits(a, 1) && Fits(b, 1) && Fits(d, 1) && Fits(e, 1);
+  int shift = p ? 1 : 8;
+
+  out[0] = BITMAP_TRANSFORM_A(p, Field(a, shift, &ok));
+  out[1] = BITMAP_TRANSFORM_B(p, Field(b, shift, &ok));
+  out[2] = BITMAP_TRANSFORM_C(Round(c, 8));
+  out[3] = BITMAP_TRANSFORM_D(p, Field(d, shift, &ok));
+  out[4] = BITMAP_TRANSFORM_E(p, Field(e, shift, &ok));
+  out[5] = BITMAP_TRANSFORM_F(Round(f, 8));
+  return ok;
+}
+
+bool EVE_Matrix_Send(const EVE_Matrix *m, bool precise)
+{
+  uint32_t words[6];
+  bool ok = EVE_Matrix_Emit(m, words, precise);
+
+  Send_CMDs(words, 6);
+  return ok;
+}
+
+void EVE_Matrix_Read(EVE_Matrix *m)
+{
+  uint8_t r[6 * FT_CMD_SIZE];
+  int32_t v[6];
+
+  uint16_t Location = Cmd_GetMatrix();
+  UpdateFIFO();
+  Wait4CoProFIFOEmpty();
+  CoProResults((Location + FT_CMD_SIZE) % FT_CMD_FIFO_SIZE, r, sizeof(r));
+  for (int i = 0; i < 6; i++)
+  {
+    v[i] = (int32_t)((uint32_t)r[i * 4] | ((uint32_t)r[i * 4 + 1] << 8) |
+                     ((uint32_t)r[i * 4 + 2] << 16) | ((uint32_t)r[i * 4 + 3] << 24));
+  }
+  m->A = v[0];
+  m->B = v[1];
+  m->C = v[2];
+  m->D = v[3];
+  m->E = v[4];
+  m->F = v[5];
+}
+
+uint32_t EVE_Matrix_Compare(const EVE_Matrix *m)
+{
+  EVE_Matrix eve;
+  uint32_t worst = 0;
+
+  EVE_Matrix_Read(&eve);
+  int32_t h[6] = {m->A, m->B, m->C, m->D, m->E, m->F};
+  int32_t c[6] = {eve.A, eve.B, eve.C, eve.D, eve.E, eve.F};
+  for (int i = 0; i < 6; i++)
+  {
+    uint32_t diff = (uint32_t)(h[i] > c[i] ? (int64_t)h[i] - c[i] : (int64_t)c[i] - h[i]);
+    if (diff > worst)
+      worst = diff;
+  }
+  return worst;
+}
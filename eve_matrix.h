@@ -0,0 +1,62 @@
+#ifndef __EVE_MATRIX_H
+#define __EVE_MATRIX_H
+
+// Bitmap transforms computed on the host
+//
+// Mirrors the coprocessor's matrix commands (CMD_LOADIDENTITY, CMD_TRANSLATE, CMD_SCALE,
+// CMD_ROTATE, CMD_SETMATRIX) in 16.16 fixed point.  Composing on the host and writing the six
+// BITMAP_TRANSFORM words directly costs 6 FIFO words per sprite and no coprocessor time, where
+// the coprocessor route is typically 12 or more words plus the matrix math.  Matrices can also be
+// kept and reused, say one per rotation step.
+//
+// The matrix here is the same "current matrix" CMD_GETMATRIX reports: it maps bitmap
+// coordinates to screen coordinates, and each operation is applied to the bitmap before the
+// ones already in the matrix.  EVE_Matrix_Emit() writes its inverse, as CMD_SETMATRIX does.
+// EVE_Matrix_Compare() checks a host matrix against the coprocessor's.
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_FIXED(v) ((int32_t)((v)*65536)) // 16.16 fixed point from a constant
+
+  typedef struct
+  {
+    int32_t A, B, C; // 16.16 fixed point
+    int32_t D, E, F;
+  } EVE_Matrix;
+
+  void EVE_EXPORT EVE_Matrix_Identity(EVE_Matrix *m);
+  void EVE_EXPORT EVE_Matrix_Translate(EVE_Matrix *m, int32_t tx, int32_t ty);
+  void EVE_EXPORT EVE_Matrix_Scale(EVE_Matrix *m, int32_t sx, int32_t sy);
+  // Clockwise, a is in 1/65536ths of a turn like CMD_ROTATE
+  void EVE_EXPORT EVE_Matrix_Rotate(EVE_Matrix *m, uint32_t a);
+  // Rotate by a about the point (cx, cy) - the usual translate / rotate / translate sequence
+  void EVE_EXPORT EVE_Matrix_RotateAround(EVE_Matrix *m, uint32_t a, int32_t cx, int32_t cy);
+  // out = first * then, out may be either input
+  void EVE_EXPORT EVE_Matrix_Multiply(EVE_Matrix *out,
+                                      const EVE_Matrix *first,
+                                      const EVE_Matrix *then);
+
+  // Work out the six BITMAP_TRANSFORM_A-F words for m.  With precise set, A B D E use the 1.15
+  // format when they fit (BT81x only, FT81x ignores the precision bit).  Returns false if m can
+  // not be inverted, out then holds the identity, or if a coefficient of the inverse is beyond
+  // the +-256 of 8.8, out then holds it clamped.
+  bool EVE_EXPORT EVE_Matrix_Emit(const EVE_Matrix *m, uint32_t *out, bool precise);
+  // Emit straight into the command FIFO
+  bool EVE_EXPORT EVE_Matrix_Send(const EVE_Matrix *m, bool precise);
+
+  // Read the coprocessor's current matrix with CMD_GETMATRIX.  Flushes the FIFO.
+  void EVE_EXPORT EVE_Matrix_Read(EVE_Matrix *m);
+  // Largest difference between m and the coprocessor's current matrix, in 1/65536ths.
+  // 0 means the host matrix is bit exact.
+  uint32_t EVE_EXPORT EVE_Matrix_Compare(const EVE_Matrix *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
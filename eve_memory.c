@@ -0,0 +1,431 @@
+// On-chip memory operations - RAM_G allocator and coprocessor memory commands
+//
+// The allocator is deliberately simple: a fixed table of regions, first fit, no headers stored in
+// EVE memory.  A display rarely has more than a few dozen assets in RAM_G, so walking the table is
+// far cheaper than a single SPI transaction.
+
+#include "eve_memory.h"
+#include "hw_api.h"
+
+#ifdef _MSC_VER
+#include <windows.h>
+#define Load(p) InterlockedCompareExchange((volatile LONG *)(p), 0, 0)
+#define Store(p, v) InterlockedExchange((volatile LONG *)(p), (LONG)(v))
+#define Swap(p, expected, value)                                                                  \
+  (InterlockedCompareExchange((volatile LONG *)(p), (LONG)(value), (LONG)(expected)) ==          \
+   (LONG)(expected))
+#else
+#define Load(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define Store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define Swap(p, expected, value)                                                                  \
+  __extension__({                                                                                 \
+    uint32_t e = (expected);                                                                      \
+    __atomic_compare_exchange_n((p), &e, (value), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);     \
+  })
+#endif
+
+typedef struct
+{
+  uint32_t Address;
+  uint32_t Size;
+  bool Used;
+  bool Fixed; // Reserved at a given address, defragmenting leaves it where it is
+} RamGRegion;
+
+static RamGRegion Regions[EVE_RAMG_MAX_REGIONS];
+static uint32_t ArenaBase = RAM_G;
+static uint32_t ArenaSize = RAM_G_WORKING - RAM_G;
+
+static uint32_t AlignUp(uint32_t value)
+{
+  return (value + (EVE_RAMG_ALIGN - 1)) & ~(uint32_t)(EVE_RAMG_ALIGN - 1);
+}
+
+static bool ValidRegion(EVE_Region region)
+{
+  return region >= 0 && region < EVE_RAMG_MAX_REGIONS && Regions[region].Used;
+}
+
+// Collect the used regions ordered by address.  Returns how many there are.
+static int SortedRegions(EVE_Region *out)
+{
+  int count = 0;
+
+  for (EVE_Region i = 0; i < EVE_RAMG_MAX_REGIONS; i++)
+  {
+    if (!Regions[i].Used)
+      continue;
+    int pos = count++;
+    while (pos > 0 && Regions[out[pos - 1]].Address > Regions[i].Address)
+    {
+      out[pos] = out[pos - 1];
+      pos--;
+    }
+    out[pos] = i;
+  }
+  return count;
+}
+
+void EVE_RamG_Init(uint32_t base, uint32_t size)
+{
+  memset(Regions, 0, sizeof(Regions));
+  ArenaBase = AlignUp(base);
+  ArenaSize = size > ArenaBase - base ? size - (ArenaBase - base) : 0; // Nothing left past padding
+}
+
+EVE_Region EVE_RamG_Alloc(uint32_t size)
+{
+  EVE_Region order[EVE_RAMG_MAX_REGIONS];
+  EVE_Region slot = -1;
+  uint32_t candidate = ArenaBase;
+
+  if (!size)
+    return -1;
+  size = AlignUp(size);
+
+  for (EVE_Region i = 0; i < EVE_RAMG_MAX_REGIONS; i++)
+  {
+    if (!Regions[i].Used)
+    {
+      slot = i;
+      break;
+    }
+  }
+  if (slot < 0)
+    return -1; // Out of region handles
+
+  int count = SortedRegions(order);
+  for (int i = 0; i <= count; i++)
+  {
+    uint32_t gapEnd = (i < count) ? Regions[order[i]].Address : ArenaBase + ArenaSize;
+    if (gapEnd - candidate >= size)
+    {
+      Regions[slot].Address = candidate;
+      Regions[slot].Size = size;
+      Regions[slot].Used = true;
+      Regions[slot].Fixed = false;
+      return slot;
+    }
+    if (i < count)
+      candidate = Regions[order[i]].Address + Regions[order[i]].Size;
+  }
+  return -1; // Out of memory, a defragment may help
+}
+
+bool EVE_RamG_Reserve(uint32_t address, uint32_t size, EVE_Region *region)
+{
+  // Only the part inside the arena can clash, widened to the alignment the allocator keeps
+  uint32_t start = address < ArenaBase ? ArenaBase : address;
+  uint32_t end = address + size > ArenaBase + ArenaSize ? ArenaBase + ArenaSize : address + size;
+
+  *region = -1;
+  if (start >= end)
+    return true;
+  start &= ~(uint32_t)(EVE_RAMG_ALIGN - 1);
+  end = AlignUp(end);
+
+  EVE_Region slot = -1;
+  for (EVE_Region i = 0; i < EVE_RAMG_MAX_REGIONS; i++)
+  {
+    if (!Regions[i].Used)
+    {
+      if (slot < 0)
+        slot = i;
+      continue;
+    }
+    if (Regions[i].Address < end && start < Regions[i].Address + Regions[i].Size)
+      return false; // Already handed out
+  }
+  if (slot < 0)
+    return false;
+
+  Regions[slot].Address = start;
+  Regions[slot].Size = end - start;
+  Regions[slot].Used = true;
+  Regions[slot].Fixed = true;
+  *region = slot;
+  return true;
+}
+
+void EVE_RamG_Free(EVE_Region region)
+{
+  if (ValidRegion(region))
+    Regions[region].Used = false;
+}
+
+uint32_t EVE_RamG_Address(EVE_Region region)
+{
+  return ValidRegion(region) ? Regions[region].Address : 0;
+}
+
+uint32_t EVE_RamG_Size(EVE_Region region)
+{
+  return ValidRegion(region) ? Regions[region].Size : 0;
+}
+
+uint32_t EVE_RamG_Available(void)
+{
+  uint32_t used = 0;
+
+  for (EVE_Region i = 0; i < EVE_RAMG_MAX_REGIONS; i++)
+  {
+    if (Regions[i].Used)
+      used += Regions[i].Size;
+  }
+  return ArenaSize - used;
+}
+
+uint32_t EVE_RamG_LargestFree(void)
+{
+  EVE_Region order[EVE_RAMG_MAX_REGIONS];
+  uint32_t largest = 0;
+  uint32_t cursor = ArenaBase;
+  int count = SortedRegions(order);
+
+  for (int i = 0; i <= count; i++)
+  {
+    uint32_t gapEnd = (i < count) ? Regions[order[i]].Address : ArenaBase + ArenaSize;
+    if (gapEnd - cursor > largest)
+      largest = gapEnd - cursor;
+    if (i < count)
+      cursor = Regions[order[i]].Address + Regions[order[i]].Size;
+  }
+  return largest;
+}
+
+uint32_t EVE_RamG_Defragment(EVE_RamG_MoveFn moved, void *context)
+{
+  EVE_Region order[EVE_RAMG_MAX_REGIONS];
+  uint32_t cursor = ArenaBase;
+  uint32_t bytesMoved = 0;
+  int count = SortedRegions(order);
+
+  for (int i = 0; i < count; i++)
+  {
+    RamGRegion *r = &Regions[order[i]];
+    if (r->Address > cursor && !r->Fixed)
+    {
+      // Regions only ever slide down.  If source and destination overlap, copy in pieces no
+      // larger than the distance moved so no piece overwrites data it has yet to read.
+      uint32_t distance = r->Address - cursor;
+      uint32_t done = 0;
+      while (done < r->Size)
+      {
+        uint32_t piece = r->Size - done;
+        if (piece > distance)
+          piece = distance;
+        Wait4CoProFIFO(4 * FT_CMD_SIZE);
+        Cmd_Memcpy(cursor + done, r->Address + done, piece);
+        UpdateFIFO();
+        done += piece;
+      }
+      uint32_t old = r->Address;
+      r->Address = cursor;
+      bytesMoved += r->Size;
+      if (moved)
+        moved(order[i], old, cursor, context);
+    }
+    cursor = r->Address + r->Size;
+  }
+  if (bytesMoved)
+    Wait4CoProFIFOEmpty();
+  return bytesMoved;
+}
+
+void EVE_Mem_Fill(EVE_Region region, uint8_t value)
+{
+  if (ValidRegion(region))
+    Cmd_Memset(Regions[region].Address, value, Regions[region].Size);
+}
+
+void EVE_Mem_Clear(EVE_Region region)
+{
+  if (ValidRegion(region))
+    Cmd_Memzero(Regions[region].Address, Regions[region].Size);
+}
+
+void EVE_Mem_Copy(
+    EVE_Region dest, uint32_t destOffset, EVE_Region src, uint32_t srcOffset, uint32_t num)
+{
+  if (!ValidRegion(dest) || !ValidRegion(src))
+    return;
+  if (destOffset + num > Regions[dest].Size || srcOffset + num > Regions[src].Size)
+    return;
+  Cmd_Memcpy(Regions[dest].Address + destOffset, Regions[src].Address + srcOffset, num);
+}
+
+uint32_t EVE_Mem_CRC(uint32_t address, uint32_t num)
+{
+  uint16_t Location = Cmd_MemCRC(address, num);
+  UpdateFIFO();
+  Wait4CoProFIFOEmpty();
+  return CoProResult(Location, 3);
+}
+
+bool EVE_Mem_Verify(uint32_t address, const uint8_t *data, uint32_t num)
+{
+  return EVE_Mem_CRC(address, num) == EVE_CRC32(0, data, num);
+}
+
+static EVE_VerifyStats VerifyStats;
+
+// Write up to EVE_VERIFY_BATCH pieces, check them all in one round trip and resend the bad ones
+static bool VerifyBatch(uint32_t address, const uint8_t *data, uint32_t length)
+{
+  uint32_t crc[EVE_VERIFY_BATCH];
+  uint8_t results[EVE_VERIFY_BATCH * 4 * FT_CMD_SIZE];
+  uint32_t chunks = (length + EVE_VERIFY_CHUNK - 1) / EVE_VERIFY_CHUNK;
+  uint32_t pending = (chunks >= 32) ? 0xFFFFFFFFUL : ((1UL << chunks) - 1);
+
+  for (uint32_t i = 0; i < chunks; i++)
+  {
+    uint32_t size = (i == chunks - 1) ? length - i * EVE_VERIFY_CHUNK : EVE_VERIFY_CHUNK;
+    crc[i] = EVE_CRC32(0, data + i * EVE_VERIFY_CHUNK, size);
+  }
+  VerifyStats.Chunks += chunks;
+
+  for (int attempt = 0; pending && attempt <= EVE_VERIFY_RETRIES; attempt++)
+  {
+    uint32_t sent = 0;
+
+    for (uint32_t i = 0; i < chunks; i++)
+    {
+      if (!(pending & (1UL << i)))
+        continue;
+      uint32_t size = (i == chunks - 1) ? length - i * EVE_VERIFY_CHUNK : EVE_VERIFY_CHUNK;
+      StartCoProTransfer(address + i * EVE_VERIFY_CHUNK, false);
+      HAL_SPI_WriteBuffer((uint8_t *)data + i * EVE_VERIFY_CHUNK, size);
+      HAL_SPI_Disable();
+      if (attempt)
+        VerifyStats.Retries++;
+      sent++;
+    }
+
+    // One CMD_MEMCRC per piece, 4 words each, results land in the 4th word
+    Wait4CoProFIFO(sent * 4 * FT_CMD_SIZE);
+    uint16_t Location = FifoWriteLocation;
+    for (uint32_t i = 0; i < chunks; i++)
+    {
+      if (!(pending & (1UL << i)))
+        continue;
+      uint32_t size = (i == chunks - 1) ? length - i * EVE_VERIFY_CHUNK : EVE_VERIFY_CHUNK;
+      Cmd_MemCRC(address + i * EVE_VERIFY_CHUNK, size);
+    }
+    UpdateFIFO();
+    Wait4CoProFIFOEmpty();
+    CoProResults(Location, results, sent * 4 * FT_CMD_SIZE);
+
+    uint32_t r = 0;
+    for (uint32_t i = 0; i < chunks; i++)
+    {
+      if (!(pending & (1UL << i)))
+        continue;
+      const uint8_t *p = &results[r++ * 4 * FT_CMD_SIZE + 3 * FT_CMD_SIZE];
+      uint32_t eve = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+                     ((uint32_t)p[3] << 24);
+      if (eve == crc[i])
+        pending &= ~(1UL << i);
+    }
+  }
+
+  for (uint32_t i = 0; i < chunks; i++)
+  {
+    if (pending & (1UL << i))
+      VerifyStats.Failures++;
+  }
+  return !pending;
+}
+
+bool EVE_WriteVerified(uint32_t address, const uint8_t *data, uint32_t length)
+{
+  bool ok = true;
+
+  while (length)
+  {
+    uint32_t n = length;
+    if (n > EVE_VERIFY_CHUNK * EVE_VERIFY_BATCH)
+      n = EVE_VERIFY_CHUNK * EVE_VERIFY_BATCH;
+    if (!VerifyBatch(address, data, n))
+      ok = false;
+    address += n;
+    data += n;
+    length -= n;
+  }
+  return ok;
+}
+
+// While a frame is being captured the CMD_MEMCRC checks would be recorded into it, so those
+// writes go out as plain bursts and are only counted
+static uint32_t VerifiedWriter(uint32_t Add, const uint8_t *buff, uint32_t count)
+{
+  if (CoProCapture_Active())
+  {
+    VerifyStats.Unverified++;
+    WriteBlockRAM_Hook(NULL);
+    WriteBlockRAM(Add, buff, count);
+    WriteBlockRAM_Hook(VerifiedWriter);
+  }
+  else if (!EVE_WriteVerified(Add, buff, count))
+  {
+    VerifyStats.FailedWrites++;
+  }
+  return Add + count;
+}
+
+void EVE_Mem_VerifyWrites(bool enable)
+{
+  WriteBlockRAM_Hook(enable ? VerifiedWriter : NULL);
+}
+
+const EVE_VerifyStats *EVE_Mem_VerifyStats(void)
+{
+  return &VerifyStats;
+}
+
+// Standard reflected CRC-32 (polynomial 0xEDB88320) - the same one CMD_MEMCRC and zlib use.
+// Slice-by-8: eight tables let the loop fold in eight bytes per step instead of one, which keeps
+// verifying uploads cheap next to the SPI transfer itself.
+// The tables are built by the first caller.  CRCs are worked out on pool threads too
+// (eve_thread.h), so the state is published with release / acquire: 0 not built, 1 being built,
+// 2 ready.
+uint32_t EVE_CRC32(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+  static uint32_t Table[8][256];
+  static volatile uint32_t TableState;
+
+  if (Load(&TableState) != 2 && Swap(&TableState, 0, 1))
+  {
+    for (uint32_t n = 0; n < 256; n++)
+    {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++)
+        c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+      Table[0][n] = c;
+    }
+    for (uint32_t n = 0; n < 256; n++)
+    {
+      for (int t = 1; t < 8; t++)
+        Table[t][n] = Table[0][Table[t - 1][n] & 0xFF] ^ (Table[t - 1][n] >> 8);
+    }
+    Store(&TableState, 2);
+  }
+  while (Load(&TableState) != 2)
+    ; // Another thread is building them
+
+  crc = ~crc;
+  while (length >= 8)
+  {
+    uint32_t lo = crc ^ ((uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) |
+                         ((uint32_t)data[3] << 24));
+    uint32_t hi = (uint32_t)data[4] | ((uint32_t)data[5] << 8) | ((uint32_t)data[6] << 16) |
+                  ((uint32_t)data[7] << 24);
+    crc = Table[7][lo & 0xFF] ^ Table[6][(lo >> 8) & 0xFF] ^ Table[5][(lo >> 16) & 0xFF] ^
+          Table[4][lo >> 24] ^ Table[3][hi & 0xFF] ^ Table[2][(hi >> 8) & 0xFF] ^
+          Table[1][(hi >> 16) & 0xFF] ^ Table[0][hi >> 24];
+    data += 8;
+    length -= 8;
+  }
+  while (length--)
+    crc = Table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
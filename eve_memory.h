@@ -0,0 +1,102 @@
+#ifndef __EVE_MEMORY_H
+#define __EVE_MEMORY_H
+
+// On-chip memory operations
+//
+// A small first-fit allocator for RAM_G plus fill / clear / copy / CRC helpers that let the
+// coprocessor do the work.  Clearing a 512K region is one CMD_MEMZERO (3 words) or CMD_MEMSET
+// (4 words) in the FIFO instead of half a megabyte of SPI traffic.
+//
+// Regions are referred to by a small integer handle rather than by address, because
+// EVE_RamG_Defragment() may move them.  Always ask EVE_RamG_Address() after a defragment.
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_RAMG_SIZE (1024UL * 1024UL) // 1MB of general purpose graphics RAM
+#define EVE_RAMG_ALIGN 16               // ASTC bitmaps want 16 byte alignment, so everyone gets it
+#define EVE_RAMG_MAX_REGIONS 64
+
+  typedef int16_t EVE_Region; // -1 means "no region"
+
+  // Called by EVE_RamG_Defragment() for every region that changed address
+  typedef void (*EVE_RamG_MoveFn)(EVE_Region region,
+                                  uint32_t oldAddress,
+                                  uint32_t newAddress,
+                                  void *context);
+
+  // Set up the allocator to hand out memory between base and base + size.  Without a call to
+  // this the allocator manages RAM_G up to RAM_G_WORKING, leaving the scratch block alone.
+  void EVE_EXPORT EVE_RamG_Init(uint32_t base, uint32_t size);
+  EVE_Region EVE_EXPORT EVE_RamG_Alloc(uint32_t size);
+  // Keep [address, address + size) for something placed there by hand, so EVE_RamG_Alloc() never
+  // hands it out and EVE_RamG_Defragment() never moves it.  region is -1 when the range is outside
+  // the arena and nothing had to be kept.  False if part of it is already allocated.
+  bool EVE_EXPORT EVE_RamG_Reserve(uint32_t address, uint32_t size, EVE_Region *region);
+  void EVE_EXPORT EVE_RamG_Free(EVE_Region region);
+  uint32_t EVE_EXPORT EVE_RamG_Address(EVE_Region region);
+  uint32_t EVE_EXPORT EVE_RamG_Size(EVE_Region region);
+  uint32_t EVE_EXPORT EVE_RamG_Available(void);
+  uint32_t EVE_EXPORT EVE_RamG_LargestFree(void);
+
+  // Slide every allocated region (reserved ones excepted) down to close the gaps left by
+  // EVE_RamG_Free(), using CMD_MEMCPY so no data crosses the SPI bus.  Blocks until the
+  // coprocessor is done and returns the number of bytes moved.  Anything pointing into a moved
+  // region (BITMAP_SOURCE, fonts) must be updated, the callback is there to make that easy.
+  uint32_t EVE_EXPORT EVE_RamG_Defragment(EVE_RamG_MoveFn moved, void *context);
+
+  // Region operations.  These only queue commands, call UpdateFIFO() to run them.
+  void EVE_EXPORT EVE_Mem_Fill(EVE_Region region, uint8_t value);
+  void EVE_EXPORT EVE_Mem_Clear(EVE_Region region);
+  void EVE_EXPORT EVE_Mem_Copy(EVE_Region dest,
+                               uint32_t destOffset,
+                               EVE_Region src,
+                               uint32_t srcOffset,
+                               uint32_t num);
+
+  // Have the coprocessor CRC a block of memory and read the result back.  Flushes the FIFO.
+  uint32_t EVE_EXPORT EVE_Mem_CRC(uint32_t address, uint32_t num);
+  // Compare a block of EVE memory to a host buffer without reading the block back
+  bool EVE_EXPORT EVE_Mem_Verify(uint32_t address, const uint8_t *data, uint32_t num);
+
+  // Verified uploads
+  //
+  // Data is written in EVE_VERIFY_CHUNK sized pieces.  After each batch the coprocessor CRCs
+  // every piece with CMD_MEMCRC, the results come back in one read and only pieces that do not
+  // match the host CRC are sent again, up to EVE_VERIFY_RETRIES times.  This catches bit errors
+  // from a marginal SPI clock without reloading everything.  It needs the coprocessor, so do not
+  // use it while commands are being captured.
+#define EVE_VERIFY_CHUNK 4096
+#define EVE_VERIFY_BATCH 32 // Pieces checked per round trip, at most 32 (tracked in a bitmask)
+#define EVE_VERIFY_RETRIES 3
+
+  typedef struct
+  {
+    uint32_t Chunks;       // Pieces verified
+    uint32_t Retries;      // Pieces that had to be sent again
+    uint32_t Failures;     // Pieces still wrong after the last retry
+    uint32_t FailedWrites; // WriteBlockRAM() calls left with a wrong piece (EVE_Mem_VerifyWrites)
+    uint32_t Unverified;   // WriteBlockRAM() calls sent unchecked because a capture was running
+  } EVE_VerifyStats;
+
+  // Returns false if any piece could not be written correctly
+  bool EVE_EXPORT EVE_WriteVerified(uint32_t address, const uint8_t *data, uint32_t length);
+  // Send everything that goes through WriteBlockRAM() through EVE_WriteVerified().  WriteBlockRAM()
+  // has no way to report a failure, so failed writes are counted in the stats; writes made while
+  // commands are being captured are sent unchecked and counted too.
+  void EVE_EXPORT EVE_Mem_VerifyWrites(bool enable);
+  const EVE_VerifyStats EVE_EXPORT *EVE_Mem_VerifyStats(void);
+
+  // Host side CRC-32 matching CMD_MEMCRC.  Start with crc = 0 and feed the result back in to
+  // continue over several buffers.
+  uint32_t EVE_EXPORT EVE_CRC32(uint32_t crc, const uint8_t *data, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
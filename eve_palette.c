@@ -0,0 +1,469 @@
+// Paletted bitmaps - median cut quantiser, palette and index upload, paletted draw state
+
+#include "eve_palette.h"
+#include <stdlib.h>
+
+typedef struct
+{
+  uint32_t Key;   // r | g << 8 | b << 16 | a << 24
+  uint32_t Count; // Pixels with this colour, 0 marks an empty slot
+  uint8_t Index;  // Palette entry, filled in once the palette is known
+} Entry;
+
+typedef struct
+{
+  uint32_t First, Last; // Range of Colors[]
+  uint32_t Range;       // Weighted extent along Channel
+  uint8_t Channel;
+} Box;
+
+// Channel weights for distances and box extents, r g b a.  Green is what the eye resolves best.
+static const int32_t Weight[4] = {3, 4, 2, 3};
+
+static uint32_t Hash(uint32_t key, uint32_t mask)
+{
+  return (key * 2654435761UL >> 7) & mask;
+}
+
+static Entry *Find(Entry *table, uint32_t mask, uint32_t key)
+{
+  uint32_t i = Hash(key, mask);
+
+  while (table[i].Count && table[i].Key != key)
+    i = (i + 1) & mask;
+  return &table[i];
+}
+
+static uint8_t Channel(uint32_t key, int c)
+{
+  return (uint8_t)(key >> (8 * c));
+}
+
+// Round a colour to what format can show, and back to 8 bits a channel
+static uint32_t ToFormat(uint32_t key, uint8_t format)
+{
+  uint32_t r = Channel(key, 0), g = Channel(key, 1), b = Channel(key, 2), a = Channel(key, 3);
+
+  if (format == PALETTED565)
+  {
+    r = (r * 31 + 127) / 255;
+    g = (g * 63 + 127) / 255;
+    b = (b * 31 + 127) / 255;
+    r = (r << 3) | (r >> 2);
+    g = (g << 2) | (g >> 4);
+    b = (b << 3) | (b >> 2);
+    a = 255;
+  }
+  else if (format == PALETTED4444)
+  {
+    r = (r * 15 + 127) / 255 * 17;
+    g = (g * 15 + 127) / 255 * 17;
+    b = (b * 15 + 127) / 255 * 17;
+    a = (a * 15 + 127) / 255 * 17;
+  }
+  return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+static void Measure(const uint32_t *colors, Box *box)
+{
+  uint8_t lo[4] = {255, 255, 255, 255}, hi[4] = {0, 0, 0, 0};
+
+  for (uint32_t i = box->First; i < box->Last; i++)
+  {
+    for (int c = 0; c < 4; c++)
+    {
+      uint8_t v = Channel(colors[i], c);
+      if (v < lo[c])
+        lo[c] = v;
+      if (v > hi[c])
+        hi[c] = v;
+    }
+  }
+  box->Range = 0;
+  box->Channel = 0;
+  for (int c = 0; c < 4; c++)
+  {
+    uint32_t range = (uint32_t)(hi[c] - lo[c]) * Weight[c];
+    if (range > box->Range)
+    {
+      box->Range = range;
+      box->Channel = (uint8_t)c;
+    }
+  }
+}
+
+// Split box at the weighted median of its widest channel.  The colours are put in order with a
+// counting sort, which keeps the whole cut linear in the number of colours.
+static void Split(uint32_t *colors, uint32_t *counts, uint32_t *scratch, Box *box, Box *other)
+{
+  uint32_t start[257] = {0};
+  uint32_t total = 0, half, sum = 0, at;
+  int c = box->Channel;
+
+  for (uint32_t i = box->First; i < box->Last; i++)
+  {
+    start[Channel(colors[i], c) + 1]++;
+    total += counts[i];
+  }
+  for (int v = 0; v < 256; v++)
+    start[v + 1] += start[v];
+  for (uint32_t i = box->First; i < box->Last; i++)
+  {
+    uint32_t to = start[Channel(colors[i], c)]++;
+    scratch[2 * to] = colors[i];
+    scratch[2 * to + 1] = counts[i];
+  }
+  for (uint32_t i = box->First; i < box->Last; i++)
+  {
+    colors[i] = scratch[2 * (i - box->First)];
+    counts[i] = scratch[2 * (i - box->First) + 1];
+  }
+
+  half = total / 2;
+  for (at = box->First; at < box->Last - 2; at++)
+  {
+    sum += counts[at];
+    if (sum >= half)
+      break;
+  }
+  at++; // Both halves keep at least one colour
+
+  other->First = at;
+  other->Last = box->Last;
+  box->Last = at;
+  Measure(colors, box);
+  Measure(colors, other);
+}
+
+static uint32_t Average(const uint32_t *colors, const uint32_t *counts, const Box *box)
+{
+  uint64_t sum[4] = {0, 0, 0, 0}, total = 0;
+  uint32_t key = 0;
+
+  for (uint32_t i = box->First; i < box->Last; i++)
+  {
+    for (int c = 0; c < 4; c++)
+      sum[c] += (uint64_t)Channel(colors[i], c) * counts[i];
+    total += counts[i];
+  }
+  for (int c = 0; c < 4; c++)
+    key |= (uint32_t)((sum[c] + total / 2) / total) << (8 * c);
+  return key;
+}
+
+// Palette held a channel to an array, so the distance loop is straight line code over 256
+// entries that the compiler can vectorise
+typedef struct
+{
+  int32_t C[4][EVE_PALETTE_MAX];
+  uint16_t Colors;
+} Lookup;
+
+static uint8_t Nearest(const Lookup *lut, const int32_t *v)
+{
+  int32_t dist[EVE_PALETTE_MAX];
+  uint8_t best = 0;
+
+  for (int i = 0; i < lut->Colors; i++)
+  {
+    int32_t dr = lut->C[0][i] - v[0], dg = lut->C[1][i] - v[1];
+    int32_t db = lut->C[2][i] - v[2], da = lut->C[3][i] - v[3];
+    dist[i] =
+        dr * dr * Weight[0] + dg * dg * Weight[1] + db * db * Weight[2] + da * da * Weight[3];
+  }
+  for (int i = 1; i < lut->Colors; i++)
+  {
+    if (dist[i] < dist[best])
+      best = (uint8_t)i;
+  }
+  return best;
+}
+
+static int32_t Clamp(int32_t v)
+{
+  return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+// Floyd-Steinberg over the colour channels, alpha is mapped as it is so edges stay clean
+static bool Dither(EVE_PalettedImage *img, const uint8_t *rgba, const Lookup *lut)
+{
+  uint32_t w = img->Width;
+  int32_t *err = calloc(2 * 3 * (w + 2), sizeof(int32_t));
+
+  if (!err)
+    return false;
+  for (uint32_t y = 0; y < img->Height; y++)
+  {
+    int32_t *cur = err + 3 * (w + 2) * (y & 1);
+    int32_t *next = err + 3 * (w + 2) * ((y + 1) & 1);
+
+    memset(next, 0, 3 * (w + 2) * sizeof(int32_t));
+    for (uint32_t x = 0; x < w; x++)
+    {
+      const uint8_t *p = rgba + 4 * (y * w + x);
+      int32_t v[4];
+      for (int c = 0; c < 3; c++)
+        v[c] = Clamp(p[c] + cur[3 * (x + 1) + c] / 16);
+      v[3] = img->Format == PALETTED565 ? 255 : p[3];
+
+      uint8_t i = Nearest(lut, v);
+      img->Indices[y * w + x] = i;
+      for (int c = 0; c < 3; c++)
+      {
+        int32_t e = v[c] - lut->C[c][i];
+        cur[3 * (x + 2) + c] += e * 7;
+        next[3 * x + c] += e * 3;
+        next[3 * (x + 1) + c] += e * 5;
+        next[3 * (x + 2) + c] += e;
+      }
+    }
+  }
+  free(err);
+  return true;
+}
+
+static uint32_t PixelKey(const uint8_t *p, uint8_t format)
+{
+  uint32_t a = format == PALETTED565 ? 255 : p[3];
+  return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | (a << 24);
+}
+
+// The quantiser proper, table has room for twice the pixels and colors for four words a pixel
+static bool Quantize(EVE_PalettedImage *img,
+                     const uint8_t *rgba,
+                     uint16_t maxColors,
+                     bool dither,
+                     Entry *table,
+                     uint32_t size,
+                     uint32_t *colors)
+{
+  uint32_t pixels = (uint32_t)img->Width * img->Height;
+  uint32_t *counts = colors + pixels;
+  uint32_t unique = 0;
+  bool ok = true;
+
+  // Every distinct colour and how often it appears
+  for (uint32_t i = 0; i < pixels; i++)
+  {
+    uint32_t key = PixelKey(rgba + 4 * i, img->Format);
+    Entry *e = Find(table, size - 1, key);
+    if (!e->Count++)
+    {
+      e->Key = key;
+      colors[unique] = key;
+      counts[unique++] = 0;
+    }
+  }
+  for (uint32_t i = 0; i < unique; i++)
+    counts[i] = Find(table, size - 1, colors[i])->Count;
+
+  // Median cut - keep splitting the box with the widest spread until there are enough
+  Box boxes[EVE_PALETTE_MAX];
+  uint16_t used = 1;
+  boxes[0].First = 0;
+  boxes[0].Last = unique;
+  Measure(colors, &boxes[0]);
+  while (used < maxColors)
+  {
+    int widest = -1;
+    for (int b = 0; b < used; b++)
+    {
+      if (boxes[b].Range && (widest < 0 || boxes[b].Range > boxes[widest].Range))
+        widest = b;
+    }
+    if (widest < 0)
+      break; // Every box is down to a single colour
+    Split(colors, counts, counts + pixels, &boxes[widest], &boxes[used]);
+    used++;
+  }
+
+  Lookup *lut = malloc(sizeof(Lookup));
+  if (!lut)
+    return false;
+  img->Colors = used;
+  lut->Colors = used;
+  for (int b = 0; b < used; b++)
+  {
+    img->Palette[b] = ToFormat(Average(colors, counts, &boxes[b]), img->Format);
+    for (int c = 0; c < 4; c++)
+      lut->C[c][b] = Channel(img->Palette[b], c);
+  }
+
+  if (dither)
+  {
+    ok = Dither(img, rgba, lut);
+  }
+  else
+  {
+    // Map each distinct colour once, then every pixel is a table lookup
+    for (uint32_t i = 0; i < unique; i++)
+    {
+      int32_t v[4];
+      for (int c = 0; c < 4; c++)
+        v[c] = Channel(colors[i], c);
+      Find(table, size - 1, colors[i])->Index = Nearest(lut, v);
+    }
+    for (uint32_t i = 0; i < pixels; i++)
+      img->Indices[i] = Find(table, size - 1, PixelKey(rgba + 4 * i, img->Format))->Index;
+  }
+  free(lut);
+  return ok;
+}
+
+bool EVE_Palette_Quantize(EVE_PalettedImage *img,
+                          const uint8_t *rgba,
+                          uint16_t width,
+                          uint16_t height,
+                          uint8_t format,
+                          uint16_t maxColors,
+                          bool dither,
+                          uint8_t *indices)
+{
+  uint32_t pixels = (uint32_t)width * height;
+  uint32_t size = 1024;
+  bool ok = false;
+
+  if (!EVE_Palette_EntrySize(format) || !pixels)
+    return false;
+  if (maxColors < 1 || maxColors > EVE_PALETTE_MAX)
+    maxColors = EVE_PALETTE_MAX;
+  while (size < 2 * pixels)
+    size <<= 1;
+
+  img->Width = width;
+  img->Height = height;
+  img->Format = format;
+  img->Colors = 0;
+  img->Indices = indices;
+  img->IndexRegion = img->PaletteRegion = -1;
+
+  Entry *table = calloc(size, sizeof(Entry));
+  uint32_t *colors = malloc(pixels * 4 * sizeof(uint32_t)); // colors, counts, sort scratch x2
+  if (table && colors)
+    ok = Quantize(img, rgba, maxColors, dither, table, size, colors);
+  free(table);
+  free(colors);
+  return ok;
+}
+
+uint32_t EVE_Palette_EntrySize(uint8_t format)
+{
+  switch (format)
+  {
+  case PALETTED565:
+  case PALETTED4444:
+    return 2;
+  case PALETTED8:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+uint32_t EVE_Palette_Pack(const EVE_PalettedImage *img, uint8_t *out)
+{
+  uint32_t size = EVE_Palette_EntrySize(img->Format);
+
+  for (int i = 0; i < img->Colors; i++)
+  {
+    uint32_t k = img->Palette[i];
+    uint32_t r = Channel(k, 0), g = Channel(k, 1), b = Channel(k, 2), a = Channel(k, 3);
+    uint32_t v;
+
+    if (img->Format == PALETTED565)
+      v = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+    else if (img->Format == PALETTED4444)
+      v = ((a >> 4) << 12) | ((r >> 4) << 8) | ((g >> 4) << 4) | (b >> 4);
+    else
+      v = (a << 24) | (r << 16) | (g << 8) | b;
+
+    for (uint32_t j = 0; j < size; j++)
+      out[i * size + j] = (uint8_t)(v >> (8 * j)); // Little endian, like the rest of EVE
+  }
+  return img->Colors * size;
+}
+
+bool EVE_Palette_Upload(EVE_PalettedImage *img)
+{
+  uint8_t palette[EVE_PALETTE_MAX * 4];
+  uint32_t pixels = (uint32_t)img->Width * img->Height;
+  uint32_t bytes = EVE_Palette_Pack(img, palette);
+
+  img->IndexRegion = EVE_RamG_Alloc(pixels);
+  img->PaletteRegion = EVE_RamG_Alloc(bytes);
+  if (img->IndexRegion < 0 || img->PaletteRegion < 0)
+  {
+    EVE_Palette_Free(img);
+    return false;
+  }
+  WriteBlockRAM(EVE_RamG_Address(img->IndexRegion), img->Indices, pixels);
+  WriteBlockRAM(EVE_RamG_Address(img->PaletteRegion), palette, bytes);
+  return true;
+}
+
+void EVE_Palette_Free(EVE_PalettedImage *img)
+{
+  EVE_RamG_Free(img->IndexRegion);
+  EVE_RamG_Free(img->PaletteRegion);
+  img->IndexRegion = img->PaletteRegion = -1;
+}
+
+int32_t EVE_Palette_BytesSaved(const EVE_PalettedImage *img)
+{
+  int32_t pixels = (int32_t)img->Width * img->Height;
+  return 2 * pixels - (pixels + (int32_t)(img->Colors * EVE_Palette_EntrySize(img->Format)));
+}
+
+uint8_t EVE_Palette_Setup(const EVE_PalettedImage *img, uint8_t handle, uint32_t *out)
+{
+  uint8_t n = 0;
+
+  out[n++] = BITMAP_HANDLE(handle);
+  out[n++] = BITMAP_SOURCE(EVE_RamG_Address(img->IndexRegion));
+  out[n++] = BITMAP_LAYOUT(img->Format, img->Width, img->Height);
+  out[n++] = BITMAP_SIZE(NEAREST, BORDER, BORDER, img->Width, img->Height);
+  if (img->Width > 511 || img->Height > 511)
+  {
+    out[n++] = BITMAP_LAYOUT_H(img->Width, img->Height);
+    out[n++] = BITMAP_SIZE_H(img->Width, img->Height);
+  }
+  return n;
+}
+
+void EVE_Palette_Draw(const EVE_PalettedImage *img, uint8_t handle, int16_t x, int16_t y)
+{
+  uint32_t palette = EVE_RamG_Address(img->PaletteRegion);
+
+  Send_CMD(BITMAP_HANDLE(handle));
+  Send_CMD(BEGIN(BITMAPS));
+  if (img->Format != PALETTED8)
+  {
+    Send_CMD(PALETTE_SOURCE(palette));
+    Send_CMD(VERTEX2F(x, y));
+  }
+  else
+  {
+    // PALETTED8 looks up one channel a pass: alpha first, then red, green and blue blended
+    // through the alpha just written
+    uint32_t dl[] = {
+        SAVE_CONTEXT(),
+        BLEND_FUNC(ONE, ZERO),
+        COLOR_MASK(0, 0, 0, 1),
+        PALETTE_SOURCE(palette + 3),
+        VERTEX2F(x, y),
+        BLEND_FUNC(DST_ALPHA, ONE_MINUS_DST_ALPHA),
+        COLOR_MASK(1, 0, 0, 0),
+        PALETTE_SOURCE(palette + 2),
+        VERTEX2F(x, y),
+        COLOR_MASK(0, 1, 0, 0),
+        PALETTE_SOURCE(palette + 1),
+        VERTEX2F(x, y),
+        COLOR_MASK(0, 0, 1, 0),
+        PALETTE_SOURCE(palette),
+        VERTEX2F(x, y),
+        RESTORE_CONTEXT(),
+    };
+    Send_CMDs(dl, sizeof(dl) / sizeof(dl[0]));
+  }
+  Send_CMD(END());
+}
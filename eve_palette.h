@@ -0,0 +1,83 @@
+#ifndef __EVE_PALETTE_H
+#define __EVE_PALETTE_H
+
+// Paletted bitmaps
+//
+// Icons and logos rarely use more than a few hundred colours, yet ARGB4 costs 2 bytes a pixel in
+// RAM_G and on the bus.  The paletted formats store one byte a pixel plus a small palette:
+//  - PALETTED565  - 2 byte RGB565 entries, no transparency
+//  - PALETTED4444 - 2 byte ARGB4 entries
+//  - PALETTED8    - 4 byte ARGB8 entries, drawn in four passes (one per channel)
+//
+// EVE_Palette_Quantize() takes RGBA pixels (4 bytes a pixel, red first, as PNG decoders hand
+// them out) and picks the palette by median cut.  Images that already have few enough colours are
+// kept exact.  Dithering (Floyd-Steinberg, colour channels only) hides banding on gradients at
+// the cost of some noise.  The palette holds the colours as EVE will show them, so the error
+// diffusion works against what reaches the screen.
+
+#include "eve.h"
+#include "eve_memory.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_PALETTE_MAX 256
+
+  typedef struct
+  {
+    uint16_t Width;
+    uint16_t Height;
+    uint8_t Format;                    // PALETTED565, PALETTED4444 or PALETTED8
+    uint16_t Colors;                   // Palette entries in use
+    uint32_t Palette[EVE_PALETTE_MAX]; // ARGB8888, rounded to what Format can show
+    uint8_t *Indices;                  // Width * Height bytes, one palette index a pixel
+    EVE_Region IndexRegion;            // Set by EVE_Palette_Upload(), -1 until then
+    EVE_Region PaletteRegion;
+  } EVE_PalettedImage;
+
+  // Quantise width x height RGBA pixels to at most maxColors colours.  indices has to hold
+  // width * height bytes and stays in use by img.  Returns false if the format is not a paletted
+  // one or there was not enough host memory.
+  bool EVE_EXPORT EVE_Palette_Quantize(EVE_PalettedImage *img,
+                                       const uint8_t *rgba,
+                                       uint16_t width,
+                                       uint16_t height,
+                                       uint8_t format,
+                                       uint16_t maxColors,
+                                       bool dither,
+                                       uint8_t *indices);
+
+  // Bytes per palette entry for format, 0 if it is not a paletted format
+  uint32_t EVE_EXPORT EVE_Palette_EntrySize(uint8_t format);
+  // Write the palette in the layout EVE reads it, returns the number of bytes
+  uint32_t EVE_EXPORT EVE_Palette_Pack(const EVE_PalettedImage *img, uint8_t *out);
+
+  // Allocate RAM_G for the indices and the palette and write both.  Returns false if RAM_G is
+  // full, nothing stays allocated then.
+  bool EVE_EXPORT EVE_Palette_Upload(EVE_PalettedImage *img);
+  void EVE_EXPORT EVE_Palette_Free(EVE_PalettedImage *img);
+
+  // RAM_G and bus bytes saved against uploading the same image as ARGB4.  Negative when the
+  // palette costs more than it saves, which only happens on very small images.
+  int32_t EVE_EXPORT EVE_Palette_BytesSaved(const EVE_PalettedImage *img);
+
+  // Display list words that set up handle for the uploaded image (BITMAP_HANDLE, BITMAP_SOURCE,
+  // BITMAP_LAYOUT, BITMAP_SIZE and their _H parts).  out has room for 6 words, returns how many
+  // were written.
+  uint8_t EVE_EXPORT EVE_Palette_Setup(const EVE_PalettedImage *img,
+                                       uint8_t handle,
+                                       uint32_t *out);
+  // Draw the image with handle at (x, y) in the current VERTEXFORMAT units.  PALETTE_SOURCE is
+  // graphics state rather than handle state, so it is sent here with every draw.
+  void EVE_EXPORT EVE_Palette_Draw(const EVE_PalettedImage *img,
+                                   uint8_t handle,
+                                   int16_t x,
+                                   int16_t y);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,210 @@
+// Power management - idle timeouts, backlight dimming and low power states with fast resume
+
+#include "eve_power.h"
+#include "eve_assets.h"
+#include "hw_api.h"
+
+#define NO_TOUCH 0x80008000UL // REG_TOUCH_SCREEN_XY while nothing touches the panel
+#define WAKE_TIMEOUT_MS 50    // Longest time EVE gets to answer after HCMD_ACTIVE
+
+static EVE_PowerConfig Config;
+static EVE_PowerState State;
+static uint64_t Since;        // When State was entered
+static uint64_t LastActivity; // Host time of the last touch or EVE_Power_Activity()
+static uint8_t Brightness;    // REG_PWM_DUTY while active
+static uint8_t PixelClock;    // REG_PCLK from before the pixel clock was stopped
+static EVE_PowerStats Stats;
+
+static void Change(EVE_PowerState state)
+{
+  uint64_t now = HAL_Micros();
+
+  Stats.Residency_us[State] += now - Since;
+  Since = now;
+  State = state;
+  Stats.Entries[state]++;
+}
+
+static bool Touched(void)
+{
+  if (Display_Touch() == TOUCH_TPN)
+    return false;
+  return rd32(REG_TOUCH_SCREEN_XY + RAM_REG) != NO_TOUCH;
+}
+
+static uint8_t HostCommandFor(EVE_PowerState state)
+{
+  if (state == EVE_POWER_STANDBY)
+    return HCMD_STANDBY;
+  if (state == EVE_POWER_SLEEP)
+    return HCMD_SLEEP;
+  return HCMD_PWRDOWN;
+}
+
+// Only ever deeper than the current state
+static void Lower(EVE_PowerState state)
+{
+  if (state == EVE_POWER_DIMMED)
+  {
+    wr8(REG_PWM_DUTY + RAM_REG, Config.DimBrightness);
+  }
+  else if (State <= EVE_POWER_DIMMED)
+  {
+    // Let the coprocessor finish, then take the panel down before EVE stops answering
+    Wait4CoProFIFOEmpty();
+    wr8(REG_PWM_DUTY + RAM_REG, 0);
+    PixelClock = rd8(REG_PCLK + RAM_REG);
+    wr8(REG_PCLK + RAM_REG, 0);
+    HostCommand(HostCommandFor(state));
+  }
+  else
+  {
+    HostCommand(HostCommandFor(state)); // Host commands are still heard in STANDBY and SLEEP
+  }
+  Change(state);
+}
+
+// Restart the clocks and show the display list RAM_DL still holds.  No swap: the front list is
+// retained, and swapping would show the back buffer, the list from before it.
+static bool Resume(void)
+{
+  HostCommand(HCMD_ACTIVE);
+  for (uint32_t waited = 0; rd8(REG_ID + RAM_REG) != 0x7C; waited++)
+  {
+    if (waited == WAKE_TIMEOUT_MS)
+      return false;
+    HAL_Delay(1);
+  }
+
+  wr8(REG_PCLK + RAM_REG, PixelClock);
+  uint32_t frames = rd32(REG_FRAMES + RAM_REG);
+  for (uint32_t waited = 0; rd32(REG_FRAMES + RAM_REG) == frames && waited < WAKE_TIMEOUT_MS;
+       waited++)
+    HAL_Delay(1); // Backlight on once a frame is out, not on a blank panel
+  return true;
+}
+
+static EVE_WakeResult Wake(void)
+{
+  EVE_WakeResult result = EVE_WAKE_RESUMED;
+  uint64_t start = HAL_Micros();
+  bool asleep = State >= EVE_POWER_STANDBY;
+
+  if (State == EVE_POWER_PWRDOWN)
+  {
+    if (EVE_Reinit() > 1)
+    {
+      EVE_Asset_UploadAll();
+      Stats.Reinits++;
+      result = EVE_WAKE_RELOADED;
+    }
+    else
+    {
+      result = EVE_WAKE_FAILED;
+    }
+  }
+  else if (asleep && !Resume())
+  {
+    result = EVE_WAKE_FAILED;
+  }
+
+  if (result == EVE_WAKE_FAILED)
+  {
+    Stats.Failures++;
+    return result;
+  }
+  wr8(REG_PWM_DUTY + RAM_REG, Brightness);
+  Change(EVE_POWER_ACTIVE);
+
+  if (asleep)
+  {
+    uint32_t took = (uint32_t)(HAL_Micros() - start);
+    Stats.Wakes++;
+    Stats.LastWake_us = took;
+    Stats.TotalWake_us += took;
+    if (took > Stats.MaxWake_us)
+      Stats.MaxWake_us = took;
+    EVE_Asset_Checkpoint(); // REG_FRAMES stood still while EVE slept
+  }
+  return result;
+}
+
+void EVE_Power_Init(const EVE_PowerConfig *config)
+{
+  Config = *config;
+  Brightness = Config.Brightness ? Config.Brightness : rd8(REG_PWM_DUTY + RAM_REG);
+  wr8(REG_PWM_DUTY + RAM_REG, Brightness);
+  memset(&Stats, 0, sizeof(Stats));
+  State = EVE_POWER_ACTIVE;
+  Stats.Entries[State] = 1;
+  Since = LastActivity = HAL_Micros();
+}
+
+EVE_PowerState EVE_Power_Service(void)
+{
+  const uint32_t Timeouts[EVE_POWER_STATES] = {
+      0, Config.DimAfter_ms, Config.StandbyAfter_ms, Config.SleepAfter_ms,
+      Config.PowerDownAfter_ms};
+
+  if (EVE_Power_Awake() && Touched())
+  {
+    LastActivity = HAL_Micros();
+    if (State == EVE_POWER_DIMMED)
+      Wake();
+    return State;
+  }
+
+  uint64_t idle = (HAL_Micros() - LastActivity) / 1000;
+  EVE_PowerState target = State;
+  for (int s = State + 1; s < EVE_POWER_STATES; s++)
+  {
+    if (Timeouts[s] && idle >= Timeouts[s])
+      target = (EVE_PowerState)s;
+  }
+  if (target != State)
+    Lower(target);
+  return State;
+}
+
+EVE_WakeResult EVE_Power_Activity(void)
+{
+  LastActivity = HAL_Micros();
+  if (State == EVE_POWER_ACTIVE)
+    return EVE_WAKE_RESUMED;
+  return Wake();
+}
+
+EVE_WakeResult EVE_Power_Enter(EVE_PowerState state)
+{
+  if (state >= EVE_POWER_STATES || state == State)
+    return EVE_WAKE_RESUMED;
+  if (state > State)
+  {
+    Lower(state);
+    return EVE_WAKE_RESUMED;
+  }
+
+  EVE_WakeResult result = Wake();
+  if (result != EVE_WAKE_FAILED && state == EVE_POWER_DIMMED)
+    Lower(state);
+  return result;
+}
+
+EVE_PowerState EVE_Power_State(void)
+{
+  return State;
+}
+
+bool EVE_Power_Awake(void)
+{
+  return State <= EVE_POWER_DIMMED;
+}
+
+const EVE_PowerStats *EVE_Power_Stats(void)
+{
+  uint64_t now = HAL_Micros();
+
+  Stats.Residency_us[State] += now - Since;
+  Since = now;
+  return &Stats;
+}
@@ -0,0 +1,85 @@
+#ifndef __EVE_POWER_H
+#define __EVE_POWER_H
+
+// Power management
+//
+// Steps EVE down as the user goes quiet and back up on the next sign of life:
+//   ACTIVE  -> DIMMED   the backlight drops to DimBrightness through REG_PWM_DUTY
+//   DIMMED  -> STANDBY  backlight and pixel clock off, the oscillator and PLL keep running
+//   STANDBY -> SLEEP    the oscillator and PLL stop too
+//   SLEEP   -> PWRDOWN  the core loses power and everything in it
+// A timeout of 0 skips that step.  STANDBY and SLEEP keep RAM_G, RAM_DL and the registers, so
+// waking is a HCMD_ACTIVE, the pixel clock (which brings back the display list that was showing)
+// and the backlight - no EVE_Init(), no uploads, no redraw.  Only a wake from PWRDOWN has to go through
+// EVE_Reinit() and upload the assets registered with EVE_Asset_Register() again.
+//
+// Call EVE_Power_Service() once per loop.  It watches the touch panel while EVE is awake and
+// counts down the timeouts.  EVE can not see touches once it is in STANDBY or deeper, so
+// buttons, motion sensors and the like report activity with EVE_Power_Activity(), which also
+// wakes EVE.  Nothing may be sent to EVE while EVE_Power_Awake() is false.
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  typedef enum
+  {
+    EVE_POWER_ACTIVE,
+    EVE_POWER_DIMMED,
+    EVE_POWER_STANDBY,
+    EVE_POWER_SLEEP,
+    EVE_POWER_PWRDOWN,
+    EVE_POWER_STATES
+  } EVE_PowerState;
+
+  typedef enum
+  {
+    EVE_WAKE_FAILED,   // EVE did not answer, try again
+    EVE_WAKE_RESUMED,  // The screen is back as it was
+    EVE_WAKE_RELOADED, // EVE was reinitialised and the assets uploaded, redraw everything
+  } EVE_WakeResult;
+
+  typedef struct
+  {
+    uint32_t DimAfter_ms; // Idle time before each step, 0 to skip it
+    uint32_t StandbyAfter_ms;
+    uint32_t SleepAfter_ms;
+    uint32_t PowerDownAfter_ms;
+    uint8_t Brightness;    // REG_PWM_DUTY when active (0 - 128), 0 keeps what EVE_Init() set
+    uint8_t DimBrightness; // REG_PWM_DUTY when dimmed
+  } EVE_PowerConfig;
+
+  typedef struct
+  {
+    uint64_t Residency_us[EVE_POWER_STATES]; // Time spent in each state
+    uint32_t Entries[EVE_POWER_STATES];      // Times each state was entered
+    uint32_t Wakes;                          // From STANDBY or deeper
+    uint32_t Reinits;                        // Wakes that needed EVE_Reinit()
+    uint32_t Failures;
+    uint32_t LastWake_us; // From the wake request to the screen showing again
+    uint32_t MaxWake_us;
+    uint64_t TotalWake_us;
+  } EVE_PowerStats;
+
+  // After EVE_Init().  Starts the idle clock with EVE active.
+  void EVE_EXPORT EVE_Power_Init(const EVE_PowerConfig *config);
+  // Counts down the idle timeouts and watches for touches, returns the state EVE is now in
+  EVE_PowerState EVE_EXPORT EVE_Power_Service(void);
+  // The user did something: restart the idle clock and wake EVE if it was dimmed or asleep
+  EVE_WakeResult EVE_EXPORT EVE_Power_Activity(void);
+  // Go to a state straight away.  Going to EVE_POWER_ACTIVE is a wake.
+  EVE_WakeResult EVE_EXPORT EVE_Power_Enter(EVE_PowerState state);
+  EVE_PowerState EVE_EXPORT EVE_Power_State(void);
+  // True while commands and register accesses can be sent
+  bool EVE_EXPORT EVE_Power_Awake(void);
+  // Residency includes the time spent in the current state so far
+  const EVE_PowerStats EVE_EXPORT *EVE_Power_Stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1008 @@
+// Software rasterizer - display list and RAM_G to RGBA, in bands of scanlines
+
+#include "eve_raster.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define BANDS_PER_THREAD 4 // More bands than threads evens out busy and empty parts of the screen
+#define STACK_DEPTH 4      // Call and context stacks, as deep as on the chip
+#define MAX_STEPS 65536    // Display list words one band will run, guards against JUMP loops
+#define READ_CHUNK 4096
+
+// Display list opcodes, bits 31..24
+#define OP_DISPLAY 0
+#define OP_BITMAP_SOURCE 1
+#define OP_CLEAR_COLOR_RGB 2
+#define OP_TAG 3
+#define OP_COLOR_RGB 4
+#define OP_BITMAP_HANDLE 5
+#define OP_CELL 6
+#define OP_BITMAP_LAYOUT 7
+#define OP_BITMAP_SIZE 8
+#define OP_ALPHA_FUNC 9
+#define OP_STENCIL_FUNC 10
+#define OP_BLEND_FUNC 11
+#define OP_STENCIL_OP 12
+#define OP_POINT_SIZE 13
+#define OP_LINE_WIDTH 14
+#define OP_CLEAR_COLOR_A 15
+#define OP_COLOR_A 16
+#define OP_CLEAR_STENCIL 17
+#define OP_CLEAR_TAG 18
+#define OP_STENCIL_MASK 19
+#define OP_TAG_MASK 20
+#define OP_TRANSFORM_A 21 // to F at 26
+#define OP_SCISSOR_XY 27
+#define OP_SCISSOR_SIZE 28
+#define OP_CALL 29
+#define OP_JUMP 30
+#define OP_BEGIN 31
+#define OP_COLOR_MASK 32
+#define OP_END 33
+#define OP_SAVE_CONTEXT 34
+#define OP_RESTORE_CONTEXT 35
+#define OP_RETURN 36
+#define OP_MACRO 37
+#define OP_CLEAR 38
+#define OP_VERTEX_FORMAT 39
+#define OP_BITMAP_LAYOUT_H 40
+#define OP_BITMAP_SIZE_H 41
+#define OP_PALETTE_SOURCE 42
+#define OP_TRANSLATE_X 43
+#define OP_TRANSLATE_Y 44
+
+typedef struct
+{
+  uint32_t Source;
+  uint8_t Format;
+  uint16_t Stride;
+  uint16_t LayoutHeight;
+  bool Bilinear;
+  bool RepeatX;
+  bool RepeatY;
+  uint16_t Width;
+  uint16_t Height;
+} Handle;
+
+// Graphics context, what SAVE_CONTEXT and RESTORE_CONTEXT save and restore
+typedef struct
+{
+  uint8_t Color[4]; // R, G, B, A
+  uint8_t ClearColor[4];
+  uint8_t ClearStencil;
+  uint8_t ClearTag;
+  uint8_t Tag;
+  bool TagMask;
+  uint8_t AlphaFunc;
+  uint8_t AlphaRef;
+  uint8_t StencilFunc;
+  uint8_t StencilRef;
+  uint8_t StencilFuncMask;
+  uint8_t StencilMask;
+  uint8_t StencilFail;
+  uint8_t StencilPass;
+  uint8_t BlendSrc;
+  uint8_t BlendDst;
+  uint8_t ColorMask; // As in COLOR_MASK, r g b a from bit 3 down
+  uint16_t PointSize; // 1/16 pixel
+  uint16_t LineWidth;
+  int32_t ScissorX, ScissorY, ScissorW, ScissorH;
+  uint8_t Handle;
+  uint8_t Cell;
+  float Transform[6]; // A to F
+  uint8_t VertexFormat;
+  int32_t TranslateX, TranslateY; // 1/16 pixel
+  uint32_t PaletteSource;
+} Context;
+
+typedef struct
+{
+  const EVE_RasterScene *Scene;
+  uint8_t *Rgba;
+  uint8_t *Tags;
+  uint8_t *Stencil;
+  int32_t Top, Bottom; // Rows of this band
+  Context Ctx;
+  Handle Handles[32];
+  uint8_t Primitive;
+  uint32_t Vertices; // Since BEGIN
+  int32_t LastX, LastY;
+  int32_t X0, Y0, X1, Y1; // Drawable area, scissor within the band
+} Band;
+
+// *** Memory
+
+static uint8_t Read8(const EVE_RasterScene *scene, uint32_t address)
+{
+  if (address < scene->RamGSize)
+    return scene->RamG[address];
+  if (scene->Rom && address - EVE_RASTER_ROM_BASE < EVE_RASTER_ROM_SIZE)
+    return scene->Rom[address - EVE_RASTER_ROM_BASE];
+  return 0;
+}
+
+static uint16_t Read16(const EVE_RasterScene *scene, uint32_t address)
+{
+  return (uint16_t)(Read8(scene, address) | (Read8(scene, address + 1) << 8));
+}
+
+static uint32_t Read32(const EVE_RasterScene *scene, uint32_t address)
+{
+  return Read16(scene, address) | ((uint32_t)Read16(scene, address + 2) << 16);
+}
+
+// *** Fragments
+
+static bool Compare(uint8_t func, uint8_t a, uint8_t b)
+{
+  switch (func)
+  {
+  case NEVER:
+    return false;
+  case LESS:
+    return a < b;
+  case LEQUAL:
+    return a <= b;
+  case GREATER:
+    return a > b;
+  case GEQUAL:
+    return a >= b;
+  case EQUAL:
+    return a == b;
+  case NOTEQUAL:
+    return a != b;
+  default:
+    return true;
+  }
+}
+
+static uint8_t StencilOp(uint8_t op, uint8_t value, uint8_t ref)
+{
+  switch (op)
+  {
+  case ZERO:
+    return 0;
+  case REPLACE:
+    return ref;
+  case INCR:
+    return value == 255 ? 255 : value + 1;
+  case DECR:
+    return value ? value - 1 : 0;
+  case INVERT:
+    return (uint8_t)~value;
+  default:
+    return value;
+  }
+}
+
+static uint32_t Factor(uint8_t factor, const uint8_t *src, const uint8_t *dst)
+{
+  switch (factor)
+  {
+  case ZERO:
+    return 0;
+  case ONE:
+    return 255;
+  case SRC_ALPHA:
+    return src[3];
+  case DST_ALPHA:
+    return dst[3];
+  case ONE_MINUS_SRC_ALPHA:
+    return 255 - src[3];
+  case ONE_MINUS_DST_ALPHA:
+    return 255 - dst[3];
+  default:
+    return 0;
+  }
+}
+
+// Alpha test, stencil test and update, blend, colour mask and tag for one pixel
+static void Plot(Band *b, int32_t x, int32_t y, const uint8_t *color)
+{
+  Context *c = &b->Ctx;
+  uint32_t i = (uint32_t)y * b->Scene->Width + x;
+
+  if (!Compare(c->AlphaFunc, color[3], c->AlphaRef))
+    return;
+
+  uint8_t stencil = b->Stencil[i];
+  bool pass =
+      Compare(c->StencilFunc, c->StencilRef & c->StencilFuncMask, stencil & c->StencilFuncMask);
+  uint8_t next = StencilOp(pass ? c->StencilPass : c->StencilFail, stencil, c->StencilRef);
+  b->Stencil[i] = (uint8_t)((stencil & ~c->StencilMask) | (next & c->StencilMask));
+  if (!pass)
+    return;
+
+  uint8_t *dst = b->Rgba + i * 4;
+  uint32_t sf = Factor(c->BlendSrc, color, dst);
+  uint32_t df = Factor(c->BlendDst, color, dst);
+  for (uint8_t k = 0; k < 4; k++)
+  {
+    if (!(c->ColorMask & (8 >> k)))
+      continue;
+    uint32_t v = (color[k] * sf + dst[k] * df + 127) / 255;
+    dst[k] = (uint8_t)(v > 255 ? 255 : v);
+  }
+  if (b->Tags && c->TagMask)
+    b->Tags[i] = c->Tag;
+}
+
+// Current colour with coverage (0..1) folded into alpha
+static void Shade(Band *b, int32_t x, int32_t y, float coverage)
+{
+  uint8_t color[4];
+
+  if (coverage <= 0)
+    return;
+  if (coverage > 1)
+    coverage = 1;
+  memcpy(color, b->Ctx.Color, 3);
+  color[3] = (uint8_t)(b->Ctx.Color[3] * coverage + 0.5f);
+  Plot(b, x, y, color);
+}
+
+// Clip a box of pixels to the drawable area, false if nothing is left
+static bool Clip(const Band *b, int32_t *x0, int32_t *y0, int32_t *x1, int32_t *y1)
+{
+  if (*x0 < b->X0)
+    *x0 = b->X0;
+  if (*y0 < b->Y0)
+    *y0 = b->Y0;
+  if (*x1 > b->X1)
+    *x1 = b->X1;
+  if (*y1 > b->Y1)
+    *y1 = b->Y1;
+  return *x0 < *x1 && *y0 < *y1;
+}
+
+static void UpdateClip(Band *b)
+{
+  const Context *c = &b->Ctx;
+
+  b->X0 = c->ScissorX > 0 ? c->ScissorX : 0;
+  b->X1 = c->ScissorX + c->ScissorW;
+  if (b->X1 > b->Scene->Width)
+    b->X1 = b->Scene->Width;
+  b->Y0 = c->ScissorY > b->Top ? c->ScissorY : b->Top;
+  b->Y1 = c->ScissorY + c->ScissorH;
+  if (b->Y1 > b->Bottom)
+    b->Y1 = b->Bottom;
+}
+
+// *** Primitives, coordinates in 1/16 pixel
+
+static void Clear(Band *b, bool color, bool stencil, bool tag)
+{
+  const Context *c = &b->Ctx;
+  int32_t x0 = b->X0, y0 = b->Y0, x1 = b->X1, y1 = b->Y1;
+
+  if (!Clip(b, &x0, &y0, &x1, &y1))
+    return;
+  for (int32_t y = y0; y < y1; y++)
+  {
+    for (int32_t x = x0; x < x1; x++)
+    {
+      uint32_t i = (uint32_t)y * b->Scene->Width + x;
+      for (uint8_t k = 0; color && k < 4; k++)
+      {
+        if (c->ColorMask & (8 >> k))
+          b->Rgba[i * 4 + k] = c->ClearColor[k];
+      }
+      if (stencil)
+        b->Stencil[i] = (uint8_t)((b->Stencil[i] & ~c->StencilMask) |
+                                  (c->ClearStencil & c->StencilMask));
+      if (tag && b->Tags)
+        b->Tags[i] = c->ClearTag;
+    }
+  }
+}
+
+static void Point(Band *b, int32_t x16, int32_t y16)
+{
+  float r = b->Ctx.PointSize / 16.0f;
+  float cx = x16 / 16.0f, cy = y16 / 16.0f;
+  int32_t x0 = (int32_t)floorf(cx - r - 1), y0 = (int32_t)floorf(cy - r - 1);
+  int32_t x1 = (int32_t)ceilf(cx + r + 1), y1 = (int32_t)ceilf(cy + r + 1);
+
+  if (!Clip(b, &x0, &y0, &x1, &y1))
+    return;
+  for (int32_t y = y0; y < y1; y++)
+  {
+    for (int32_t x = x0; x < x1; x++)
+    {
+      float dx = x + 0.5f - cx, dy = y + 0.5f - cy;
+      Shade(b, x, y, r + 0.5f - sqrtf(dx * dx + dy * dy));
+    }
+  }
+}
+
+// A line is the set of points within LINE_WIDTH of the segment, round ends included
+static void Line(Band *b, int32_t ax16, int32_t ay16, int32_t bx16, int32_t by16)
+{
+  float r = b->Ctx.LineWidth / 16.0f;
+  float ax = ax16 / 16.0f, ay = ay16 / 16.0f, bx = bx16 / 16.0f, by = by16 / 16.0f;
+  float vx = bx - ax, vy = by - ay, length2 = vx * vx + vy * vy;
+  int32_t x0 = (int32_t)floorf(fminf(ax, bx) - r - 1), y0 = (int32_t)floorf(fminf(ay, by) - r - 1);
+  int32_t x1 = (int32_t)ceilf(fmaxf(ax, bx) + r + 1), y1 = (int32_t)ceilf(fmaxf(ay, by) + r + 1);
+
+  if (!Clip(b, &x0, &y0, &x1, &y1))
+    return;
+  for (int32_t y = y0; y < y1; y++)
+  {
+    for (int32_t x = x0; x < x1; x++)
+    {
+      float px = x + 0.5f - ax, py = y + 0.5f - ay;
+      float t = length2 > 0 ? (px * vx + py * vy) / length2 : 0;
+      t = t < 0 ? 0 : (t > 1 ? 1 : t);
+      float dx = px - t * vx, dy = py - t * vy;
+      Shade(b, x, y, r + 0.5f - sqrtf(dx * dx + dy * dy));
+    }
+  }
+}
+
+// The pixels from one corner to the other inclusive, corners rounded by LINE_WIDTH
+static void Rect(Band *b, int32_t ax16, int32_t ay16, int32_t bx16, int32_t by16)
+{
+  float left = fminf(ax16, bx16) / 16.0f, right = fmaxf(ax16, bx16) / 16.0f + 1;
+  float top = fminf(ay16, by16) / 16.0f, bottom = fmaxf(ay16, by16) / 16.0f + 1;
+  float r = b->Ctx.LineWidth / 16.0f;
+  int32_t x0 = (int32_t)floorf(left), y0 = (int32_t)floorf(top);
+  int32_t x1 = (int32_t)ceilf(right), y1 = (int32_t)ceilf(bottom);
+
+  if (r > (right - left) / 2)
+    r = (right - left) / 2;
+  if (r > (bottom - top) / 2)
+    r = (bottom - top) / 2;
+  if (!Clip(b, &x0, &y0, &x1, &y1))
+    return;
+  for (int32_t y = y0; y < y1; y++)
+  {
+    for (int32_t x = x0; x < x1; x++)
+    {
+      // Distance to the box shrunk by the corner radius
+      float px = x + 0.5f, py = y + 0.5f;
+      float dx = fmaxf(fmaxf(left + r - px, px - (right - r)), 0);
+      float dy = fmaxf(fmaxf(top + r - py, py - (bottom - r)), 0);
+      Shade(b, x, y, r + 0.5f - sqrtf(dx * dx + dy * dy));
+    }
+  }
+}
+
+// Fill from one segment of an edge strip to the right, left, top or bottom of the screen
+static void Edge(Band *b, int32_t ax16, int32_t ay16, int32_t bx16, int32_t by16)
+{
+  float ax = ax16 / 16.0f, ay = ay16 / 16.0f, bx = bx16 / 16.0f, by = by16 / 16.0f;
+  bool horizontal = b->Primitive == EDGE_STRIP_R || b->Primitive == EDGE_STRIP_L;
+  bool after = b->Primitive == EDGE_STRIP_R || b->Primitive == EDGE_STRIP_B;
+
+  if (!horizontal)
+  {
+    // Work on the transposed segment, rows become columns
+    float t = ax;
+    ax = ay;
+    ay = t;
+    t = bx;
+    bx = by;
+    by = t;
+  }
+  if (ay == by)
+    return;
+  if (ay > by)
+  {
+    float t = ax;
+    ax = bx;
+    bx = t;
+    t = ay;
+    ay = by;
+    by = t;
+  }
+
+  int32_t first = (int32_t)ceilf(ay - 0.5f), last = (int32_t)ceilf(by - 0.5f);
+  for (int32_t i = first; i < last; i++)
+  {
+    float at = ax + (i + 0.5f - ay) * (bx - ax) / (by - ay);
+    int32_t split = (int32_t)ceilf(at - 0.5f);
+    int32_t x0, y0, x1, y1;
+    if (horizontal)
+    {
+      x0 = after ? split : b->X0;
+      x1 = after ? b->X1 : split;
+      y0 = i;
+      y1 = i + 1;
+    }
+    else
+    {
+      y0 = after ? split : b->Y0;
+      y1 = after ? b->Y1 : split;
+      x0 = i;
+      x1 = i + 1;
+    }
+    if (!Clip(b, &x0, &y0, &x1, &y1))
+      continue;
+    for (int32_t y = y0; y < y1; y++)
+      for (int32_t x = x0; x < x1; x++)
+        Shade(b, x, y, 1);
+  }
+}
+
+// *** Bitmaps
+
+static uint8_t Expand(uint32_t value, uint8_t bits)
+{
+  return (uint8_t)(value * 255 / ((1U << bits) - 1));
+}
+
+static void Decode16(uint8_t format, uint16_t v, uint8_t *out)
+{
+  switch (format)
+  {
+  case ARGB1555:
+    out[0] = Expand((v >> 10) & 31, 5);
+    out[1] = Expand((v >> 5) & 31, 5);
+    out[2] = Expand(v & 31, 5);
+    out[3] = v & 0x8000 ? 255 : 0;
+    break;
+  case ARGB4:
+  case PALETTED4444:
+    out[0] = Expand((v >> 8) & 15, 4);
+    out[1] = Expand((v >> 4) & 15, 4);
+    out[2] = Expand(v & 15, 4);
+    out[3] = Expand(v >> 12, 4);
+    break;
+  default: // RGB565, PALETTED565
+    out[0] = Expand(v >> 11, 5);
+    out[1] = Expand((v >> 5) & 63, 6);
+    out[2] = Expand(v & 31, 5);
+    out[3] = 255;
+    break;
+  }
+}
+
+// One texel, transparent outside a BORDER bitmap
+static void Texel(const Band *b,
+                  const Handle *h,
+                  uint32_t base,
+                  int32_t tx,
+                  int32_t ty,
+                  uint8_t *out)
+{
+  const EVE_RasterScene *s = b->Scene;
+  uint8_t bpp = Bitmap_BitsPerPixel(h->Format);
+  int32_t width = bpp ? h->Stride * 8 / bpp : 0;
+  int32_t height = h->LayoutHeight;
+
+  memset(out, 0, 4);
+  if (!width || !height)
+    return;
+  if (h->RepeatX)
+    tx = ((tx % width) + width) % width;
+  if (h->RepeatY)
+    ty = ((ty % height) + height) % height;
+  if (tx < 0 || ty < 0 || tx >= width || ty >= height)
+    return;
+
+  uint32_t address = base + (uint32_t)ty * h->Stride + (uint32_t)tx * bpp / 8;
+  uint8_t v = Read8(s, address);
+  uint8_t l;
+  switch (h->Format)
+  {
+  case L1:
+    l = (v >> (7 - tx % 8)) & 1 ? 255 : 0;
+    break;
+  case L2:
+    l = Expand((v >> (6 - (tx % 4) * 2)) & 3, 2);
+    break;
+  case L4:
+    l = Expand(tx & 1 ? v & 15 : v >> 4, 4);
+    break;
+  case L8:
+    l = v;
+    break;
+  case RGB332:
+    out[0] = Expand(v >> 5, 3);
+    out[1] = Expand((v >> 2) & 7, 3);
+    out[2] = Expand(v & 3, 2);
+    out[3] = 255;
+    return;
+  case ARGB2:
+    out[0] = Expand((v >> 4) & 3, 2);
+    out[1] = Expand((v >> 2) & 3, 2);
+    out[2] = Expand(v & 3, 2);
+    out[3] = Expand(v >> 6, 2);
+    return;
+  case ARGB1555:
+  case ARGB4:
+  case RGB565:
+    Decode16(h->Format, Read16(s, address), out);
+    return;
+  case PALETTED565:
+  case PALETTED4444:
+    Decode16(h->Format, Read16(s, b->Ctx.PaletteSource + v * 2U), out);
+    return;
+  case PALETTED8:
+  {
+    uint32_t argb = Read32(s, b->Ctx.PaletteSource + v * 4U);
+    out[0] = (uint8_t)(argb >> 16);
+    out[1] = (uint8_t)(argb >> 8);
+    out[2] = (uint8_t)argb;
+    out[3] = (uint8_t)(argb >> 24);
+    return;
+  }
+  default:
+    return;
+  }
+  // Luminance formats are white with the value as alpha
+  out[0] = out[1] = out[2] = 255;
+  out[3] = l;
+}
+
+static void Sample(const Band *b, const Handle *h, uint32_t base, float u, float v, uint8_t *out)
+{
+  if (!h->Bilinear)
+  {
+    Texel(b, h, base, (int32_t)floorf(u), (int32_t)floorf(v), out);
+    return;
+  }
+
+  float fu = u - 0.5f, fv = v - 0.5f;
+  int32_t tx = (int32_t)floorf(fu), ty = (int32_t)floorf(fv);
+  float wx = fu - tx, wy = fv - ty;
+  uint8_t t[4][4];
+  Texel(b, h, base, tx, ty, t[0]);
+  Texel(b, h, base, tx + 1, ty, t[1]);
+  Texel(b, h, base, tx, ty + 1, t[2]);
+  Texel(b, h, base, tx + 1, ty + 1, t[3]);
+  for (uint8_t k = 0; k < 4; k++)
+  {
+    float top = t[0][k] + (t[1][k] - t[0][k]) * wx;
+    float bottom = t[2][k] + (t[3][k] - t[2][k]) * wx;
+    out[k] = (uint8_t)(top + (bottom - top) * wy + 0.5f);
+  }
+}
+
+static void Bitmap(Band *b, int32_t x16, int32_t y16, uint8_t handle, uint8_t cell)
+{
+  const Handle *h = &b->Handles[handle & 31];
+  const float *m = b->Ctx.Transform;
+  float ox = x16 / 16.0f, oy = y16 / 16.0f;
+  uint32_t base = h->Source + (uint32_t)cell * h->Stride * h->LayoutHeight;
+  int32_t x0 = (int32_t)ceilf(ox - 0.5f), y0 = (int32_t)ceilf(oy - 0.5f);
+  uint16_t width = h->Width ? h->Width : 2048, height = h->Height ? h->Height : 2048;
+  int32_t x1 = (int32_t)ceilf(ox + width - 0.5f), y1 = (int32_t)ceilf(oy + height - 0.5f);
+
+  if (!Clip(b, &x0, &y0, &x1, &y1))
+    return;
+  for (int32_t y = y0; y < y1; y++)
+  {
+    for (int32_t x = x0; x < x1; x++)
+    {
+      float px = x + 0.5f - ox, py = y + 0.5f - oy;
+      uint8_t texel[4];
+      Sample(b, h, base, m[0] * px + m[1] * py + m[2], m[3] * px + m[4] * py + m[5], texel);
+      for (uint8_t k = 0; k < 4; k++)
+        texel[k] = (uint8_t)((texel[k] * b->Ctx.Color[k] + 127) / 255);
+      Plot(b, x, y, texel);
+    }
+  }
+}
+
+static void Vertex(Band *b, int32_t x16, int32_t y16, uint8_t handle, uint8_t cell)
+{
+  bool second = b->Vertices & 1;
+
+  switch (b->Primitive)
+  {
+  case BITMAPS:
+    Bitmap(b, x16, y16, handle, cell);
+    break;
+  case POINTS:
+    Point(b, x16, y16);
+    break;
+  case LINES:
+    if (second)
+      Line(b, b->LastX, b->LastY, x16, y16);
+    break;
+  case LINE_STRIP:
+    if (b->Vertices)
+      Line(b, b->LastX, b->LastY, x16, y16);
+    break;
+  case EDGE_STRIP_R:
+  case EDGE_STRIP_L:
+  case EDGE_STRIP_A:
+  case EDGE_STRIP_B:
+    if (b->Vertices)
+      Edge(b, b->LastX, b->LastY, x16, y16);
+    break;
+  case RECTS:
+    if (second)
+      Rect(b, b->LastX, b->LastY, x16, y16);
+    break;
+  default:
+    break;
+  }
+  b->LastX = x16;
+  b->LastY = y16;
+  b->Vertices++;
+}
+
+// *** Display list
+
+static int32_t SignExtend(uint32_t value, uint8_t bits)
+{
+  uint32_t sign = 1UL << (bits - 1);
+  value &= (sign << 1) - 1;
+  return (int32_t)(value ^ sign) - (int32_t)sign;
+}
+
+static void ResetContext(Context *c)
+{
+  memset(c, 0, sizeof(*c));
+  memset(c->Color, 255, 4);
+  c->Tag = 255;
+  c->TagMask = true;
+  c->AlphaFunc = ALWAYS;
+  c->StencilFunc = ALWAYS;
+  c->StencilFuncMask = 255;
+  c->StencilMask = 255;
+  c->StencilFail = KEEP;
+  c->StencilPass = KEEP;
+  c->BlendSrc = SRC_ALPHA;
+  c->BlendDst = ONE_MINUS_SRC_ALPHA;
+  c->ColorMask = 15;
+  c->PointSize = 16;
+  c->LineWidth = 16;
+  c->ScissorW = 2048;
+  c->ScissorH = 2048;
+  c->Transform[0] = 1;
+  c->Transform[4] = 1;
+  c->VertexFormat = 4;
+}
+
+// Handles 16 to 31 start out as the ROM fonts
+static void ResetHandles(Band *b)
+{
+  const EVE_RasterScene *s = b->Scene;
+
+  memset(b->Handles, 0, sizeof(b->Handles));
+  if (!s->Rom)
+    return;
+  uint32_t root = Read32(s, ROM_FONTROOT);
+  for (uint8_t i = 0; i < 16; i++)
+  {
+    uint32_t metrics = root + 148 * i; // 128 widths, then format, stride, width, height, data
+    Handle *h = &b->Handles[16 + i];
+    h->Format = (uint8_t)Read32(s, metrics + 128);
+    h->Stride = (uint16_t)Read32(s, metrics + 132);
+    h->Width = (uint16_t)Read32(s, metrics + 136);
+    h->Height = (uint16_t)Read32(s, metrics + 140);
+    h->LayoutHeight = h->Height;
+    h->Source = Read32(s, metrics + 144);
+  }
+}
+
+// Everything except flow control
+static void Execute(Band *b, uint32_t w)
+{
+  Context *c = &b->Ctx;
+  Handle *h = &b->Handles[c->Handle];
+
+  if ((w >> 30) == 1) // VERTEX2F
+  {
+    int32_t x = SignExtend(w >> 15, 15), y = SignExtend(w, 15);
+    uint8_t frac = c->VertexFormat;
+    x = frac <= 4 ? x * (1 << (4 - frac)) : x / (1 << (frac - 4));
+    y = frac <= 4 ? y * (1 << (4 - frac)) : y / (1 << (frac - 4));
+    Vertex(b, x + c->TranslateX, y + c->TranslateY, c->Handle, c->Cell);
+    return;
+  }
+  if ((w >> 30) == 2) // VERTEX2II
+  {
+    int32_t x = (int32_t)((w >> 21) & 511) * 16, y = (int32_t)((w >> 12) & 511) * 16;
+    Vertex(b, x + c->TranslateX, y + c->TranslateY, (w >> 7) & 31, w & 127);
+    return;
+  }
+
+  switch (w >> 24)
+  {
+  case OP_BITMAP_SOURCE:
+    h->Source = w & 0x3FFFFF;
+    break;
+  case OP_CLEAR_COLOR_RGB:
+    c->ClearColor[0] = (uint8_t)(w >> 16);
+    c->ClearColor[1] = (uint8_t)(w >> 8);
+    c->ClearColor[2] = (uint8_t)w;
+    break;
+  case OP_TAG:
+    c->Tag = (uint8_t)w;
+    break;
+  case OP_COLOR_RGB:
+    c->Color[0] = (uint8_t)(w >> 16);
+    c->Color[1] = (uint8_t)(w >> 8);
+    c->Color[2] = (uint8_t)w;
+    break;
+  case OP_BITMAP_HANDLE:
+    c->Handle = w & 31;
+    break;
+  case OP_CELL:
+    c->Cell = w & 127;
+    break;
+  case OP_BITMAP_LAYOUT:
+    h->Format = (w >> 19) & 31;
+    h->Stride = (uint16_t)((h->Stride & ~1023U) | ((w >> 9) & 1023));
+    h->LayoutHeight = (uint16_t)((h->LayoutHeight & ~511U) | (w & 511));
+    break;
+  case OP_BITMAP_LAYOUT_H:
+    h->Stride = (uint16_t)((h->Stride & 1023) | (((w >> 2) & 3) << 10));
+    h->LayoutHeight = (uint16_t)((h->LayoutHeight & 511) | ((w & 3) << 9));
+    break;
+  case OP_BITMAP_SIZE:
+    h->Bilinear = (w >> 20) & 1;
+    h->RepeatX = (w >> 19) & 1;
+    h->RepeatY = (w >> 18) & 1;
+    h->Width = (uint16_t)((h->Width & ~511U) | ((w >> 9) & 511));
+    h->Height = (uint16_t)((h->Height & ~511U) | (w & 511));
+    break;
+  case OP_BITMAP_SIZE_H:
+    h->Width = (uint16_t)((h->Width & 511) | (((w >> 2) & 3) << 9));
+    h->Height = (uint16_t)((h->Height & 511) | ((w & 3) << 9));
+    break;
+  case OP_ALPHA_FUNC:
+    c->AlphaFunc = (w >> 8) & 7;
+    c->AlphaRef = (uint8_t)w;
+    break;
+  case OP_STENCIL_FUNC:
+    c->StencilFunc = (w >> 16) & 15;
+    c->StencilRef = (uint8_t)(w >> 8);
+    c->StencilFuncMask = (uint8_t)w;
+    break;
+  case OP_BLEND_FUNC:
+    c->BlendSrc = (w >> 3) & 7;
+    c->BlendDst = w & 7;
+    break;
+  case OP_STENCIL_OP:
+    c->StencilFail = (w >> 3) & 7;
+    c->StencilPass = w & 7;
+    break;
+  case OP_POINT_SIZE:
+    c->PointSize = w & 8191;
+    break;
+  case OP_LINE_WIDTH:
+    c->LineWidth = w & 4095;
+    break;
+  case OP_CLEAR_COLOR_A:
+    c->ClearColor[3] = (uint8_t)w;
+    break;
+  case OP_COLOR_A:
+    c->Color[3] = (uint8_t)w;
+    break;
+  case OP_CLEAR_STENCIL:
+    c->ClearStencil = (uint8_t)w;
+    break;
+  case OP_CLEAR_TAG:
+    c->ClearTag = (uint8_t)w;
+    break;
+  case OP_STENCIL_MASK:
+    c->StencilMask = (uint8_t)w;
+    break;
+  case OP_TAG_MASK:
+    c->TagMask = w & 1;
+    break;
+  case OP_TRANSFORM_A:
+  case OP_TRANSFORM_A + 1:
+  case OP_TRANSFORM_A + 3:
+  case OP_TRANSFORM_A + 4:
+    // 8.8 fixed point, or 1.15 with the precision bit set
+    c->Transform[(w >> 24) - OP_TRANSFORM_A] =
+        SignExtend(w, 17) / ((w >> 17) & 1 ? 32768.0f : 256.0f);
+    break;
+  case OP_TRANSFORM_A + 2:
+  case OP_TRANSFORM_A + 5:
+    c->Transform[(w >> 24) - OP_TRANSFORM_A] = SignExtend(w, 24) / 256.0f;
+    break;
+  case OP_SCISSOR_XY:
+    c->ScissorX = (w >> 11) & 2047;
+    c->ScissorY = w & 2047;
+    UpdateClip(b);
+    break;
+  case OP_SCISSOR_SIZE:
+    c->ScissorW = (w >> 12) & 4095;
+    c->ScissorH = w & 4095;
+    UpdateClip(b);
+    break;
+  case OP_BEGIN:
+    b->Primitive = w & 15;
+    b->Vertices = 0;
+    break;
+  case OP_COLOR_MASK:
+    c->ColorMask = w & 15;
+    break;
+  case OP_END:
+    b->Primitive = 0;
+    break;
+  case OP_CLEAR:
+    Clear(b, (w >> 2) & 1, (w >> 1) & 1, w & 1);
+    break;
+  case OP_VERTEX_FORMAT:
+    c->VertexFormat = w & 7;
+    break;
+  case OP_PALETTE_SOURCE:
+    c->PaletteSource = w & 0x3FFFFF;
+    break;
+  case OP_TRANSLATE_X:
+    c->TranslateX = SignExtend(w, 17);
+    break;
+  case OP_TRANSLATE_Y:
+    c->TranslateY = SignExtend(w, 17);
+    break;
+  default: // NOP, BITMAP_EXT_FORMAT, BITMAP_SWIZZLE and anything newer
+    break;
+  }
+}
+
+static int RenderBand(void *context)
+{
+  Band *b = context;
+  const EVE_RasterScene *s = b->Scene;
+  uint32_t calls[STACK_DEPTH];
+  Context saved[STACK_DEPTH];
+  uint8_t callDepth = 0, savedDepth = 0;
+  uint32_t pc = 0;
+
+  ResetContext(&b->Ctx);
+  ResetHandles(b);
+  UpdateClip(b);
+
+  for (uint32_t steps = 0; steps < MAX_STEPS && pc < s->Words; steps++)
+  {
+    uint32_t w = s->DisplayList[pc++];
+
+    if (w >> 30)
+    {
+      Execute(b, w);
+      continue;
+    }
+    switch (w >> 24)
+    {
+    case OP_DISPLAY:
+      return 0;
+    case OP_CALL:
+      if (callDepth < STACK_DEPTH)
+      {
+        calls[callDepth++] = pc;
+        pc = w & 0xFFFF;
+      }
+      break;
+    case OP_JUMP:
+      pc = w & 0xFFFF;
+      break;
+    case OP_RETURN:
+      if (callDepth)
+        pc = calls[--callDepth];
+      break;
+    case OP_SAVE_CONTEXT:
+      if (savedDepth < STACK_DEPTH)
+        saved[savedDepth++] = b->Ctx;
+      break;
+    case OP_RESTORE_CONTEXT:
+      if (savedDepth)
+      {
+        b->Ctx = saved[--savedDepth];
+        UpdateClip(b);
+      }
+      break;
+    case OP_MACRO:
+      Execute(b, s->Macro[w & 1]);
+      break;
+    default:
+      Execute(b, w);
+      break;
+    }
+  }
+  return 0;
+}
+
+bool EVE_Raster_Render(const EVE_RasterScene *scene, uint8_t *rgba, uint8_t *tags, EVE_Pool *pool)
+{
+  uint32_t pixels = (uint32_t)scene->Width * scene->Height;
+  uint32_t count = pool ? EVE_Pool_Threads(pool) * BANDS_PER_THREAD : 1;
+
+  if (count > scene->Height)
+    count = scene->Height ? scene->Height : 1;
+
+  uint8_t *stencil = calloc(pixels ? pixels : 1, 1);
+  Band *bands = calloc(count, sizeof(Band));
+  if (!stencil || !bands)
+  {
+    free(stencil);
+    free(bands);
+    return false;
+  }
+  memset(rgba, 0, (size_t)pixels * 4);
+  if (tags)
+    memset(tags, 0, pixels);
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    Band *b = &bands[i];
+    b->Scene = scene;
+    b->Rgba = rgba;
+    b->Tags = tags;
+    b->Stencil = stencil;
+    b->Top = (int32_t)(scene->Height * i / count);
+    b->Bottom = (int32_t)(scene->Height * (i + 1) / count);
+
+    EVE_Future *future = pool ? EVE_Pool_Run(pool, RenderBand, b) : NULL;
+    if (future)
+      EVE_Future_Free(future);
+    else
+      RenderBand(b);
+  }
+  if (pool)
+    EVE_Pool_Wait(pool);
+
+  free(stencil);
+  free(bands);
+  return true;
+}
+
+uint32_t EVE_Raster_Diff(const uint8_t *a, const uint8_t *b, uint32_t pixels, uint8_t tolerance)
+{
+  uint32_t differ = 0;
+
+  for (uint32_t i = 0; i < pixels; i++, a += 4, b += 4)
+  {
+    for (uint8_t k = 0; k < 4; k++)
+    {
+      if (abs(a[k] - b[k]) > tolerance)
+      {
+        differ++;
+        break;
+      }
+    }
+  }
+  return differ;
+}
+
+// *** Capture
+
+static void ReadBlock(uint32_t address, uint8_t *buffer, uint32_t size)
+{
+  while (size)
+  {
+    uint32_t n = size > READ_CHUNK ? READ_CHUNK : size;
+    rdN(address, buffer, n);
+    address += n;
+    buffer += n;
+    size -= n;
+  }
+}
+
+void EVE_Raster_Capture(EVE_RasterScene *scene,
+                        uint32_t *dl,
+                        uint8_t *ramg,
+                        uint32_t ramgSize,
+                        uint8_t *rom)
+{
+  uint8_t bytes[READ_CHUNK];
+
+  for (uint32_t at = 0; at < EVE_RASTER_DL_WORDS * 4; at += READ_CHUNK)
+  {
+    rdN(RAM_DL + at, bytes, READ_CHUNK);
+    for (uint32_t i = 0; i < READ_CHUNK; i += 4)
+      dl[(at + i) / 4] = bytes[i] | ((uint32_t)bytes[i + 1] << 8) |
+                         ((uint32_t)bytes[i + 2] << 16) | ((uint32_t)bytes[i + 3] << 24);
+  }
+  ReadBlock(RAM_G, ramg, ramgSize);
+  if (rom)
+    ReadBlock(EVE_RASTER_ROM_BASE, rom, EVE_RASTER_ROM_SIZE);
+
+  scene->DisplayList = dl;
+  scene->Words = EVE_RASTER_DL_WORDS;
+  scene->RamG = ramg;
+  scene->RamGSize = ramgSize;
+  scene->Rom = rom;
+  scene->Macro[0] = rd32(REG_MACRO_0 + RAM_REG);
+  scene->Macro[1] = rd32(REG_MACRO_1 + RAM_REG);
+  scene->Width = rd16(REG_HSIZE + RAM_REG);
+  scene->Height = rd16(REG_VSIZE + RAM_REG);
+}
@@ -0,0 +1,68 @@
+#ifndef __EVE_RASTER_H
+#define __EVE_RASTER_H
+
+// Software rasterizer for display lists
+//
+// Renders a display list (the contents of RAM_DL) and the RAM_G it draws from into an RGBA
+// image on the host, so screens can be checked against golden images instead of a camera
+// pointed at a panel.  EVE_Raster_Capture() reads everything needed back from the chip; a scene
+// can equally be filled in from an emulated run or from files.
+//
+// Covered: points, lines, line strips, edge strips, rectangles, bitmaps in the L1/L2/L4/L8,
+// RGB332, ARGB2, ARGB4, ARGB1555, RGB565 and paletted formats with nearest or bilinear filtering,
+// bitmap transforms, ROM fonts (when the ROM is supplied), scissor, alpha test, blending,
+// stencil, colour mask, tags, SAVE/RESTORE_CONTEXT, CALL/JUMP/RETURN and MACRO.  Anti-aliasing
+// is a simple coverage model, so images match other images from this rasterizer exactly but the
+// hardware only closely.
+//
+// The screen is split into bands of scanlines that are rendered on an EVE_Pool when one is
+// given.
+
+#include "eve.h"
+#include "eve_thread.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_RASTER_DL_WORDS 2048
+#define EVE_RASTER_ROM_BASE 0x200000UL // ROM fonts live here, ROM_FONTROOT points into it
+#define EVE_RASTER_ROM_SIZE 0x100000UL
+
+  typedef struct
+  {
+    const uint32_t *DisplayList;
+    uint32_t Words;
+    const uint8_t *RamG;
+    uint32_t RamGSize;
+    const uint8_t *Rom; // EVE_RASTER_ROM_SIZE bytes from EVE_RASTER_ROM_BASE, or NULL
+    uint32_t Macro[2];  // REG_MACRO_0 and REG_MACRO_1
+    uint16_t Width;
+    uint16_t Height;
+  } EVE_RasterScene;
+
+  // Read RAM_DL, ramgSize bytes of RAM_G, the macro registers, the screen size and, if rom is not
+  // NULL, the font ROM from the chip into the buffers given and point scene at them
+  void EVE_EXPORT EVE_Raster_Capture(EVE_RasterScene *scene,
+                                     uint32_t *dl,
+                                     uint8_t *ramg,
+                                     uint32_t ramgSize,
+                                     uint8_t *rom);
+  // Render into rgba (4 bytes a pixel, Width * Height) and, if not NULL, tags (1 byte a pixel).
+  // pool may be NULL to render on the calling thread.  False if out of memory.
+  bool EVE_EXPORT EVE_Raster_Render(const EVE_RasterScene *scene,
+                                    uint8_t *rgba,
+                                    uint8_t *tags,
+                                    EVE_Pool *pool);
+  // Number of pixels where any channel of a and b differs by more than tolerance
+  uint32_t EVE_EXPORT EVE_Raster_Diff(const uint8_t *a,
+                                      const uint8_t *b,
+                                      uint32_t pixels,
+                                      uint8_t tolerance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
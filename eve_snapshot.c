@@ -0,0 +1,260 @@
+// Screenshots - CMD_SNAPSHOT2 in bands, burst readback and PNG encoding on a second thread
+
+#include "eve_snapshot.h"
+#include "eve_memory.h"
+#include "eve_thread.h"
+#include "hw_api.h"
+
+#define STORED_MAX 65535 // Largest stored deflate block
+#define ADLER_MOD 65521
+#define ADLER_RUN 5552 // Bytes that can be summed before the sums need reducing
+
+typedef struct
+{
+  EVE_ScreenshotWriteFn Write;
+  void *Context;
+  uint32_t Width;
+  uint32_t Adler;
+  uint8_t *Raw;   // Filtered rows of one band
+  uint8_t *Chunk; // The IDAT chunk built from them
+  uint64_t Encode_us;
+  bool Failed;
+  // The band to encode, set while no encoder is running
+  const uint8_t *Pixels; // RGB565, little endian
+  uint32_t Rows;
+  bool First;
+  bool Last;
+} Encoder;
+
+static void Put32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static uint32_t Adler32(uint32_t adler, const uint8_t *data, uint32_t length)
+{
+  uint32_t a = adler & 0xFFFF;
+  uint32_t b = adler >> 16;
+
+  while (length)
+  {
+    uint32_t run = length < ADLER_RUN ? length : ADLER_RUN;
+    length -= run;
+    while (run--)
+    {
+      a += *data++;
+      b += a;
+    }
+    a %= ADLER_MOD;
+    b %= ADLER_MOD;
+  }
+  return (b << 16) | a;
+}
+
+// Chunk holds the length and type from offset 0, the data from offset 8
+static bool Chunk(Encoder *e, uint8_t *chunk, const char *type, uint32_t length)
+{
+  Put32(chunk, length);
+  memcpy(chunk + 4, type, 4);
+  Put32(chunk + 8 + length, EVE_CRC32(0, chunk + 4, length + 4));
+  if (!e->Failed && !e->Write(chunk, length + 12, e->Context))
+    e->Failed = true;
+  return !e->Failed;
+}
+
+static int EncodeBand(void *context)
+{
+  Encoder *e = context;
+  uint64_t start = HAL_Micros();
+  uint32_t stride = 1 + e->Width * 3;
+  uint32_t raw = e->Rows * stride;
+  uint8_t *out = e->Raw;
+
+  for (uint32_t y = 0; y < e->Rows; y++)
+  {
+    const uint8_t *in = e->Pixels + y * e->Width * 2;
+    *out++ = 0; // Filter type None
+    for (uint32_t x = 0; x < e->Width; x++, in += 2)
+    {
+      uint16_t p = (uint16_t)(in[0] | (in[1] << 8));
+      uint8_t r = (p >> 11) & 0x1F, g = (p >> 5) & 0x3F, b = p & 0x1F;
+      *out++ = (uint8_t)((r << 3) | (r >> 2));
+      *out++ = (uint8_t)((g << 2) | (g >> 4));
+      *out++ = (uint8_t)((b << 3) | (b >> 2));
+    }
+  }
+  e->Adler = Adler32(e->Adler, e->Raw, raw);
+
+  // One IDAT chunk a band, the zlib stream runs on across them
+  uint8_t *data = e->Chunk + 8;
+  uint32_t length = 0;
+  if (e->First)
+  {
+    data[length++] = 0x78; // Deflate, 32K window, no preset dictionary
+    data[length++] = 0x01;
+  }
+  for (uint32_t done = 0; done < raw;)
+  {
+    uint32_t block = raw - done < STORED_MAX ? raw - done : STORED_MAX;
+    data[length++] = (e->Last && done + block == raw) ? 1 : 0; // BFINAL, BTYPE stored
+    data[length++] = (uint8_t)block;
+    data[length++] = (uint8_t)(block >> 8);
+    data[length++] = (uint8_t)~block;
+    data[length++] = (uint8_t)(~block >> 8);
+    memcpy(data + length, e->Raw + done, block);
+    length += block;
+    done += block;
+  }
+  if (e->Last)
+  {
+    Put32(data + length, e->Adler);
+    length += 4;
+  }
+  Chunk(e, e->Chunk, "IDAT", length);
+  e->Encode_us += HAL_Micros() - start;
+  return !e->Failed;
+}
+
+static bool Header(Encoder *e, uint32_t height)
+{
+  static const uint8_t Signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  uint8_t ihdr[8 + 13 + 4];
+
+  if (!e->Write(Signature, sizeof(Signature), e->Context))
+    return false;
+  Put32(ihdr + 8, e->Width);
+  Put32(ihdr + 12, height);
+  ihdr[16] = 8; // Bits a channel
+  ihdr[17] = 2; // RGB
+  ihdr[18] = 0; // Deflate
+  ihdr[19] = 0; // Adaptive filtering
+  ihdr[20] = 0; // Not interlaced
+  return Chunk(e, ihdr, "IHDR", 13);
+}
+
+bool EVE_Screenshot_Stream(EVE_ScreenshotWriteFn write,
+                           void *context,
+                           EVE_ScreenshotStats *stats)
+{
+  EVE_ScreenshotStats s = {0};
+  Encoder e = {0};
+  uint64_t start = HAL_Micros();
+  uint32_t width = Display_Width();
+  uint32_t height = Display_Height();
+  uint32_t rowBytes = width * 2;
+  uint32_t rows = EVE_SNAPSHOT_BURST / rowBytes;
+  EVE_Region region;
+  EVE_Future *pending = NULL;
+  uint8_t *bands[2];
+  bool ok = false;
+
+  if (!rows)
+    rows = 1;
+  if (rows > height)
+    rows = height;
+  while ((region = EVE_RamG_Alloc(rows * rowBytes)) < 0 && rows > 1)
+    rows /= 2;
+  if (region < 0)
+    return false;
+
+  uint32_t raw = rows * (1 + width * 3);
+  bands[0] = malloc(2 * rows * rowBytes);
+  bands[1] = bands[0] ? bands[0] + rows * rowBytes : NULL;
+  e.Raw = malloc(raw);
+  e.Chunk = malloc(8 + 2 + raw + 5 * (raw / STORED_MAX + 1) + 4 + 4);
+  e.Write = write;
+  e.Context = context;
+  e.Width = width;
+  e.Adler = 1;
+  if (!bands[0] || !e.Raw || !e.Chunk || !Header(&e, height))
+    goto done;
+
+  uint32_t address = EVE_RamG_Address(region);
+  for (uint32_t y = 0, band = 0; y < height; y += rows, band++)
+  {
+    uint32_t n = height - y < rows ? height - y : rows;
+    uint8_t *pixels = bands[band & 1];
+    uint64_t t0 = HAL_Micros();
+
+    // Rows count from the top of the visible area, which starts PIXVOFFSET lines in
+    Cmd_Snapshot2(RGB565, address, 0, (int16_t)(y + Display_VOffset()), (uint16_t)width,
+                  (uint16_t)n);
+    UpdateFIFO();
+    Wait4CoProFIFOEmpty();
+    uint64_t t1 = HAL_Micros();
+    for (uint32_t read = 0; read < n * rowBytes; read += EVE_SNAPSHOT_BURST)
+    {
+      uint32_t size = n * rowBytes - read;
+      rdN(address + read, pixels + read, size < EVE_SNAPSHOT_BURST ? size : EVE_SNAPSHOT_BURST);
+    }
+    uint64_t t2 = HAL_Micros();
+    s.Capture_us += (uint32_t)(t1 - t0);
+    s.Transfer_us += (uint32_t)(t2 - t1);
+    s.Bytes += n * rowBytes;
+    s.Bands++;
+
+    // The other buffer is free once the encoder has finished the band before this one
+    if (pending)
+    {
+      EVE_Future_Wait(pending);
+      EVE_Future_Free(pending);
+      pending = NULL;
+    }
+    if (e.Failed)
+      goto done;
+    e.Pixels = pixels;
+    e.Rows = n;
+    e.First = y == 0;
+    e.Last = y + n == height;
+    pending = EVE_Thread_Run(EncodeBand, &e);
+    if (!pending)
+      EncodeBand(&e);
+  }
+  if (pending)
+  {
+    EVE_Future_Wait(pending);
+    EVE_Future_Free(pending);
+    pending = NULL;
+  }
+
+  {
+    uint8_t iend[12];
+    ok = Chunk(&e, iend, "IEND", 0);
+  }
+
+done:
+  if (pending)
+  {
+    EVE_Future_Wait(pending);
+    EVE_Future_Free(pending);
+  }
+  EVE_RamG_Free(region);
+  free(bands[0]);
+  free(e.Raw);
+  free(e.Chunk);
+  s.Encode_us = (uint32_t)e.Encode_us;
+  s.Total_us = (uint32_t)(HAL_Micros() - start);
+  if (stats)
+    *stats = s;
+  return ok;
+}
+
+static bool WriteFile(const uint8_t *data, uint32_t length, void *context)
+{
+  return fwrite(data, 1, length, (FILE *)context) == length;
+}
+
+bool EVE_Screenshot(const char *path, EVE_ScreenshotStats *stats)
+{
+  FILE *f = fopen(path, "wb");
+
+  if (!f)
+    return false;
+  bool ok = EVE_Screenshot_Stream(WriteFile, f, stats);
+  if (fclose(f))
+    ok = false;
+  return ok;
+}
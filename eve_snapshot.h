@@ -0,0 +1,51 @@
+#ifndef __EVE_SNAPSHOT_H
+#define __EVE_SNAPSHOT_H
+
+// Screenshots
+//
+// EVE_Screenshot() saves what the panel is showing as a PNG.  The screen is rendered in bands of
+// rows with CMD_SNAPSHOT2 into a RAM_G region taken from the allocator, each band sized so it
+// comes back in a single EVE_SNAPSHOT_BURST byte rdN().  While one band is read over SPI the
+// previous one is turned into PNG on a thread of its own, so only two bands are ever held on the
+// host and the image goes straight to the file (or to any sink with EVE_Screenshot_Stream()).
+//
+// The PNG is RGB, 8 bits a channel, and uses stored (uncompressed) deflate blocks: encoding costs
+// no more than a copy and a checksum and never holds up the SPI reads.  Recompress it offline if
+// size matters.
+//
+// CMD_SNAPSHOT2 needs a BT81x (EVE3 or EVE4) and the coprocessor, so do not call this while
+// commands are being captured.
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_SNAPSHOT_BURST 65536 // Largest read the bridges do in one transfer
+
+  // Receives the PNG in order, from the encoder thread.  Returns false to give up.
+  typedef bool (*EVE_ScreenshotWriteFn)(const uint8_t *data, uint32_t length, void *context);
+
+  typedef struct
+  {
+    uint32_t Capture_us;  // Coprocessor rendering bands into RAM_G
+    uint32_t Transfer_us; // Reading the bands back
+    uint32_t Encode_us;   // PNG encoding and writing, on the encoder thread
+    uint32_t Total_us;
+    uint32_t Bytes; // Read from EVE
+    uint32_t Bands;
+  } EVE_ScreenshotStats;
+
+  // stats may be NULL.  False when RAM_G, host memory or the sink ran out.
+  bool EVE_EXPORT EVE_Screenshot(const char *path, EVE_ScreenshotStats *stats);
+  bool EVE_EXPORT EVE_Screenshot_Stream(EVE_ScreenshotWriteFn write,
+                                        void *context,
+                                        EVE_ScreenshotStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
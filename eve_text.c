@@ -0,0 +1,350 @@
+// Text metrics and layout - character widths kept on the host, no SPI traffic to measure text
+
+#include "eve_text.h"
+
+#define LEGACY_BLOCK 148 // widths[128], format, stride, width, height, gptr
+#define XFONT_HEADER 40  // Ten words, then gptr[] and wptr[] for every 128 characters
+
+typedef struct
+{
+  bool Loaded;
+  bool Extended;
+  uint16_t Height;
+  uint8_t Widths[128]; // Legacy fonts, and the first 128 characters of extended ones
+  const uint8_t *XFont;
+  uint32_t XFontLength;
+  uint32_t XFontAddress;
+  uint32_t Count; // Characters in an extended font
+} Font;
+
+static Font Fonts[EVE_TEXT_HANDLES];
+static Font RomFonts[16]; // ROM fonts 16..31
+
+static uint32_t Word(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void ParseLegacy(Font *f, const uint8_t *block)
+{
+  memset(f, 0, sizeof(*f));
+  memcpy(f->Widths, block, 128);
+  f->Height = (uint16_t)Word(block + 140);
+  f->Loaded = true;
+}
+
+static uint8_t XFontWidth(const Font *f, uint32_t c)
+{
+  if (c >= f->Count)
+    return 0;
+  uint32_t pages = (f->Count + 127) / 128;
+  uint32_t wptr = Word(f->XFont + XFONT_HEADER + 4 * pages + 4 * (c / 128));
+  uint32_t offset = wptr - f->XFontAddress + (c % 128);
+  return offset < f->XFontLength ? f->XFont[offset] : 0;
+}
+
+static const Font *Get(uint8_t handle)
+{
+  return (handle < EVE_TEXT_HANDLES && Fonts[handle].Loaded) ? &Fonts[handle] : NULL;
+}
+
+static uint8_t Width(const Font *f, uint32_t c)
+{
+  if (c < 128)
+    return f->Widths[c];
+  return f->Extended ? XFontWidth(f, c) : 0;
+}
+
+// Decode one UTF-8 character and step past it.  Malformed bytes come back one at a time as
+// themselves, which is what the coprocessor does with them as well.
+static uint32_t NextChar(const char **text)
+{
+  const uint8_t *p = (const uint8_t *)*text;
+  uint32_t c = p[0];
+  int extra = 0;
+
+  if (c >= 0xF0 && c < 0xF8)
+  {
+    c &= 0x07;
+    extra = 3;
+  }
+  else if (c >= 0xE0)
+  {
+    c &= 0x0F;
+    extra = 2;
+  }
+  else if (c >= 0xC0)
+  {
+    c &= 0x1F;
+    extra = 1;
+  }
+
+  for (int i = 1; i <= extra; i++)
+  {
+    if ((p[i] & 0xC0) != 0x80)
+    {
+      *text += 1;
+      return p[0];
+    }
+    c = (c << 6) | (p[i] & 0x3F);
+  }
+  *text += 1 + extra;
+  return c;
+}
+
+// Largest length <= limit (and <= length) that does not split a UTF-8 character
+static uint32_t CharBoundary(const char *text, uint32_t length, uint32_t limit)
+{
+  if (length <= limit)
+    return length;
+  while (limit && ((uint8_t)text[limit] & 0xC0) == 0x80)
+    limit--;
+  return limit;
+}
+
+bool EVE_Text_LoadROMFonts(void)
+{
+  uint8_t blocks[16 * LEGACY_BLOCK];
+  uint32_t root = rd32(ROM_FONTROOT);
+
+  if (!root)
+    return false;
+  rdN(root, blocks, sizeof(blocks)); // All sixteen metric blocks in one transfer
+  for (int i = 0; i < 16; i++)
+  {
+    ParseLegacy(&RomFonts[i], blocks + i * LEGACY_BLOCK);
+    Fonts[16 + i] = RomFonts[i];
+  }
+  return true;
+}
+
+bool EVE_Text_RomFont(uint8_t handle, uint8_t romFont)
+{
+  if (handle >= EVE_TEXT_HANDLES || romFont < 16 || romFont > 31)
+    return false;
+  if (!RomFonts[romFont - 16].Loaded)
+    return false;
+  Fonts[handle] = RomFonts[romFont - 16];
+  return true;
+}
+
+bool EVE_Text_SetLegacyFont(uint8_t handle, const uint8_t *block)
+{
+  if (handle >= EVE_TEXT_HANDLES)
+    return false;
+  ParseLegacy(&Fonts[handle], block);
+  return true;
+}
+
+bool EVE_Text_SetXFont(uint8_t handle, const uint8_t *xfont, uint32_t length, uint32_t address)
+{
+  if (handle >= EVE_TEXT_HANDLES || length < XFONT_HEADER || Word(xfont) != EVE_XFONT_SIGNATURE)
+    return false;
+
+  uint32_t count = Word(xfont + 36);
+  uint32_t pages = (count + 127) / 128;
+  if (XFONT_HEADER + 8 * pages > length)
+    return false;
+
+  Font *f = &Fonts[handle];
+  memset(f, 0, sizeof(*f));
+  f->Extended = true;
+  f->XFont = xfont;
+  f->XFontLength = length;
+  f->XFontAddress = address;
+  f->Count = count;
+  f->Height = (uint16_t)Word(xfont + 28); // pixel_height
+  for (uint32_t c = 0; c < 128; c++)
+    f->Widths[c] = XFontWidth(f, c);
+  f->Loaded = true;
+  return true;
+}
+
+bool EVE_Text_ReadXFont(uint8_t handle, uint32_t address, uint8_t *buffer, uint32_t size)
+{
+  if (size < XFONT_HEADER)
+    return false;
+  rdN(address, buffer, XFONT_HEADER);
+  if (Word(buffer) != EVE_XFONT_SIGNATURE)
+    return false;
+
+  uint32_t length = Word(buffer + 4); // The block records its own size
+  if (length < XFONT_HEADER || length > size)
+    return false;
+  rdN(address + XFONT_HEADER, buffer + XFONT_HEADER, length - XFONT_HEADER);
+  return EVE_Text_SetXFont(handle, buffer, length, address);
+}
+
+uint16_t EVE_Text_LineHeight(uint8_t handle)
+{
+  const Font *f = Get(handle);
+  return f ? f->Height : 0;
+}
+
+uint8_t EVE_Text_CharWidth(uint8_t handle, uint32_t codepoint)
+{
+  const Font *f = Get(handle);
+  return f ? Width(f, codepoint) : 0;
+}
+
+void EVE_MeasureText(uint8_t handle, const char *text, uint16_t *width, uint16_t *height)
+{
+  const Font *f = Get(handle);
+  uint32_t widest = 0, line = 0, lines = 1;
+
+  if (!f)
+  {
+    *width = *height = 0;
+    return;
+  }
+
+  while (*text)
+  {
+    uint8_t b = (uint8_t)*text;
+    if (b == '\n')
+    {
+      lines++;
+      line = 0;
+      text++;
+    }
+    else if (b < 0x80)
+    {
+      line += f->Widths[b]; // ASCII fast path
+      text++;
+    }
+    else
+    {
+      line += Width(f, NextChar(&text));
+    }
+    if (line > widest)
+      widest = line;
+  }
+  *width = (uint16_t)widest;
+  *height = (uint16_t)(lines * f->Height);
+}
+
+uint16_t EVE_Text_Wrap(
+    uint8_t handle, const char *text, uint16_t maxWidth, EVE_TextLine *lines, uint16_t maxLines)
+{
+  const Font *f = Get(handle);
+  uint16_t count = 0;
+  uint32_t start = 0, i = 0, width = 0;
+  int32_t space = -1;       // Last space in the line, where it can be broken
+  uint32_t widthBefore = 0; // Width of the line up to that space
+  uint32_t widthAfter = 0;  // ... and including it
+
+  if (!f)
+    return 0;
+
+  for (;;)
+  {
+    uint8_t b = (uint8_t)text[i];
+    uint32_t breakAt, skip, lineWidth;
+
+    if (b == 0 || b == '\n')
+    {
+      breakAt = i;
+      skip = b ? 1 : 0;
+      lineWidth = width;
+    }
+    else
+    {
+      const char *next = text + i;
+      uint32_t c = NextChar(&next);
+      uint32_t cw = Width(f, c);
+
+      if (width + cw <= maxWidth || i == start)
+      {
+        if (c == ' ')
+        {
+          space = (int32_t)i;
+          widthBefore = width;
+          widthAfter = width + cw;
+        }
+        width += cw;
+        i = (uint32_t)(next - text);
+        continue;
+      }
+
+      // Too wide - break at the last space, or right here if the word fills the line
+      if (space >= 0)
+      {
+        breakAt = (uint32_t)space;
+        skip = 1;
+        lineWidth = widthBefore;
+      }
+      else
+      {
+        breakAt = i;
+        skip = 0;
+        lineWidth = width;
+      }
+    }
+
+    if (count < maxLines)
+    {
+      lines[count].Start = start;
+      lines[count].Length = breakAt - start;
+      lines[count].Width = (uint16_t)lineWidth;
+    }
+    count++;
+    if (b == 0)
+      break;
+
+    if (b == '\n' || space < 0)
+    {
+      width = 0;
+      i = breakAt + skip;
+    }
+    else
+    {
+      width -= widthAfter; // What follows the space carries over to the next line
+    }
+    start = breakAt + skip;
+    space = -1;
+  }
+  return count;
+}
+
+uint32_t EVE_Text_Truncate(
+    uint8_t handle, const char *text, uint16_t maxWidth, char *out, uint32_t outSize)
+{
+  const Font *f = Get(handle);
+  const char *p = text;
+  uint32_t width = 0, kept;
+
+  if (!outSize)
+    return 0;
+  out[0] = 0;
+  if (!f)
+    return 0;
+
+  uint32_t dots = 3 * f->Widths['.'];
+  uint32_t fit = 0; // Bytes that fit with room left for the dots
+  while (*p)
+  {
+    const char *next = p;
+    uint32_t cw = Width(f, NextChar(&next));
+    if (width + cw > maxWidth)
+      break;
+    width += cw;
+    p = next;
+    if (width + dots <= maxWidth)
+      fit = (uint32_t)(p - text);
+  }
+
+  if (!*p) // Everything fits
+  {
+    kept = CharBoundary(text, (uint32_t)(p - text), outSize - 1);
+    memcpy(out, text, kept);
+    out[kept] = 0;
+    return kept;
+  }
+
+  if (outSize < 4)
+    return 0;
+  kept = CharBoundary(text, fit, outSize - 4);
+  memcpy(out, text, kept);
+  memcpy(out + kept, "...", 4);
+  return kept;
+}
@@ -0,0 +1,79 @@
+#ifndef __EVE_TEXT_H
+#define __EVE_TEXT_H
+
+// Text metrics and layout on the host
+//
+// Keeps the character widths of every font handle on the host so text can be measured, wrapped
+// and truncated without asking EVE.  Metrics come from:
+//  - the ROM fonts 16..31, read from the ROM font table in one burst by EVE_Text_LoadROMFonts()
+//  - the legacy 148 byte metric block of a custom font (CMD_SETFONT / CMD_SETFONT2)
+//  - the xfont block of an extended (BT81x) custom font, such as the *_xfont arrays made by the
+//    asset builder.  ROM fonts 32..34 are extended fonts too, read theirs with
+//    EVE_Text_ReadXFont().
+//
+// Strings are UTF-8, the same as Cmd_Text().  Plain ASCII runs take a fast path that is a table
+// lookup per byte.  Legacy fonts only cover the first 128 characters.
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_TEXT_HANDLES 32 // Font handles usable with Cmd_Text()
+#define EVE_XFONT_SIGNATURE 0x0100AAFF
+
+  typedef struct
+  {
+    uint32_t Start;  // Byte offset of the line in the string
+    uint32_t Length; // Bytes in the line, not counting the space or newline it was broken at
+    uint16_t Width;  // Pixels
+  } EVE_TextLine;
+
+  // Read the metrics of ROM fonts 16..31 and assign them to handles 16..31, as EVE does at reset
+  bool EVE_EXPORT EVE_Text_LoadROMFonts(void);
+  // Give handle the metrics of ROM font 16..31, to match a CMD_ROMFONT
+  bool EVE_EXPORT EVE_Text_RomFont(uint8_t handle, uint8_t romFont);
+  // Host copy of a legacy metric block (148 bytes), the block is copied
+  bool EVE_EXPORT EVE_Text_SetLegacyFont(uint8_t handle, const uint8_t *block);
+  // Host copy of an xfont block and the RAM_G address it was uploaded to.  The block is not
+  // copied and has to stay valid.
+  bool EVE_EXPORT EVE_Text_SetXFont(uint8_t handle,
+                                    const uint8_t *xfont,
+                                    uint32_t length,
+                                    uint32_t address);
+  // Read an xfont block from EVE memory into buffer and use it for handle
+  bool EVE_EXPORT EVE_Text_ReadXFont(uint8_t handle,
+                                     uint32_t address,
+                                     uint8_t *buffer,
+                                     uint32_t size);
+
+  uint16_t EVE_EXPORT EVE_Text_LineHeight(uint8_t handle);
+  uint8_t EVE_EXPORT EVE_Text_CharWidth(uint8_t handle, uint32_t codepoint);
+
+  // Width of the widest line and the height of all lines ('\n' starts a new line)
+  void EVE_EXPORT EVE_MeasureText(uint8_t handle,
+                                  const char *text,
+                                  uint16_t *width,
+                                  uint16_t *height);
+
+  // Break text into lines no wider than maxWidth, at spaces where possible and between characters
+  // where a single word is too wide.  '\n' always breaks.  Returns the number of lines, which can
+  // be more than maxLines - only the first maxLines are stored.
+  uint16_t EVE_EXPORT EVE_Text_Wrap(uint8_t handle,
+                                    const char *text,
+                                    uint16_t maxWidth,
+                                    EVE_TextLine *lines,
+                                    uint16_t maxLines);
+
+  // Copy as much of text as fits in maxWidth into out, ending with "..." if it was cut short.
+  // Returns the number of bytes of text that were kept.
+  uint32_t EVE_EXPORT EVE_Text_Truncate(
+      uint8_t handle, const char *text, uint16_t maxWidth, char *out, uint32_t outSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
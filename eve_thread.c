@@ -0,0 +1,350 @@
+// Threads - pthreads / Win32 wrappers, a worker pool and futures
+
+#include "eve_thread.h"
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef HANDLE Thread;
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Cond;
+
+#define MutexInit(m) InitializeCriticalSection(m)
+#define MutexFree(m) DeleteCriticalSection(m)
+#define Lock(m) EnterCriticalSection(m)
+#define Unlock(m) LeaveCriticalSection(m)
+#define CondInit(c) InitializeConditionVariable(c)
+#define CondFree(c)
+#define CondWait(c, m) SleepConditionVariableCS(c, m, INFINITE)
+#define CondWakeAll(c) WakeAllConditionVariable(c)
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Cond;
+
+#define MutexInit(m) pthread_mutex_init(m, NULL)
+#define MutexFree(m) pthread_mutex_destroy(m)
+#define Lock(m) pthread_mutex_lock(m)
+#define Unlock(m) pthread_mutex_unlock(m)
+#define CondInit(c) pthread_cond_init(c, NULL)
+#define CondFree(c) pthread_cond_destroy(c)
+#define CondWait(c, m) pthread_cond_wait(c, m)
+#define CondWakeAll(c) pthread_cond_broadcast(c)
+#endif
+
+#define MAX_THREADS 64
+
+struct EVE_Future
+{
+  EVE_TaskFn Task;
+  void *Context;
+  int Result;
+  bool Done;
+  uint8_t References; // The caller's and the worker's
+  Mutex Lock;
+  Cond Finished;
+  EVE_Future *Next; // Pool queue
+};
+
+struct EVE_Pool
+{
+  Thread Threads[MAX_THREADS];
+  uint8_t Count;
+  Mutex Lock;
+  Cond Work; // Signalled when a task is queued or the pool is closing
+  Cond Idle; // Signalled when a task finishes
+  EVE_Future *Head, *Tail;
+  uint32_t Running;
+  bool Closing;
+};
+
+#ifdef _WIN32
+typedef struct
+{
+  void *(*Entry)(void *);
+  void *Argument;
+} Trampoline;
+
+static DWORD WINAPI Bounce(LPVOID p)
+{
+  Trampoline t = *(Trampoline *)p;
+  free(p);
+  t.Entry(t.Argument);
+  return 0;
+}
+
+static bool Start(Thread *thread, void *(*entry)(void *), void *argument)
+{
+  Trampoline *t = malloc(sizeof(Trampoline));
+  if (!t)
+    return false;
+  t->Entry = entry;
+  t->Argument = argument;
+  *thread = CreateThread(NULL, 0, Bounce, t, 0, NULL);
+  if (!*thread)
+    free(t);
+  return *thread != NULL;
+}
+
+static void Join(Thread thread)
+{
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+
+static void Detach(Thread thread)
+{
+  CloseHandle(thread);
+}
+
+uint8_t EVE_CPU_Count(void)
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (uint8_t)(info.dwNumberOfProcessors > 255 ? 255 : info.dwNumberOfProcessors);
+}
+#else
+static bool Start(Thread *thread, void *(*entry)(void *), void *argument)
+{
+  return pthread_create(thread, NULL, entry, argument) == 0;
+}
+
+static void Join(Thread thread)
+{
+  pthread_join(thread, NULL);
+}
+
+static void Detach(Thread thread)
+{
+  pthread_detach(thread);
+}
+
+uint8_t EVE_CPU_Count(void)
+{
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (uint8_t)(n < 1 ? 1 : (n > 255 ? 255 : n));
+}
+#endif
+
+static EVE_Future *NewFuture(EVE_TaskFn task, void *context)
+{
+  EVE_Future *future = calloc(1, sizeof(EVE_Future));
+
+  if (!future)
+    return NULL;
+  future->Task = task;
+  future->Context = context;
+  future->References = 2;
+  MutexInit(&future->Lock);
+  CondInit(&future->Finished);
+  return future;
+}
+
+static void Release(EVE_Future *future)
+{
+  Lock(&future->Lock);
+  bool last = --future->References == 0;
+  Unlock(&future->Lock);
+  if (last)
+  {
+    MutexFree(&future->Lock);
+    CondFree(&future->Finished);
+    free(future);
+  }
+}
+
+// Run a future's task, publish the result and drop the worker's reference
+static void Complete(EVE_Future *future)
+{
+  int result = future->Task(future->Context);
+
+  Lock(&future->Lock);
+  future->Result = result;
+  future->Done = true;
+  CondWakeAll(&future->Finished);
+  Unlock(&future->Lock);
+  Release(future);
+}
+
+static void *Worker(void *argument)
+{
+  EVE_Pool *pool = argument;
+
+  Lock(&pool->Lock);
+  for (;;)
+  {
+    while (!pool->Head && !pool->Closing)
+      CondWait(&pool->Work, &pool->Lock);
+    if (!pool->Head)
+      break; // Closing and nothing left to do
+
+    EVE_Future *future = pool->Head;
+    pool->Head = future->Next;
+    if (!pool->Head)
+      pool->Tail = NULL;
+    pool->Running++;
+    Unlock(&pool->Lock);
+
+    Complete(future);
+
+    Lock(&pool->Lock);
+    pool->Running--;
+    CondWakeAll(&pool->Idle);
+  }
+  Unlock(&pool->Lock);
+  return NULL;
+}
+
+EVE_Pool *EVE_Pool_Create(uint8_t threads)
+{
+  EVE_Pool *pool = calloc(1, sizeof(EVE_Pool));
+
+  if (!pool)
+    return NULL;
+  if (!threads)
+    threads = EVE_CPU_Count();
+  if (threads > MAX_THREADS)
+    threads = MAX_THREADS;
+
+  MutexInit(&pool->Lock);
+  CondInit(&pool->Work);
+  CondInit(&pool->Idle);
+  for (uint8_t i = 0; i < threads; i++)
+  {
+    if (!Start(&pool->Threads[pool->Count], Worker, pool))
+      break;
+    pool->Count++;
+  }
+  if (!pool->Count)
+  {
+    EVE_Pool_Destroy(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+void EVE_Pool_Destroy(EVE_Pool *pool)
+{
+  if (!pool)
+    return;
+  Lock(&pool->Lock);
+  pool->Closing = true;
+  CondWakeAll(&pool->Work);
+  Unlock(&pool->Lock);
+  for (uint8_t i = 0; i < pool->Count; i++)
+    Join(pool->Threads[i]);
+
+  MutexFree(&pool->Lock);
+  CondFree(&pool->Work);
+  CondFree(&pool->Idle);
+  free(pool);
+}
+
+uint8_t EVE_Pool_Threads(const EVE_Pool *pool)
+{
+  return pool->Count;
+}
+
+EVE_Future *EVE_Pool_Run(EVE_Pool *pool, EVE_TaskFn task, void *context)
+{
+  EVE_Future *future = NewFuture(task, context);
+
+  if (!future)
+    return NULL;
+  Lock(&pool->Lock);
+  if (pool->Tail)
+    pool->Tail->Next = future;
+  else
+    pool->Head = future;
+  pool->Tail = future;
+  CondWakeAll(&pool->Work);
+  Unlock(&pool->Lock);
+  return future;
+}
+
+void EVE_Pool_Wait(EVE_Pool *pool)
+{
+  Lock(&pool->Lock);
+  while (pool->Head || pool->Running)
+    CondWait(&pool->Idle, &pool->Lock);
+  Unlock(&pool->Lock);
+}
+
+static void *Solo(void *argument)
+{
+  Complete(argument);
+  return NULL;
+}
+
+EVE_Future *EVE_Thread_Run(EVE_TaskFn task, void *context)
+{
+  EVE_Future *future = NewFuture(task, context);
+  Thread thread;
+
+  if (!future)
+    return NULL;
+  if (!Start(&thread, Solo, future))
+  {
+    // No thread to be had, run it here instead so the caller still gets a result
+    Complete(future);
+    return future;
+  }
+  Detach(thread);
+  return future;
+}
+
+bool EVE_Future_Ready(EVE_Future *future)
+{
+  Lock(&future->Lock);
+  bool done = future->Done;
+  Unlock(&future->Lock);
+  return done;
+}
+
+int EVE_Future_Wait(EVE_Future *future)
+{
+  Lock(&future->Lock);
+  while (!future->Done)
+    CondWait(&future->Finished, &future->Lock);
+  int result = future->Result;
+  Unlock(&future->Lock);
+  return result;
+}
+
+void EVE_Future_Free(EVE_Future *future)
+{
+  if (future)
+    Release(future);
+}
+
+typedef struct
+{
+  int Display, Board, Touch;
+} InitArguments;
+
+static int Init(void *context)
+{
+  InitArguments *a = context;
+  int result = EVE_Init(a->Display, a->Board, a->Touch);
+  free(a);
+  return result;
+}
+
+EVE_Future *EVE_Init_Async(int display, int board, int touch)
+{
+  InitArguments *a = malloc(sizeof(InitArguments));
+
+  if (!a)
+    return NULL;
+  a->Display = display;
+  a->Board = board;
+  a->Touch = touch;
+  EVE_Future *future = EVE_Thread_Run(Init, a);
+  if (!future)
+    free(a);
+  return future;
+}
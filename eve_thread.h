@@ -0,0 +1,61 @@
+#ifndef __EVE_THREAD_H
+#define __EVE_THREAD_H
+
+// Threads, a thread pool and futures
+//
+// A thin layer over pthreads and Win32 threads.  The first use is boot time: EVE_Init() spends
+// most of its time in HAL_Delay() waiting for the hardware, so EVE_Init_Async() runs it on a
+// thread of its own while the application prepares assets (decoding, quantising, CRCs) on a
+// pool.  Boot then takes the longer of the two rather than their sum:
+//
+//   EVE_Future *init = EVE_Init_Async(config.Display, config.Board, config.Touch);
+//   EVE_Pool *pool = EVE_Pool_Create(0);
+//   EVE_Future_Free(EVE_Pool_Run(pool, ConvertImages, &images));
+//   EVE_Pool_Wait(pool);
+//   if (EVE_Future_Wait(init) <= 1) ... not detected
+//
+// The rest of the library is not thread safe.  Nothing may talk to EVE until the init future has
+// finished, and pool tasks should only work on host memory.
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  typedef int (*EVE_TaskFn)(void *context);
+
+  typedef struct EVE_Pool EVE_Pool;
+  typedef struct EVE_Future EVE_Future;
+
+  // Hardware threads on this machine
+  uint8_t EVE_EXPORT EVE_CPU_Count(void);
+
+  // Pool with this many worker threads, 0 for one per core.  NULL if no thread could be made.
+  EVE_Pool EVE_EXPORT *EVE_Pool_Create(uint8_t threads);
+  // Finishes every queued task first
+  void EVE_EXPORT EVE_Pool_Destroy(EVE_Pool *pool);
+  uint8_t EVE_EXPORT EVE_Pool_Threads(const EVE_Pool *pool);
+  // Queue task.  The future has to be freed, which can be done at once when the result is not
+  // wanted.  NULL if out of memory.
+  EVE_Future EVE_EXPORT *EVE_Pool_Run(EVE_Pool *pool, EVE_TaskFn task, void *context);
+  // Wait until every task queued so far has finished
+  void EVE_EXPORT EVE_Pool_Wait(EVE_Pool *pool);
+
+  // Run task on a thread of its own
+  EVE_Future EVE_EXPORT *EVE_Thread_Run(EVE_TaskFn task, void *context);
+
+  bool EVE_EXPORT EVE_Future_Ready(EVE_Future *future);
+  // Wait for the task and return what it returned
+  int EVE_EXPORT EVE_Future_Wait(EVE_Future *future);
+  void EVE_EXPORT EVE_Future_Free(EVE_Future *future);
+
+  // EVE_Init() on a thread of its own, the future's result is what EVE_Init() returned
+  EVE_Future EVE_EXPORT *EVE_Init_Async(int display, int board, int touch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
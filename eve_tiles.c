@@ -0,0 +1,311 @@
+// Tiled images - RAM_G tile cache with LRU reuse, loads from a host or flash bundle, prefetching
+
+#include "eve_tiles.h"
+#include "hw_api.h"
+
+#define PINNED_FRAMES 2 // Frames before the current one whose tiles may still be on screen
+
+bool EVE_Tiles_Init(EVE_TiledImage *tiles,
+                    uint32_t width,
+                    uint32_t height,
+                    uint8_t format,
+                    uint16_t tileWidth,
+                    uint16_t tileHeight,
+                    uint16_t cacheTiles)
+{
+  uint32_t bits = Bitmap_BitsPerPixel(format);
+
+  memset(tiles, 0, sizeof(*tiles));
+  tiles->Region = -1;
+  if (!bits || !tileWidth || !tileHeight || (tileWidth * bits) % 8)
+    return false;
+  if (cacheTiles > EVE_TILES_SLOTS)
+    cacheTiles = EVE_TILES_SLOTS;
+
+  tiles->Width = width;
+  tiles->Height = height;
+  tiles->Format = format;
+  tiles->TileWidth = tileWidth;
+  tiles->TileHeight = tileHeight;
+  tiles->Columns = (uint16_t)((width + tileWidth - 1) / tileWidth);
+  tiles->Rows = (uint16_t)((height + tileHeight - 1) / tileHeight);
+  tiles->LineStride = (uint16_t)(tileWidth * bits / 8);
+  tiles->TileBytes = (uint32_t)tiles->LineStride * tileHeight;
+  tiles->TileStride = (tiles->TileBytes + EVE_TILES_ALIGN - 1) & ~(uint32_t)(EVE_TILES_ALIGN - 1);
+  tiles->Slots = cacheTiles;
+  tiles->Region = EVE_RamG_Alloc(tiles->TileStride * cacheTiles);
+  return tiles->Region >= 0;
+}
+
+void EVE_Tiles_Free(EVE_TiledImage *tiles)
+{
+  EVE_RamG_Free(tiles->Region);
+  tiles->Region = -1;
+  tiles->Slots = 0;
+}
+
+void EVE_Tiles_FromBundle(EVE_TiledImage *tiles, const uint8_t *bundle)
+{
+  tiles->Bundle = bundle;
+  memset(tiles->Slot, 0, sizeof(tiles->Slot)); // Whatever is cached came from somewhere else
+}
+
+void EVE_Tiles_FromFlash(EVE_TiledImage *tiles, uint32_t flashAddress)
+{
+  tiles->Bundle = NULL;
+  tiles->FlashAddress = flashAddress;
+  memset(tiles->Slot, 0, sizeof(tiles->Slot));
+}
+
+uint32_t EVE_Tiles_BundleSize(const EVE_TiledImage *tiles)
+{
+  return (uint32_t)tiles->Columns * tiles->Rows * tiles->TileStride;
+}
+
+void EVE_Tiles_Cut(const EVE_TiledImage *tiles,
+                   const uint8_t *pixels,
+                   uint32_t pitch,
+                   uint8_t *bundle)
+{
+  uint32_t bits = Bitmap_BitsPerPixel(tiles->Format);
+  uint32_t imageRow = (tiles->Width * bits + 7) / 8; // Bytes of real pixels in an image row
+
+  memset(bundle, 0, EVE_Tiles_BundleSize(tiles));
+  for (uint32_t row = 0; row < tiles->Rows; row++)
+  {
+    for (uint32_t col = 0; col < tiles->Columns; col++)
+    {
+      uint8_t *tile = bundle + (row * tiles->Columns + col) * tiles->TileStride;
+      uint32_t left = col * tiles->LineStride;
+      uint32_t bytes = imageRow - left < tiles->LineStride ? imageRow - left : tiles->LineStride;
+
+      for (uint32_t y = 0; y < tiles->TileHeight; y++)
+      {
+        uint32_t line = row * tiles->TileHeight + y;
+        if (line >= tiles->Height)
+          break;
+        memcpy(tile + y * tiles->LineStride, pixels + line * pitch + left, bytes);
+      }
+    }
+  }
+}
+
+static uint32_t SlotAddress(const EVE_TiledImage *tiles, int slot)
+{
+  return EVE_RamG_Address(tiles->Region) + (uint32_t)slot * tiles->TileStride;
+}
+
+static int Lookup(const EVE_TiledImage *tiles, uint32_t tile)
+{
+  for (int i = 0; i < tiles->Slots; i++)
+  {
+    if (tiles->Slot[i].Used && tiles->Slot[i].Tile == tile)
+      return i;
+  }
+  return -1;
+}
+
+// Load tile into a free slot, or the least recently used one that is not on screen.  Returns the
+// slot, or -1 if every slot is pinned.
+static int Load(EVE_TiledImage *tiles, uint32_t tile)
+{
+  int victim = -1;
+
+  for (int i = 0; i < tiles->Slots; i++)
+  {
+    EVE_TileSlot *s = &tiles->Slot[i];
+    if (!s->Used)
+    {
+      victim = i;
+      break;
+    }
+    if (s->LastDrawn && tiles->Frame - s->LastDrawn <= PINNED_FRAMES)
+      continue;
+    if (victim < 0 || s->LastUsed < tiles->Slot[victim].LastUsed)
+      victim = i;
+  }
+  if (victim < 0)
+    return -1;
+
+  uint32_t address = SlotAddress(tiles, victim);
+  uint32_t offset = tile * tiles->TileStride;
+  uint32_t bytes = (tiles->TileBytes + 3) & ~3UL;
+  if (tiles->Bundle)
+    WriteBlockRAM(address, tiles->Bundle + offset, bytes);
+  else if (CoProCapture_Active())
+    Cmd_FlashRead(address, tiles->FlashAddress + offset, bytes); // Goes out with the frame
+  else
+  {
+    // Straight into the FIFO, so wait for room for the four words first.  The free space is
+    // worked out from REG_CMD_WRITE, hence the updates on either side.
+    UpdateFIFO();
+    Wait4CoProFIFO(4 * FT_CMD_SIZE);
+    Cmd_FlashRead(address, tiles->FlashAddress + offset, bytes);
+    UpdateFIFO();
+  }
+
+  EVE_TileSlot *s = &tiles->Slot[victim];
+  s->Tile = tile;
+  s->LastUsed = ++tiles->Tick;
+  s->LastDrawn = 0;
+  s->Used = true;
+  tiles->Stats.BytesLoaded += bytes;
+  return victim;
+}
+
+// Tile columns and rows that overlap a viewport, clipped to the image
+static void Visible(const EVE_TiledImage *tiles,
+                    int32_t scrollX,
+                    int32_t scrollY,
+                    uint16_t w,
+                    uint16_t h,
+                    int32_t *range)
+{
+  range[0] = scrollX < 0 ? 0 : scrollX / tiles->TileWidth;
+  range[1] = scrollY < 0 ? 0 : scrollY / tiles->TileHeight;
+  range[2] = scrollX + w <= 0 ? -1 : (scrollX + w - 1) / tiles->TileWidth;
+  range[3] = scrollY + h <= 0 ? -1 : (scrollY + h - 1) / tiles->TileHeight;
+  if (range[2] >= tiles->Columns)
+    range[2] = tiles->Columns - 1;
+  if (range[3] >= tiles->Rows)
+    range[3] = tiles->Rows - 1;
+}
+
+uint16_t EVE_Tiles_Draw(EVE_TiledImage *tiles,
+                        uint8_t handle,
+                        int32_t scrollX,
+                        int32_t scrollY,
+                        int16_t x,
+                        int16_t y,
+                        uint16_t w,
+                        uint16_t h)
+{
+  int32_t range[4];
+  uint16_t drawn = 0;
+
+  if (tiles->Region < 0 || !w || !h)
+    return 0;
+
+  tiles->Frame++;
+  if (tiles->Frame > 1)
+  {
+    tiles->DirX = (int8_t)((scrollX > tiles->ScrollX) - (scrollX < tiles->ScrollX));
+    tiles->DirY = (int8_t)((scrollY > tiles->ScrollY) - (scrollY < tiles->ScrollY));
+  }
+  tiles->ScrollX = scrollX;
+  tiles->ScrollY = scrollY;
+  tiles->ViewWidth = w;
+  tiles->ViewHeight = h;
+
+  uint32_t setup[] = {
+      SAVE_CONTEXT(),
+      SCISSOR_XY(x, y),
+      SCISSOR_SIZE(w, h),
+      VERTEXFORMAT(0),
+      BITMAP_HANDLE(handle),
+      BITMAP_LAYOUT(tiles->Format, tiles->LineStride, tiles->TileHeight),
+      BITMAP_LAYOUT_H(tiles->LineStride, tiles->TileHeight),
+      BITMAP_SIZE(NEAREST, BORDER, BORDER, tiles->TileWidth, tiles->TileHeight),
+      BITMAP_SIZE_H(tiles->TileWidth, tiles->TileHeight),
+      BEGIN(BITMAPS),
+  };
+  Send_CMDs(setup, sizeof(setup) / sizeof(setup[0]));
+
+  Visible(tiles, scrollX, scrollY, w, h, range);
+  for (int32_t row = range[1]; row <= range[3]; row++)
+  {
+    for (int32_t col = range[0]; col <= range[2]; col++)
+    {
+      uint32_t tile = (uint32_t)row * tiles->Columns + (uint32_t)col;
+      int slot = Lookup(tiles, tile);
+
+      if (slot >= 0)
+      {
+        tiles->Stats.Hits++;
+      }
+      else if ((slot = Load(tiles, tile)) >= 0)
+      {
+        tiles->Stats.Misses++;
+      }
+      else
+      {
+        tiles->Stats.Dropped++;
+        continue;
+      }
+      tiles->Slot[slot].LastUsed = ++tiles->Tick;
+      tiles->Slot[slot].LastDrawn = tiles->Frame;
+
+      uint32_t dl[2] = {
+          BITMAP_SOURCE(SlotAddress(tiles, slot)),
+          VERTEX2F(x + col * tiles->TileWidth - scrollX, y + row * tiles->TileHeight - scrollY),
+      };
+      Send_CMDs(dl, 2);
+      drawn++;
+    }
+  }
+
+  Send_CMD(END());
+  Send_CMD(RESTORE_CONTEXT());
+  return drawn;
+}
+
+#define AHEAD_MAX (2 * EVE_TILES_SLOTS)
+
+// Tiles one step past the last viewport in the direction it moved
+static uint16_t Ahead(const EVE_TiledImage *tiles, uint32_t *out)
+{
+  int32_t range[4];
+  uint16_t n = 0;
+
+  Visible(tiles, tiles->ScrollX, tiles->ScrollY, tiles->ViewWidth, tiles->ViewHeight, range);
+  int32_t col = tiles->DirX > 0 ? range[2] + 1 : range[0] - 1;
+  int32_t row = tiles->DirY > 0 ? range[3] + 1 : range[1] - 1;
+
+  if (tiles->DirX && col >= 0 && col < tiles->Columns)
+  {
+    for (int32_t r = range[1]; r <= range[3] && n < AHEAD_MAX; r++)
+      out[n++] = (uint32_t)r * tiles->Columns + (uint32_t)col;
+  }
+  if (tiles->DirY && row >= 0 && row < tiles->Rows)
+  {
+    for (int32_t c = range[0]; c <= range[2] && n < AHEAD_MAX; c++)
+      out[n++] = (uint32_t)row * tiles->Columns + (uint32_t)c;
+    if (tiles->DirX && col >= 0 && col < tiles->Columns)
+      out[n++] = (uint32_t)row * tiles->Columns + (uint32_t)col; // Diagonal corner
+  }
+  return n;
+}
+
+uint16_t EVE_Tiles_Prefetch(EVE_TiledImage *tiles, uint32_t budget_us)
+{
+  uint32_t ahead[AHEAD_MAX + 1];
+  uint16_t loaded = 0;
+  uint64_t start = HAL_Micros();
+
+  if (tiles->Region < 0 || (!tiles->DirX && !tiles->DirY) || !tiles->ViewWidth)
+    return 0;
+
+  uint16_t count = Ahead(tiles, ahead);
+  for (uint16_t i = 0; i < count && loaded < tiles->Slots; i++)
+  {
+    if (HAL_Micros() - start >= budget_us)
+      break;
+    if (Lookup(tiles, ahead[i]) >= 0)
+      continue;
+    if (Load(tiles, ahead[i]) < 0)
+      break; // Nothing left that can be reused
+    loaded++;
+  }
+  tiles->Stats.Prefetched += loaded;
+  return loaded;
+}
+
+void EVE_Tiles_Idle(void *context)
+{
+  EVE_Tiles_Prefetch((EVE_TiledImage *)context, EVE_TILES_IDLE_US);
+}
+
+const EVE_TileStats *EVE_Tiles_Stats(const EVE_TiledImage *tiles)
+{
+  return &tiles->Stats;
+}
@@ -0,0 +1,120 @@
+#ifndef __EVE_TILES_H
+#define __EVE_TILES_H
+
+// Tiled images larger than RAM_G
+//
+// A large image is cut into fixed size tiles in the bitmap format EVE draws (EVE_Tiles_Cut() does
+// this on the host).  The tiles are kept in a bundle, either in host memory or in EVE's flash,
+// and only the tiles around the viewport sit in a RAM_G cache.  Drawing a viewport sets the tile
+// handle up once and then costs two words a visible tile, BITMAP_SOURCE and VERTEX2F.
+//
+// Tiles that are not cached are loaded when they are drawn.  To keep that off the frame,
+// EVE_Tiles_Prefetch() loads the tiles just past the edge the view is moving towards.  It fits
+// the frame scheduler's idle callback (EVE_Tiles_Idle()), so prefetching happens while the host
+// would otherwise wait for the panel.  That callback runs before the next frame is submitted, and
+// each CMD_FLASHREAD waits for room in the FIFO before it goes in.
+//
+// The cache never reuses a tile drawn in the last three frames, since EVE may still be showing
+// it (the frame scheduler lets one frame be queued behind the one on screen).  Size it for the
+// visible tiles plus the ring around them, at least.  Flash bundles are read with CMD_FLASHREAD,
+// so the flash has to be attached and in full speed mode (FlashFast()).
+
+#include "eve.h"
+#include "eve_memory.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_TILES_SLOTS 64     // Largest tile cache
+#define EVE_TILES_ALIGN 64     // Tiles in a bundle start on this boundary, as CMD_FLASHREAD needs
+#define EVE_TILES_IDLE_US 1000 // Prefetch time EVE_Tiles_Idle() allows itself per call
+
+  typedef struct
+  {
+    uint32_t Hits;      // Visible tiles that were already cached
+    uint32_t Misses;    // Visible tiles that had to be loaded while drawing
+    uint32_t Prefetched;
+    uint32_t Dropped;   // Visible tiles skipped because the cache was full of pinned tiles
+    uint32_t BytesLoaded;
+  } EVE_TileStats;
+
+  typedef struct
+  {
+    uint32_t Tile;      // Row * Columns + column
+    uint32_t LastUsed;  // Tick of the last draw or load, for LRU
+    uint32_t LastDrawn; // Frame it was last drawn in, 0 for never
+    bool Used;
+  } EVE_TileSlot;
+
+  typedef struct
+  {
+    uint32_t Width, Height; // Whole image in pixels
+    uint16_t TileWidth, TileHeight;
+    uint16_t Columns, Rows;
+    uint8_t Format;
+    uint16_t LineStride;
+    uint32_t TileBytes;
+    uint32_t TileStride;   // Bytes between tiles in the bundle and in the cache
+    const uint8_t *Bundle; // Host bundle, NULL for a flash one
+    uint32_t FlashAddress;
+    EVE_Region Region;
+    uint16_t Slots;
+    EVE_TileSlot Slot[EVE_TILES_SLOTS];
+    uint32_t Frame;
+    uint32_t Tick;
+    int32_t ScrollX, ScrollY; // Viewport of the last draw
+    uint16_t ViewWidth, ViewHeight;
+    int8_t DirX, DirY; // Direction the view last moved in
+    EVE_TileStats Stats;
+  } EVE_TiledImage;
+
+  // Set up a width x height image cut into tileWidth x tileHeight tiles of format, and allocate a
+  // RAM_G cache of cacheTiles tiles.  Returns false for a format that can not be tiled (the tile
+  // rows have to be whole bytes) or if RAM_G is full.
+  bool EVE_EXPORT EVE_Tiles_Init(EVE_TiledImage *tiles,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 uint8_t format,
+                                 uint16_t tileWidth,
+                                 uint16_t tileHeight,
+                                 uint16_t cacheTiles);
+  void EVE_EXPORT EVE_Tiles_Free(EVE_TiledImage *tiles);
+
+  // Where the bundle is.  A host bundle has to stay valid while it is in use.
+  void EVE_EXPORT EVE_Tiles_FromBundle(EVE_TiledImage *tiles, const uint8_t *bundle);
+  void EVE_EXPORT EVE_Tiles_FromFlash(EVE_TiledImage *tiles, uint32_t flashAddress);
+
+  // Bytes in the bundle for tiles
+  uint32_t EVE_EXPORT EVE_Tiles_BundleSize(const EVE_TiledImage *tiles);
+  // Cut an image already in the tiles' format into a bundle.  pitch is the bytes between image
+  // rows.  Tiles on the right and bottom edges are padded with zeros.
+  void EVE_EXPORT EVE_Tiles_Cut(const EVE_TiledImage *tiles,
+                                const uint8_t *pixels,
+                                uint32_t pitch,
+                                uint8_t *bundle);
+
+  // Draw the part of the image starting at (scrollX, scrollY) into the w x h screen area at
+  // (x, y), using handle.  Returns the number of tiles drawn.
+  uint16_t EVE_EXPORT EVE_Tiles_Draw(EVE_TiledImage *tiles,
+                                     uint8_t handle,
+                                     int32_t scrollX,
+                                     int32_t scrollY,
+                                     int16_t x,
+                                     int16_t y,
+                                     uint16_t w,
+                                     uint16_t h);
+
+  // Load tiles ahead of the scroll direction for up to budget_us.  Returns how many were loaded.
+  uint16_t EVE_EXPORT EVE_Tiles_Prefetch(EVE_TiledImage *tiles, uint32_t budget_us);
+  // EVE_FrameIdleFn that prefetches for the EVE_TiledImage passed as context
+  void EVE_EXPORT EVE_Tiles_Idle(void *context);
+
+  const EVE_TileStats EVE_EXPORT *EVE_Tiles_Stats(const EVE_TiledImage *tiles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
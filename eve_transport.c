@@ -0,0 +1,233 @@
+// Transport scheduler - interactive and bulk queues, bulk sliced to a latency budget
+
+#include "eve_transport.h"
+#include "eve_bridge.h"
+#include "hw_api.h"
+
+typedef enum
+{
+  JOB_WRITE,
+  JOB_COMMANDS,
+  JOB_CALL
+} JobKind;
+
+typedef struct
+{
+  JobKind Kind;
+  uint32_t Address;
+  const uint8_t *Data;
+  uint32_t Length;
+  uint32_t Done; // Bytes sent so far
+  EVE_TransportFn Work;
+  EVE_TransportDoneFn Finished;
+  void *Context;
+  uint64_t Queued;
+  bool Started;
+} Job;
+
+typedef struct
+{
+  Job Jobs[EVE_TRANSPORT_JOBS];
+  uint8_t Head;
+  uint8_t Count;
+  EVE_QueueStats Stats;
+} Queue;
+
+static Queue Queues[EVE_QUEUE_COUNT];
+static uint32_t Budget = EVE_TRANSPORT_BUDGET_US;
+static uint32_t BytesPerMs = 4096; // Measured bus rate, starts as a guess
+
+void EVE_Transport_Init(uint32_t budget_us)
+{
+  memset(Queues, 0, sizeof(Queues));
+  Budget = budget_us ? budget_us : EVE_TRANSPORT_BUDGET_US;
+}
+
+static Job *Push(EVE_Queue queue)
+{
+  if (queue >= EVE_QUEUE_COUNT || Queues[queue].Count >= EVE_TRANSPORT_JOBS)
+    return NULL;
+
+  Queue *q = &Queues[queue];
+  Job *job = &q->Jobs[(q->Head + q->Count++) % EVE_TRANSPORT_JOBS];
+  memset(job, 0, sizeof(*job));
+  job->Queued = HAL_Micros();
+  q->Stats.Pending++;
+  return job;
+}
+
+bool EVE_Transport_Write(EVE_Queue queue,
+                         uint32_t address,
+                         const uint8_t *data,
+                         uint32_t length,
+                         EVE_TransportDoneFn done,
+                         void *context)
+{
+  Job *job = Push(queue);
+
+  if (!job)
+    return false;
+  job->Kind = JOB_WRITE;
+  job->Address = address;
+  job->Data = data;
+  job->Length = length;
+  job->Finished = done;
+  job->Context = context;
+  return true;
+}
+
+bool EVE_Transport_Commands(EVE_Queue queue,
+                            const uint8_t *data,
+                            uint32_t length,
+                            EVE_TransportDoneFn done,
+                            void *context)
+{
+  Job *job = Push(queue);
+
+  if (!job)
+    return false;
+  job->Kind = JOB_COMMANDS;
+  job->Data = data;
+  job->Length = length;
+  job->Finished = done;
+  job->Context = context;
+  return true;
+}
+
+bool EVE_Transport_Call(EVE_Queue queue, EVE_TransportFn work, void *context)
+{
+  Job *job = Push(queue);
+
+  if (!job)
+    return false;
+  job->Kind = JOB_CALL;
+  job->Work = work;
+  job->Context = context;
+  return true;
+}
+
+// Move up to limit bytes of the job at the head of queue (call and command jobs ignore limit).
+// Returns true when the job is finished.
+static bool Step(EVE_Queue queue, uint32_t limit)
+{
+  Queue *q = &Queues[queue];
+  Job *job = &q->Jobs[q->Head];
+  uint64_t start = HAL_Micros();
+  uint32_t bytes = 0;
+  bool finished;
+
+  if (!job->Started)
+  {
+    uint32_t wait = (uint32_t)(start - job->Queued);
+    if (wait > q->Stats.MaxWait_us)
+      q->Stats.MaxWait_us = wait;
+    job->Started = true;
+  }
+
+  if (job->Kind == JOB_CALL)
+  {
+    finished = job->Work(job->Context);
+  }
+  else
+  {
+    bytes = job->Length - job->Done;
+    // A command stream is sent whole.  The transport does not know where its commands end, and
+    // a cut inside one (the payload of a CMD_FLASHWRITE or CMD_INFLATE, say) would let the next
+    // FIFO writer - an interactive job, or a frame once this returns - land in the middle of it.
+    if (job->Kind == JOB_WRITE && bytes > limit)
+      bytes = limit;
+
+    if (job->Kind == JOB_WRITE)
+      WriteBlockRAM(job->Address + job->Done, job->Data + job->Done, bytes);
+    else
+      CoProWrCmdBuf(job->Data + job->Done, bytes);
+    job->Done += bytes;
+    finished = job->Done >= job->Length;
+  }
+
+  uint32_t took = (uint32_t)(HAL_Micros() - start);
+  q->Stats.Bytes += bytes;
+  q->Stats.Busy_us += took;
+  if (q->Stats.Busy_us)
+    q->Stats.Throughput = (uint32_t)(q->Stats.Bytes * 1000000 / q->Stats.Busy_us);
+  if (bytes >= EVE_TRANSPORT_MIN_SLICE && took)
+  {
+    // Follow the bus rate, a quarter of the way towards each new measurement
+    uint64_t rate = (uint64_t)bytes * 1000 / took;
+    BytesPerMs = (uint32_t)((3 * (uint64_t)BytesPerMs + rate) / 4);
+  }
+
+  if (finished)
+  {
+    q->Head = (uint8_t)((q->Head + 1) % EVE_TRANSPORT_JOBS);
+    q->Count--;
+    q->Stats.Pending--;
+    q->Stats.Jobs++;
+    if (job->Finished)
+      job->Finished(job->Context);
+  }
+  return finished;
+}
+
+// Slice that should take about time_us on the measured bus rate
+static uint32_t SliceFor(uint64_t time_us)
+{
+  uint64_t slice = time_us * BytesPerMs / 1000;
+
+  if (slice < EVE_TRANSPORT_MIN_SLICE)
+    slice = EVE_TRANSPORT_MIN_SLICE;
+  if (slice > EVE_TRANSPORT_MAX_SLICE)
+    slice = EVE_TRANSPORT_MAX_SLICE;
+  return (uint32_t)slice;
+}
+
+bool EVE_Transport_Service(void)
+{
+  uint64_t start = HAL_Micros();
+  Queue *interactive = &Queues[EVE_QUEUE_INTERACTIVE];
+  Queue *bulk = &Queues[EVE_QUEUE_BULK];
+
+  // Interactive work first and in full, it is what the budget protects
+  while (interactive->Count)
+  {
+    bool call = interactive->Jobs[interactive->Head].Kind == JOB_CALL;
+    if (!Step(EVE_QUEUE_INTERACTIVE, EVE_TRANSPORT_MAX_SLICE) && call)
+      break; // A call that is not done yet gets another go next time
+  }
+
+  // The bridge runs its bulk profile from the first bulk slice until the queue is empty
+  if (bulk->Count)
+    EVE_Bridge_Use(EVE_PROFILE_BULK);
+  while (bulk->Count)
+  {
+    uint64_t used = HAL_Micros() - start;
+    if (used >= Budget)
+      break;
+    Step(EVE_QUEUE_BULK, SliceFor(Budget - used));
+  }
+  if (!bulk->Count)
+    EVE_Bridge_Use(EVE_PROFILE_INTERACTIVE);
+  return interactive->Count || bulk->Count;
+}
+
+void EVE_Transport_Idle(void *context)
+{
+  (void)context;
+  EVE_Transport_Service();
+}
+
+void EVE_Transport_Flush(EVE_Queue queue)
+{
+  if (queue >= EVE_QUEUE_COUNT)
+    return;
+  if (queue == EVE_QUEUE_BULK && Queues[queue].Count)
+    EVE_Bridge_Use(EVE_PROFILE_BULK);
+  while (Queues[queue].Count)
+    Step(queue, EVE_TRANSPORT_MAX_SLICE);
+  EVE_Bridge_Use(EVE_PROFILE_INTERACTIVE);
+}
+
+const EVE_QueueStats *EVE_Transport_Stats(EVE_Queue queue)
+{
+  return queue < EVE_QUEUE_COUNT ? &Queues[queue].Stats : NULL;
+}
@@ -0,0 +1,91 @@
+#ifndef __EVE_TRANSPORT_H
+#define __EVE_TRANSPORT_H
+
+// Transport scheduler
+//
+// Large uploads through WriteBlockRAM() or CoProWrCmdBuf() hold the bus until they finish, and
+// frames and touch reads stall behind them.  Here uploads are queued instead and moved a slice
+// at a time by EVE_Transport_Service(), which returns within the latency budget.  Call it from
+// the main loop, or hand EVE_Transport_Idle() to the frame scheduler so slices fill the time
+// spent waiting for the panel.
+//
+// There are two queues.  Interactive jobs always go first and are not sliced against the budget;
+// they are meant for short work such as reading touch or sending a frame.  Bulk jobs (asset
+// uploads, long command streams such as flash writes) get the rest of the budget.  Only RAM_G
+// writes are sliced; command streams are sent whole, see EVE_Transport_Commands().  The slice
+// size follows the measured bus throughput, so a slice takes about as long as the budget allows
+// whatever the bridge.  While bulk jobs are queued the bridge runs its bulk profile (see
+// eve_bridge.h), if one was set.
+
+#include "eve.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVE_TRANSPORT_JOBS 32           // Per queue
+#define EVE_TRANSPORT_BUDGET_US 2000    // Default latency budget of a service call
+#define EVE_TRANSPORT_MIN_SLICE 256     // Bytes
+#define EVE_TRANSPORT_MAX_SLICE 32768
+
+  typedef enum
+  {
+    EVE_QUEUE_INTERACTIVE,
+    EVE_QUEUE_BULK,
+    EVE_QUEUE_COUNT
+  } EVE_Queue;
+
+  // Work for a call job.  Called once per service until it returns true.
+  typedef bool (*EVE_TransportFn)(void *context);
+  // Called when a job has finished
+  typedef void (*EVE_TransportDoneFn)(void *context);
+
+  typedef struct
+  {
+    uint32_t Jobs;       // Finished
+    uint32_t Pending;
+    uint64_t Bytes;
+    uint64_t Busy_us;    // Time spent moving this queue's data
+    uint32_t MaxWait_us; // Longest a job waited for its first slice
+    uint32_t Throughput; // Bytes per second while busy
+  } EVE_QueueStats;
+
+  // Drop every queued job and set the time a service call may take
+  void EVE_EXPORT EVE_Transport_Init(uint32_t budget_us);
+
+  // Queue a write of length bytes to address in RAM_G.  data has to stay valid until done is
+  // called.  Returns false when the queue is full.
+  bool EVE_EXPORT EVE_Transport_Write(EVE_Queue queue,
+                                      uint32_t address,
+                                      const uint8_t *data,
+                                      uint32_t length,
+                                      EVE_TransportDoneFn done,
+                                      void *context);
+  // Queue a coprocessor command stream, as CoProWrCmdBuf() would send it.  length is a multiple of
+  // 4.  The stream is never cut: it goes out whole in the service call that reaches it, so no other
+  // FIFO writer can land inside one of its commands.  Queue a long stream as several jobs, split
+  // at command boundaries, to keep each within the budget.
+  bool EVE_EXPORT EVE_Transport_Commands(EVE_Queue queue,
+                                         const uint8_t *data,
+                                         uint32_t length,
+                                         EVE_TransportDoneFn done,
+                                         void *context);
+  // Queue a function to be called by the service loop
+  bool EVE_EXPORT EVE_Transport_Call(EVE_Queue queue, EVE_TransportFn work, void *context);
+
+  // Run every interactive job, then bulk slices for what is left of the budget.  Returns true
+  // while there is work queued.
+  bool EVE_EXPORT EVE_Transport_Service(void);
+  // EVE_FrameIdleFn that services the queues, context is unused
+  void EVE_EXPORT EVE_Transport_Idle(void *context);
+  // Run a queue until it is empty, ignoring the budget
+  void EVE_EXPORT EVE_Transport_Flush(EVE_Queue queue);
+
+  const EVE_QueueStats EVE_EXPORT *EVE_Transport_Stats(EVE_Queue queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,9 +26,41 @@ extern "C"
   /* Stall the cpu for X milliseconds */
   void HAL_Delay(uint32_t milliSeconds);
 
+  /* Monotonic time in microseconds, used for frame timing and statistics */
+  uint64_t HAL_Micros(void);
+
+  /* True when the EVE INT_N line is wired to the bridge and can be sampled */
+  bool HAL_IRQ_Available(void);
+
+  /* Sample INT_N - true while EVE is signalling an interrupt (the line is active low) */
+  bool HAL_IRQ_Asserted(void);
+
   /* Gives an opertunity to reset the EVE hardware */
   int HAL_Eve_Reset_HW(void);
 
+  /* Reopens the bridge after it was lost without resetting EVE, returns 0 on failure */
+  int HAL_Reopen(void);
+
+  /* Receives the HAL's messages, level as in eve_log.h (0 error, 2 information) */
+  typedef void (*HAL_LogFn)(uint8_t level, const char *message);
+
+  /* Route the HAL's messages to logger instead of printf, NULL to go back to printf */
+  void HAL_SetLogger(HAL_LogFn logger);
+
+  /* USB transfer settings of the bridge, 0 in a field leaves that setting at the bridge default */
+  typedef struct
+  {
+    uint8_t LatencyTimer; /* Milliseconds the bridge holds a part filled packet, 1 - 255 */
+    uint32_t ReadChunk;   /* USB transfer sizes in bytes, multiples of 64 up to 65536 */
+    uint32_t WriteChunk;
+  } HAL_Tuning;
+
+  /* Apply tuning now and again whenever the bridge is reopened, false if the bridge refused it */
+  bool HAL_SetTuning(const HAL_Tuning *tuning);
+
+  /* The settings in use */
+  void HAL_GetTuning(HAL_Tuning *tuning);
+
   /* Cleans up and resources allocated */
   void HAL_Close(void);
 
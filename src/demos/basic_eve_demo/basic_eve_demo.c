@@ -2,6 +2,8 @@
 #include <conio.h>
 #endif
 #include "eve.h"
+#include "eve_config.h"
+#include "eve_log.h"
 #include "hw_api.h"
 
 // MakeScreen_MatrixOrbital draws a blue dot in the center screen, along
@@ -66,9 +68,15 @@ void ClearScreen(void)
   HAL_Delay(10);
 }
 
-int main()
+int main(int argc, char **argv)
 {
-  if (EVE_Init(DEMO_DISPLAY, DEMO_BOARD, DEMO_TOUCH) <= 1)
+  EVE_Config config;
+  if (!EVE_Config_Load(&config, argc, argv))
+    return -1;
+
+  EVE_Log_Start(10); // Print the library's messages while the demo runs
+
+  if (EVE_Init(config.Display, config.Board, config.Touch) <= 1)
   {
     printf("ERROR: Eve not detected.\n");
     return -1;
@@ -90,6 +98,8 @@ int main()
     if (_kbhit())
       break;
 #endif
+    if (!EVE_IRQ_Wait(INT_TAG, 100)) // Nothing new from the touch engine
+      continue;
     uint8_t Tag = rd8(REG_TOUCH_TAG + RAM_REG); // Check for touches
     switch (Tag)
     {
@@ -109,5 +119,6 @@ int main()
       break;
     }
   }
+  EVE_Log_Stop();
   HAL_Close();
 }
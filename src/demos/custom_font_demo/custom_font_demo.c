@@ -3,9 +3,18 @@
 #endif
 #include "IBM_plex.h"
 #include "eve.h"
+#include "eve_config.h"
+#include "eve_loader.h"
+#include "eve_log.h"
 #include "hw_api.h"
 
-void MakeScreen_HelloWorld()
+// The font's xfont block refers to its glyphs by address, so both go at fixed places in RAM_G
+static EVE_LoaderAsset Assets[] = {
+    {"xfont", (const uint8_t *)&ibm_plex_mono_16_ASTC_xfont, 0, RAM_G, 1},
+    {"glyph", (const uint8_t *)&ibm_plex_mono_16_ASTC_glyph, 0, RAM_G + 4096, 1},
+};
+
+void MakeScreen_HelloWorld(EVE_Loader *loader)
 {
   // Start a new display list
   Send_CMD(CMD_DLSTART);
@@ -16,13 +25,33 @@ void MakeScreen_HelloWorld()
   // Clear the screen
   Send_CMD(CLEAR(1, 1, 1));
   Send_CMD(COLOR_RGB(255, 255, 255));
-  // Select the custom font for font 1, the xfont data is written at RAM_G
-  Cmd_SetFont2(1, RAM_G, 0);
-  Cmd_Text(Display_Width() / 2,
-           Display_VOffset() + (Display_Height() / 2),
-           1,
-           OPT_CENTER,
-           "IBM_PLEX\nMONO_26\nКириллица");
+
+  if (EVE_Loader_Done(loader))
+  {
+    // Select the custom font for font 1, the xfont data is written at RAM_G
+    Cmd_SetFont2(1, RAM_G, 0);
+    Cmd_Text(Display_Width() / 2,
+             Display_VOffset() + (Display_Height() / 2),
+             1,
+             OPT_CENTER,
+             "IBM_PLEX\nMONO_26\nКириллица");
+  }
+  else
+  {
+    // Placeholder in a ROM font while the custom font streams in
+    Cmd_Text(Display_Width() / 2,
+             Display_VOffset() + (Display_Height() / 2),
+             28,
+             OPT_CENTER,
+             "Loading...");
+    Cmd_Progress(Display_Width() / 4,
+                 Display_VOffset() + (Display_Height() / 2) + 30,
+                 Display_Width() / 2,
+                 12,
+                 0,
+                 EVE_Loader_Progress(loader),
+                 100);
+  }
 
   // End the display list
   Send_CMD(DISPLAY());
@@ -30,30 +59,42 @@ void MakeScreen_HelloWorld()
   Send_CMD(CMD_SWAP);
   // Trigger the CoProcessor to start processing the FIFO
   UpdateFIFO();
+  Wait4CoProFIFOEmpty();
 }
 
-int main()
+int main(int argc, char **argv)
 {
-  if (EVE_Init(DEMO_DISPLAY, DEMO_BOARD, DEMO_TOUCH) <= 1)
+  EVE_Loader loader;
+  EVE_Config config;
+
+  if (!EVE_Config_Load(&config, argc, argv))
+    return -1;
+
+  EVE_Log_Start(10); // Print the library's messages while the demo runs
+
+  if (EVE_Init(config.Display, config.Board, config.Touch) <= 1)
   {
     printf("ERROR: Eve not detected.\n");
     return -1;
   }
 
-  StartCoProTransfer(RAM_G, 0);
-  HAL_SPI_WriteBuffer((uint8_t *)&ibm_plex_mono_16_ASTC_xfont, ibm_plex_mono_ASTC_xfont_len);
-  HAL_SPI_Disable();
-
-  UpdateFIFO();
-  Wait4CoProFIFOEmpty();
-
-  StartCoProTransfer(RAM_G + 4096, 0);
-  HAL_SPI_WriteBuffer((uint8_t *)&ibm_plex_mono_16_ASTC_glyph, ibm_plex_mono_16_ASTC_glyph_len);
-  HAL_SPI_Disable();
-
-  UpdateFIFO();
-  Wait4CoProFIFOEmpty();
-
-  MakeScreen_HelloWorld();
+  // Draw at once and upload the font 16K a frame, instead of waiting for all of it first
+  Assets[0].Length = ibm_plex_mono_ASTC_xfont_len;
+  Assets[1].Length = ibm_plex_mono_16_ASTC_glyph_len;
+  if (!EVE_Loader_Init(&loader, Assets, sizeof(Assets) / sizeof(Assets[0]), 16384))
+  {
+    printf("ERROR: Unable to set up the font upload.\n");
+    EVE_Log_Stop();
+    HAL_Close();
+    return -1;
+  }
+  while (!EVE_Loader_Done(&loader))
+  {
+    MakeScreen_HelloWorld(&loader);
+    EVE_Loader_Step(&loader);
+  }
+  MakeScreen_HelloWorld(&loader);
+  printf("Font loaded in %u ms\n", loader.LoadTime_us / 1000);
+  EVE_Log_Stop();
   HAL_Close();
 }
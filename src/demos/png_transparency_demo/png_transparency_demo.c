@@ -2,8 +2,12 @@
 #include <conio.h>
 #endif
 #include "eve.h"
+#include "eve_config.h"
+#include "eve_log.h"
+#include "eve_palette.h"
 #include "hw_api.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 uint8_t matrix_orbital_png[] = {
     0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52,
@@ -533,6 +537,45 @@ uint8_t matrix_orbital_png[] = {
     0x26, 0xF8, 0x22, 0x25, 0xF0, 0xFF, 0x00, 0xC0, 0x80, 0xEA, 0xF1, 0x9D, 0x0E, 0xD7, 0x20, 0x00,
     0x00, 0x00, 0x00, 0x49, 0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82, 0x00};
 
+// Read the decoded ARGB4 logo back, quantise it to PALETTED4444 and draw that copy below the
+// original.  Both should look the same while the copy takes about half the memory.
+void DrawLogoPaletted(uint32_t width, uint32_t height, int32_t left, int32_t top)
+{
+  static EVE_PalettedImage logo;
+  uint32_t pixels = width * height;
+  uint8_t *argb4 = malloc(pixels * 2);
+  uint8_t *rgba = malloc(pixels * 4);
+  uint8_t *indices = malloc(pixels);
+  uint32_t dl[6];
+
+  if (argb4 && rgba && indices)
+  {
+    rdN(RAM_G, argb4, pixels * 2);
+    for (uint32_t i = 0; i < pixels; i++)
+    {
+      uint16_t p = argb4[2 * i] | (argb4[2 * i + 1] << 8);
+      rgba[4 * i] = ((p >> 8) & 15) * 17;
+      rgba[4 * i + 1] = ((p >> 4) & 15) * 17;
+      rgba[4 * i + 2] = (p & 15) * 17;
+      rgba[4 * i + 3] = (p >> 12) * 17;
+    }
+
+    // Keep the allocator clear of the ARGB4 copy sitting at the start of RAM_G
+    EVE_RamG_Init(RAM_G + pixels * 2, RAM_G_WORKING - RAM_G - pixels * 2);
+    if (EVE_Palette_Quantize(&logo, rgba, width, height, PALETTED4444, 256, false, indices) &&
+        EVE_Palette_Upload(&logo))
+    {
+      printf("Paletted logo: %u colours, %d bytes saved\n", logo.Colors,
+             EVE_Palette_BytesSaved(&logo));
+      Send_CMDs(dl, EVE_Palette_Setup(&logo, 1, dl));
+      EVE_Palette_Draw(&logo, 1, left, top);
+    }
+  }
+  free(argb4);
+  free(rgba);
+  free(indices);
+}
+
 void DrawLogoPNG()
 {
   uint32_t Reference = 0; // Reference ID for the bitmap we will be using
@@ -579,12 +622,14 @@ void DrawLogoPNG()
 
   // Place the bitmap in the center of the screen
   int32_t left = (Display_Width() - width) / 2;
-  int32_t top = Display_VOffset() + (Display_Height() - height) / 2;
+  int32_t top = Display_VOffset() + (Display_Height() - 2 * height) / 2;
   Send_CMD(VERTEXFORMAT(0)); // Setup VERTEX2F to take pixel coordinates
   Send_CMD(BEGIN(BITMAPS));  // Begin bitmap placement
   Send_CMD(VERTEX2F(left,
                     top)); // Define the placement position of the previously defined holding area.
   Send_CMD(END());         // end placing bitmaps
+
+  DrawLogoPaletted(width, height, left, top + height);
   Send_CMD(DISPLAY());     // End display list
   Send_CMD(CMD_SWAP);      // Activate this display list
 
@@ -593,14 +638,21 @@ void DrawLogoPNG()
                          // command.
 }
 
-int main()
+int main(int argc, char **argv)
 {
+  EVE_Config config;
+  if (!EVE_Config_Load(&config, argc, argv))
+    return -1;
+
+  EVE_Log_Start(10); // Print the library's messages while the demo runs
+
   // Initialize the EVE graphics controller
-  if (EVE_Init(DEMO_DISPLAY, DEMO_BOARD, DEMO_TOUCH) <= 1)
+  if (EVE_Init(config.Display, config.Board, config.Touch) <= 1)
   {
     printf("ERROR: Eve not detected.\n");
     return -1;
   }
   DrawLogoPNG(); // Draw the JPG embedded in this code file
+  EVE_Log_Stop();
   HAL_Close();   // Close the comminucations with the unit.
 }
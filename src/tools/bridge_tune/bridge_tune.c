@@ -0,0 +1,156 @@
+// bridge_tune - measure the USB bridge against EVE and find its best latency and chunk settings
+//
+//   bridge_tune --display 43_480x272 [measure | sweep | tune] [repeats <n>]
+//
+// measure  round trip time, then read and write time and throughput for 4 bytes to 64K with the
+//          bridge's current settings (the default)
+// sweep    round trip and EVE_BRIDGE_BULK_SIZE byte throughput for every latency timer and chunk
+//          size EVE_Bridge_AutoTune() tries
+// tune     run EVE_Bridge_AutoTune() and print the interactive and bulk profiles it chose
+//
+// The first EVE_BRIDGE_BULK_SIZE bytes (64K for measure) of RAM_G are overwritten.
+
+#include "eve.h"
+#include "eve_bridge.h"
+#include "eve_config.h"
+#include "hw_api.h"
+
+#define SIZES 8 // 4, 16, 64 ... 64K
+
+static uint32_t Rate(uint32_t bytes, uint32_t time_us)
+{
+  return time_us ? (uint32_t)((uint64_t)bytes * 1000000 / 1024 / time_us) : 0;
+}
+
+static void PrintTuning(const char *name, const HAL_Tuning *t)
+{
+  printf("%-12s latency timer %3u ms, read chunk %5lu, write chunk %5lu\n",
+         name,
+         t->LatencyTimer,
+         (unsigned long)t->ReadChunk,
+         (unsigned long)t->WriteChunk);
+}
+
+static void Measure(uint32_t repeats)
+{
+  EVE_BridgeSample samples[SIZES];
+  HAL_Tuning tuning;
+
+  HAL_GetTuning(&tuning);
+  PrintTuning("Bridge", &tuning);
+  printf("Round trip   %lu us\n\n", (unsigned long)EVE_Bridge_RoundTrip(repeats));
+
+  for (int i = 0; i < SIZES; i++)
+    samples[i].Size = 4UL << (2 * i);
+  EVE_Bridge_Measure(RAM_G, samples, SIZES, repeats);
+
+  printf("%8s %10s %10s %10s %10s\n", "bytes", "read us", "read KB/s", "write us", "write KB/s");
+  for (int i = 0; i < SIZES; i++)
+  {
+    printf("%8lu %10lu %10lu %10lu %10lu\n",
+           (unsigned long)samples[i].Size,
+           (unsigned long)samples[i].Read_us,
+           (unsigned long)Rate(samples[i].Size, samples[i].Read_us),
+           (unsigned long)samples[i].Write_us,
+           (unsigned long)Rate(samples[i].Size, samples[i].Write_us));
+  }
+}
+
+static void Sweep(uint32_t repeats)
+{
+  static const uint8_t Latencies[] = {1, 2, 4, 8, 16};
+  static const uint32_t Chunks[] = {4096, 16384, 65536};
+  HAL_Tuning original;
+
+  HAL_GetTuning(&original);
+  printf("%8s %8s %10s %10s %10s\n", "latency", "chunk", "round us", "read KB/s", "write KB/s");
+  for (size_t l = 0; l < sizeof(Latencies); l++)
+  {
+    for (size_t c = 0; c < sizeof(Chunks) / sizeof(Chunks[0]); c++)
+    {
+      HAL_Tuning t = {Latencies[l], Chunks[c], Chunks[c]};
+      EVE_BridgeSample sample = {EVE_BRIDGE_BULK_SIZE, 0, 0};
+
+      if (!HAL_SetTuning(&t))
+      {
+        printf("%8u %8lu   refused\n", t.LatencyTimer, (unsigned long)t.ReadChunk);
+        continue;
+      }
+      uint32_t roundTrip = EVE_Bridge_RoundTrip(repeats);
+      EVE_Bridge_Measure(RAM_G, &sample, 1, repeats);
+      printf("%8u %8lu %10lu %10lu %10lu\n",
+             t.LatencyTimer,
+             (unsigned long)t.ReadChunk,
+             (unsigned long)roundTrip,
+             (unsigned long)Rate(sample.Size, sample.Read_us),
+             (unsigned long)Rate(sample.Size, sample.Write_us));
+    }
+  }
+  HAL_SetTuning(&original);
+}
+
+static int Tune(void)
+{
+  if (!EVE_Bridge_AutoTune(RAM_G))
+  {
+    printf("ERROR: The bridge did not accept any of the settings\n");
+    return -1;
+  }
+  PrintTuning("Interactive", EVE_Bridge_Profile(EVE_PROFILE_INTERACTIVE));
+  PrintTuning("Bulk", EVE_Bridge_Profile(EVE_PROFILE_BULK));
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  EVE_Config config;
+  const char *command = "measure";
+  uint32_t repeats = EVE_BRIDGE_REPEATS;
+  int result = 0;
+
+  if (!EVE_Config_Load(&config, argc, argv))
+    return -1;
+  // eve_config takes the --options, the words are ours
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strncmp(argv[i], "--", 2))
+    {
+      if (!strchr(argv[i], '=') && i + 1 < argc)
+        i++; // Skip the option's value
+    }
+    else if (!strcmp(argv[i], "repeats") && i + 1 < argc)
+    {
+      repeats = (uint32_t)atoi(argv[++i]);
+    }
+    else
+    {
+      command = argv[i];
+    }
+  }
+
+  if (EVE_Init(config.Display, config.Board, config.Touch) <= 1)
+  {
+    printf("ERROR: Eve not detected.\n");
+    return -1;
+  }
+
+  if (!strcmp(command, "measure"))
+  {
+    Measure(repeats);
+  }
+  else if (!strcmp(command, "sweep"))
+  {
+    Sweep(repeats);
+  }
+  else if (!strcmp(command, "tune"))
+  {
+    result = Tune();
+  }
+  else
+  {
+    printf("ERROR: Unknown command '%s', use measure, sweep or tune\n", command);
+    result = -1;
+  }
+  HAL_Close();
+  return result;
+}
@@ -1,13 +1,46 @@
+#include "hw_api.h"
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#ifndef _MSC_VER
+#include <time.h>
+#endif
 #define FT800_PD_N 7
 
 #include "ftd2xx.h"
 #include "libmpsse_spi.h"
 
 static FT_HANDLE handle;
+static uint8_t intPin; // EVE INT_N on GPIOL<EVE_INT_GPIOL>, 0 when not wired
+static HAL_Tuning Tuning;
+
+// What SPI_InitChannel() sets up when tuning leaves a field at 0
+#define DEFAULT_LATENCY 2
+#define DEFAULT_CHUNK 65536
+
+// HAL_SetLogger() receiver, printf until one is set
+static HAL_LogFn Logger;
+
+void HAL_SetLogger(HAL_LogFn logger)
+{
+  Logger = logger;
+}
+
+static void Report(uint8_t level, const char *format, ...)
+{
+  char message[160];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  if (Logger)
+    Logger(level, message);
+  else
+    printf("%s", message);
+}
 
 FT_HANDLE GetFTDIHandle()
 {
@@ -78,7 +111,39 @@ void HAL_Delay(uint32_t milliSeconds)
 #endif
 }
 
-int HAL_Eve_Reset_HW(void)
+uint64_t HAL_Micros(void)
+{
+#ifdef _MSC_VER
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000 +
+         (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+bool HAL_IRQ_Available(void)
+{
+  return intPin != 0;
+}
+
+// libMPSSE leaves GPIOL0..GPIOL2 as inputs whenever it drives chip select, so the pin can be read
+// as it is.  FT_ReadGPIO() is one GET_BITS_LOW / SEND_IMMEDIATE round trip.
+bool HAL_IRQ_Asserted(void)
+{
+  uint8_t pins;
+
+  if (!intPin || FT_ReadGPIO(handle, &pins) != FT_OK)
+    return false;
+  return !(pins & intPin);
+}
+
+// Find and open the bridge.  This leaves EVE's PD_N line alone, so a running EVE is not disturbed.
+static int OpenBridge(void)
 {
   uint32_t total_channels;
 #ifndef _MSC_VER
@@ -87,7 +152,7 @@ int HAL_Eve_Reset_HW(void)
   Init_libMPSSE();
   HAL_Close();
   FT_STATUS result = SPI_GetNumChannels(&total_channels);
-  printf("channels found : %d\n", total_channels);
+  Report(2, "channels found : %d\n", total_channels);
   const char *channel = getenv("SPICHANNEL");
   int ichan = 0;
   if (channel)
@@ -104,7 +169,7 @@ int HAL_Eve_Reset_HW(void)
     FT_STATUS status;
     /* configure the spi settings */
     channelConf.ClockRate = 12 * 1000 * 1000;
-    channelConf.LatencyTimer = 2;
+    channelConf.LatencyTimer = Tuning.LatencyTimer ? Tuning.LatencyTimer : DEFAULT_LATENCY;
     channelConf.configOptions =
         SPI_CONFIG_OPTION_MODE0 | SPI_CONFIG_OPTION_CS_DBUS3 | SPI_CONFIG_OPTION_CS_ACTIVELOW;
     channelConf.Pin = 0x00000000;
@@ -114,25 +179,83 @@ int HAL_Eve_Reset_HW(void)
     status = SPI_InitChannel(handle, &channelConf);
     if (status == FT_OK)
     {
-      printf("USB->SPI Bridge opened\n");
+      Report(2, "USB->SPI Bridge opened\n");
+      if (Tuning.ReadChunk || Tuning.WriteChunk)
+        HAL_SetTuning(&Tuning); // A bridge that refuses it still works, just not as tuned
+      const char *gpiol = getenv("EVE_INT_GPIOL");
+      if (gpiol && atoi(gpiol) >= 0 && atoi(gpiol) <= 2)
+      {
+        intPin = (uint8_t)(0x10 << atoi(gpiol));
+        Report(2, "EVE INT_N on GPIOL%d\n", atoi(gpiol));
+      }
     }
     else
     {
-      printf("Unable to open USB->SPI Bridge\n");
+      Report(0, "Unable to open USB->SPI Bridge\n");
       return 0;
     }
   }
   else
   {
-    printf("USB->SPI Bridge not found.");
+    Report(0, "USB->SPI Bridge not found.");
     return 0;
   }
+  return 1;
+}
+
+bool HAL_SetTuning(const HAL_Tuning *tuning)
+{
+  Tuning = *tuning;
+  if (!handle)
+    return true; // Applied when the bridge opens
+  if (Tuning.LatencyTimer && FT_SetLatencyTimer(handle, Tuning.LatencyTimer) != FT_OK)
+  {
+    Report(0, "Setting the bridge latency timer failed\n");
+    return false;
+  }
+  if ((Tuning.ReadChunk || Tuning.WriteChunk) &&
+      FT_SetUSBParameters(handle, Tuning.ReadChunk ? Tuning.ReadChunk : DEFAULT_CHUNK,
+                          Tuning.WriteChunk ? Tuning.WriteChunk : DEFAULT_CHUNK) != FT_OK)
+  {
+    Report(0, "Setting the bridge transfer sizes failed\n");
+    return false;
+  }
+  return true;
+}
+
+// D2XX can report the latency timer but not the transfer sizes, those are the ones last set
+void HAL_GetTuning(HAL_Tuning *tuning)
+{
+  UCHAR latency;
+
+  *tuning = Tuning;
+  if (!tuning->ReadChunk)
+    tuning->ReadChunk = DEFAULT_CHUNK;
+  if (!tuning->WriteChunk)
+    tuning->WriteChunk = DEFAULT_CHUNK;
+  tuning->LatencyTimer = Tuning.LatencyTimer ? Tuning.LatencyTimer : DEFAULT_LATENCY;
+  if (handle && FT_GetLatencyTimer(handle, &latency) == FT_OK)
+    tuning->LatencyTimer = latency;
+}
+
+int HAL_Reopen(void)
+{
+  return OpenBridge(); // Drops the stale handle first
+}
+
+int HAL_Eve_Reset_HW(void)
+{
+  if (!OpenBridge())
+    return 0;
 
-  // reset the EVE by toggling PD pin (GPIO 7 of the FT232H) 0 to 1
-  FT_WriteGPIO(handle, (1 << FT800_PD_N) | 0x3B, (0 << FT800_PD_N) | 0x08); // PDN set to 0
+  // reset the EVE by toggling PD pin (GPIO 7 of the FT232H) 0 to 1.  A GPIOL pin carrying INT_N
+  // stays an input.
+  uint8_t direction = (uint8_t)(((1 << FT800_PD_N) | 0x3B) & ~intPin);
+  uint8_t value = (uint8_t)(0x08 & ~intPin);
+  FT_WriteGPIO(handle, direction, (0 << FT800_PD_N) | value); // PDN set to 0
   HAL_Delay(20);
 
-  FT_WriteGPIO(handle, (1 << FT800_PD_N) | 0x3B, (1 << FT800_PD_N) | 0x08); // PDN set to 1
+  FT_WriteGPIO(handle, direction, (1 << FT800_PD_N) | value); // PDN set to 1
   HAL_Delay(20);
   return 1;
 }
@@ -2,11 +2,14 @@
  * https://gist.github.com/bjornvaktaren/d2461738ec44e3ad8b3bae4ce69445b4 */
 #define WITH_FLUSH
 #include <ftdi.h>
+#include "hw_api.h"
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #define BUS_SK 0x01 // ADBUS0, SPI data clock
@@ -20,14 +23,46 @@
 
 #define FT800_RST BUS_L3
 // Set these pins high
-#define pinInitialState (BUS_CS | BUS_L0 | BUS_L1 | FT800_RST)
-#define pinDirection (BUS_SK | BUS_DO | BUS_CS | BUS_L0 | BUS_L1 | FT800_RST)
+#define PIN_INITIAL_STATE (BUS_CS | BUS_L0 | BUS_L1 | FT800_RST)
+#define PIN_DIRECTION (BUS_SK | BUS_DO | BUS_CS | BUS_L0 | BUS_L1 | FT800_RST)
+
+// EVE INT_N can be wired to one of GPIOL0..GPIOL2, selected with EVE_INT_GPIOL=<0..2>.  That pin
+// is then left as an input.
+static uint8_t pinInitialState = PIN_INITIAL_STATE;
+static uint8_t pinDirection = PIN_DIRECTION;
+static uint8_t intPin; // 0 when INT_N is not wired
+static bool irqFailed; // The last INT_N sample failed and has been reported
+#define IRQ_READ_TIMEOUT_US 50000
+#define SPI_READ_TIMEOUT_US 100000 // Longest a read may go without receiving anything
+static HAL_Tuning Tuning;
 
 struct ftdi_context *ftdi;
 
+// HAL_SetLogger() receiver, printf until one is set
+static HAL_LogFn Logger;
+
+void HAL_SetLogger(HAL_LogFn logger)
+{
+  Logger = logger;
+}
+
+static void Report(uint8_t level, const char *format, ...)
+{
+  char message[160];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  if (Logger)
+    Logger(level, message);
+  else
+    printf("%s", message);
+}
+
 void HAL_Close(void)
 {
-  printf("Closing bridge\n");
+  Report(2, "Closing bridge\n");
   HAL_Delay(200);
 #ifdef WITH_FLUSH
   ftdi_tcioflush(ftdi);
@@ -47,7 +82,7 @@ void HAL_RST_Enable(void)
   buf[icmd++] = pinDirection;
   if (ftdi_write_data(ftdi, buf, icmd) != icmd)
   {
-    printf("HAL_SPI_Enable write failed\n");
+    Report(0, "HAL_SPI_Enable write failed\n");
   }
 }
 
@@ -60,7 +95,7 @@ void HAL_RST_Disable(void)
   buf[icmd++] = pinDirection;
   if (ftdi_write_data(ftdi, buf, icmd) != icmd)
   {
-    printf("HAL_SPI_Enable write failed\n");
+    Report(0, "HAL_SPI_Enable write failed\n");
   }
 }
 
@@ -73,7 +108,7 @@ void HAL_SPI_Enable(void)
   buf[icmd++] = pinDirection;
   if (ftdi_write_data(ftdi, buf, icmd) != icmd)
   {
-    printf("HAL_SPI_Enable write failed\n");
+    Report(0, "HAL_SPI_Enable write failed\n");
   }
 }
 
@@ -86,7 +121,7 @@ void HAL_SPI_Disable(void)
   buf[icmd++] = pinDirection;
   if (ftdi_write_data(ftdi, buf, icmd) != icmd)
   {
-    printf("HAL_SPI_Enable write failed\n");
+    Report(0, "HAL_SPI_Enable write failed\n");
   }
 }
 
@@ -103,7 +138,7 @@ uint8_t HAL_SPI_Write(uint8_t data)
 #endif
   if (ftdi_write_data(ftdi, buf, icmd) != icmd)
   {
-    printf("HAL_SPI_Write failed\n");
+    Report(0, "HAL_SPI_Write failed\n");
   }
   return 0;
 }
@@ -119,7 +154,7 @@ void HAL_SPI_WriteBuffer(uint8_t *Buffer, uint32_t Length)
   icmd += Length;
   if (ftdi_write_data(ftdi, buf, icmd) != icmd)
   {
-    printf("HAL_SPI_Write failed\n");
+    Report(0, "HAL_SPI_Write failed\n");
   }
   free(buf);
 }
@@ -135,10 +170,27 @@ void HAL_SPI_ReadBuffer(uint8_t *Buffer, uint32_t Length)
   buf[icmd++] = SEND_IMMEDIATE;
   if (ftdi_write_data(ftdi, buf, icmd) != icmd)
   {
-    printf("HAL_SPI_Write failed\n");
+    Report(0, "HAL_SPI_Write failed\n");
+  }
+
+  // ftdi_read_data() returns what has arrived so far, which for a large read is often only part
+  // of it.  Keep reading until all of it is in, giving up if nothing arrives for a while.
+  uint32_t got = 0;
+  uint64_t last = HAL_Micros();
+  while (got < Length)
+  {
+    int n = ftdi_read_data(ftdi, Buffer + got, (int)(Length - got));
+    if (n < 0 || (n == 0 && HAL_Micros() - last > SPI_READ_TIMEOUT_US))
+    {
+      Report(0, "HAL_SPI_ReadBuffer got %u of %u bytes\n", got, Length);
+      memset(Buffer + got, 0, Length - got);
+      ftdi_tcioflush(ftdi); // Bytes arriving late would land in the next read
+      return;
+    }
+    if (n)
+      last = HAL_Micros();
+    got += (uint32_t)n;
   }
-  uint8_t res;
-  ftdi_read_data(ftdi, Buffer, Length);
 }
 
 void HAL_Delay(uint32_t milliSeconds)
@@ -146,28 +198,82 @@ void HAL_Delay(uint32_t milliSeconds)
   usleep(milliSeconds * 1000);
 }
 
-int HAL_Eve_Reset_HW(void)
+uint64_t HAL_Micros(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool HAL_IRQ_Available(void)
+{
+  return intPin != 0;
+}
+
+// ftdi_read_data() may come back empty before the pin byte arrives.  Left unread, the byte would
+// be taken by the next SPI read and shift every read after it, so wait for it, and if it never
+// comes drop whatever is in the receive buffer.  A failure is reported once, not on every sample.
+bool HAL_IRQ_Asserted(void)
+{
+  uint8_t buf[2] = {GET_BITS_LOW, SEND_IMMEDIATE};
+  uint8_t pins;
+  int got = -1;
+
+  if (!intPin)
+    return false;
+  if (ftdi_write_data(ftdi, buf, sizeof(buf)) == sizeof(buf))
+  {
+    uint64_t start = HAL_Micros();
+    while ((got = ftdi_read_data(ftdi, &pins, 1)) == 0 &&
+           HAL_Micros() - start < IRQ_READ_TIMEOUT_US)
+      ;
+  }
+  if (got != 1)
+  {
+    ftdi_tciflush(ftdi);
+    if (!irqFailed)
+      Report(0, "HAL_IRQ_Asserted failed\n");
+    irqFailed = true;
+    return false;
+  }
+  irqFailed = false;
+  return !(pins & intPin);
+}
+
+// Open and configure the bridge.  EVE's PD_N line is driven high as part of the initial pin state,
+// so this on its own does not disturb a running EVE.  settle is how long to let the MPSSE engine
+// come up after the mode change.
+static int OpenBridge(uint32_t settle)
 {
   ftdi = ftdi_new();
   if (!ftdi)
   {
-    printf("Failed to initialize USB bridge\n");
+    Report(0, "Failed to initialize USB bridge\n");
     return 0;
   }
 
   int ftdi_status = ftdi_usb_open(ftdi, 0x1b3d, 0x200);
   if (ftdi_status != 0)
   {
-    printf("Can't open USB bridge, error %s\n", ftdi_get_error_string(ftdi));
+    Report(0, "Can't open USB bridge, error %s\n", ftdi_get_error_string(ftdi));
     return 0;
   }
-  printf("Bridge opened successfully!\n");
+  Report(2, "Bridge opened successfully!\n");
+
+  const char *gpiol = getenv("EVE_INT_GPIOL");
+  if (gpiol && atoi(gpiol) >= 0 && atoi(gpiol) <= 2)
+  {
+    intPin = BUS_L0 << atoi(gpiol);
+    pinInitialState = PIN_INITIAL_STATE & ~intPin;
+    pinDirection = PIN_DIRECTION & ~intPin;
+    Report(2, "EVE INT_N on GPIOL%d\n", atoi(gpiol));
+  }
   ftdi_usb_reset(ftdi);
   ftdi_set_interface(ftdi, INTERFACE_ANY);
   ftdi_set_bitmode(ftdi, 0, 0);
   ftdi_set_bitmode(ftdi, 0, BITMODE_MPSSE);
   ftdi_tcioflush(ftdi);
-  usleep(100000);
+  usleep(settle * 1000);
 
   unsigned int icmd = 0;
   unsigned char buf[256] = {0};
@@ -181,11 +287,64 @@ int HAL_Eve_Reset_HW(void)
   buf[icmd++] = pinDirection;    // argument: pin direction
   if (ftdi_write_data(ftdi, buf, icmd) != icmd)
   {
-    printf("Bridge setup failed\n");
+    Report(0, "Bridge setup failed\n");
     ftdi_usb_close(ftdi);
     return 0;
   }
-  printf("Setup complete!\n");
+  Report(2, "Setup complete!\n");
+  HAL_SetTuning(&Tuning); // A bridge that refuses it still works, just not as tuned
+  return 1;
+}
+
+bool HAL_SetTuning(const HAL_Tuning *tuning)
+{
+  bool ok = true;
+
+  Tuning = *tuning;
+  if (!ftdi)
+    return true; // Applied when the bridge opens
+  if (Tuning.LatencyTimer && ftdi_set_latency_timer(ftdi, Tuning.LatencyTimer) < 0)
+    ok = false;
+  if (Tuning.ReadChunk && ftdi_read_data_set_chunksize(ftdi, Tuning.ReadChunk) < 0)
+    ok = false;
+  if (Tuning.WriteChunk && ftdi_write_data_set_chunksize(ftdi, Tuning.WriteChunk) < 0)
+    ok = false;
+  if (!ok)
+    Report(0, "Bridge tuning failed, error %s\n", ftdi_get_error_string(ftdi));
+  return ok;
+}
+
+void HAL_GetTuning(HAL_Tuning *tuning)
+{
+  unsigned char latency;
+  unsigned int chunk;
+
+  *tuning = Tuning;
+  if (!ftdi)
+    return;
+  if (ftdi_get_latency_timer(ftdi, &latency) == 0)
+    tuning->LatencyTimer = latency;
+  if (ftdi_read_data_get_chunksize(ftdi, &chunk) == 0)
+    tuning->ReadChunk = chunk;
+  if (ftdi_write_data_get_chunksize(ftdi, &chunk) == 0)
+    tuning->WriteChunk = chunk;
+}
+
+int HAL_Reopen(void)
+{
+  if (ftdi)
+  {
+    ftdi_usb_close(ftdi); // Usually fails, the device has gone away, but it releases the handle
+    ftdi_free(ftdi);
+    ftdi = NULL;
+  }
+  return OpenBridge(10);
+}
+
+int HAL_Eve_Reset_HW(void)
+{
+  if (!OpenBridge(100))
+    return 0;
   HAL_RST_Enable();
   HAL_Delay(20);
   HAL_RST_Disable();